@@ -20,6 +20,7 @@
 
 namespace llvm {
 class CallInst;
+class Function;
 class Module;
 class DataLayout;
 
@@ -48,6 +49,15 @@ public:
   ///
   void LowerIntrinsicCall(CallInst *CI);
 
+  /// isLowerableIntrinsicCall - Return true if LowerIntrinsicCall supports
+  /// the intrinsic called by CI, and it is not a debug info intrinsic.
+  static bool isLowerableIntrinsicCall(const CallInst &CI);
+
+  /// LowerIntrinsicCalls - Lower all the calls in F for which
+  /// isLowerableIntrinsicCall is true, so that F is not modified while it is
+  /// interpreted. Return true if F was changed.
+  bool LowerIntrinsicCalls(Function &F);
+
   /// LowerToByteSwap - Replace a call instruction into a call to bswap
   /// intrinsic. Return false if it has determined the call is not a
   /// simple integer bswap.
@@ -13,6 +13,8 @@
 //#define EFF_TBV
 
 #include "../../../lib/ExecutionEngine/Interpreter/Interpreter.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/IR/DebugInfo.h"
@@ -20,13 +22,22 @@
 #include "llvm/ADT/SmallString.h"
 #include "llvm/IR/InstIterator.h"
 #include "llvm/IR/GetElementPtrTypeIterator.h"
-#include <boost/bimap.hpp>
 
 #ifdef INTERPRETER
-#include "llvm/Support/LinkedList.h"
+#include "llvm/Support/FenwickReuseTree.h"
+#include "llvm/Support/LRUStack.h"
+#include "llvm/Support/OccupancyTable.h"
+#include "llvm/Support/PageTable.h"
+#include "llvm/Support/SpanIntervals.h"
+#include "llvm/Support/TimedBuffer.h"
 #include "llvm/Support/top-down-size-splay.hpp"
 #else
-#include "LinkedList.h"
+#include "FenwickReuseTree.h"
+#include "LRUStack.h"
+#include "OccupancyTable.h"
+#include "PageTable.h"
+#include "SpanIntervals.h"
+#include "TimedBuffer.h"
 #include "top-down-size-splay.hpp"
 #endif
 
@@ -63,6 +74,9 @@
 #define NORMAL_REUSE_DISTRIBUTION
 
 //#define STACK_DEQUE
+// Compute the reuse distances of cache lines with the splay trees instead of
+// FenwickReuseTree, e.g., to validate them.
+//#define SPLAY_REUSE_TREE
 
 #define PRINT_OVERLAPS
 //#define PRINT_ALL_OVERLAPS
@@ -333,6 +347,10 @@ enum {
 #define N_MEM_RESOURCES_END MEM_STORE_CHANNEL
 
 
+namespace llvm {
+class ThreadPool;
+}
+
 using namespace llvm;
 using namespace std;
 using namespace SplayTree;
@@ -345,6 +363,10 @@ using namespace ComplexSplayTree;
 // in a corresponding rage.
 static const unsigned SplitTreeRange = 131072;
 
+// Minimum number of pointer to memory instances whose uses dropped to zero
+// before they are collected.
+static const unsigned MinDeadPointerToMemoryInstancesBatch = 65536;
+
 
 
 
@@ -361,8 +383,10 @@ struct PointerToMemory{
   Value * Offset5;
 };
 
+// PTMindex is the index of the pointer to memory in
+// DynamicAnalysis::PointersToMemory.
 struct PointerToMemoryInstance{
-  PointerToMemory PTM;
+  unsigned PTMindex;
   unsigned Rep;
   int64_t IterationCount;
 };
@@ -377,6 +401,139 @@ struct InstructionValue{
 bool operator <(const PointerToMemory& x, const PointerToMemory& y);
 bool operator <(const PointerToMemoryInstance& x,
                 const PointerToMemoryInstance& y);
+bool operator== (PointerToMemory a, PointerToMemory b);
+bool operator== (PointerToMemoryInstance a, PointerToMemoryInstance b);
+
+struct PointerToMemoryInstanceHash{
+  size_t operator()(const PointerToMemoryInstance& x) const {
+    return hash_combine(x.PTMindex, x.Rep, x.IterationCount);
+  }
+};
+
+namespace llvm {
+template <> struct DenseMapInfo<PointerToMemory> {
+  static inline PointerToMemory getEmptyKey() {
+    Value *Empty = DenseMapInfo<Value *>::getEmptyKey();
+    return {Empty, NULL, NULL, NULL, NULL, NULL};
+  }
+  static inline PointerToMemory getTombstoneKey() {
+    Value *Tombstone = DenseMapInfo<Value *>::getTombstoneKey();
+    return {Tombstone, NULL, NULL, NULL, NULL, NULL};
+  }
+  static unsigned getHashValue(const PointerToMemory &PTM) {
+    return hash_combine(PTM.BasePointer, PTM.Offset1, PTM.Offset2, PTM.Offset3,
+                        PTM.Offset4, PTM.Offset5);
+  }
+  static bool isEqual(const PointerToMemory &LHS, const PointerToMemory &RHS) {
+    return LHS == RHS;
+  }
+};
+
+// Indexes ~0U and ~0U - 1 are never handed out by getPointerToMemoryIndex.
+template <> struct DenseMapInfo<PointerToMemoryInstance> {
+  static inline PointerToMemoryInstance getEmptyKey() { return {~0U, 0, 0}; }
+  static inline PointerToMemoryInstance getTombstoneKey() {
+    return {~0U - 1, 0, 0};
+  }
+  static unsigned getHashValue(const PointerToMemoryInstance &PTMI) {
+    return hash_combine(PTMI.PTMindex, PTMI.Rep, PTMI.IterationCount);
+  }
+  static bool isEqual(const PointerToMemoryInstance &LHS,
+                      const PointerToMemoryInstance &RHS) {
+    return LHS == RHS;
+  }
+};
+} // end namespace llvm
+
+// Rebuilds Map into a table sized for its entries, if erasures have left it
+// mostly empty. DenseMap never shrinks on erase.
+template <typename MapT> void compactDenseMap(MapT &Map) {
+  if (Map.size() * 8 * sizeof(typename MapT::value_type) >= Map.getMemorySize())
+    return;
+  MapT Compact;
+  Compact.reserve(Map.size());
+  for (typename MapT::iterator It = Map.begin(), E = Map.end(); It != E; ++It)
+    Compact.insert(*It);
+  Map.swap(Compact);
+}
+
+// One-to-one association between pointer to memory instances and memory
+// addresses. As with a bimap, an insertion is ignored if either side already
+// has an entry.
+class PointerToMemoryInstanceAddressMap {
+public:
+  typedef DenseMap<PointerToMemoryInstance, uint64_t> AddressMap;
+  typedef DenseMap<uint64_t, PointerToMemoryInstance> InstanceMap;
+  typedef InstanceMap::const_iterator const_iterator;
+
+  bool insert(const PointerToMemoryInstance &PTMI, uint64_t Address) {
+    if (Addresses.count(PTMI) || Instances.count(Address))
+      return false;
+    Addresses[PTMI] = Address;
+    Instances[Address] = PTMI;
+    return true;
+  }
+
+  // Moves PTMI to Address. Returns false if PTMI has no address or Address
+  // belongs to another instance.
+  bool replaceAddress(const PointerToMemoryInstance &PTMI, uint64_t Address) {
+    AddressMap::iterator It = Addresses.find(PTMI);
+    if (It == Addresses.end())
+      return false;
+    if (It->second == Address)
+      return true;
+    if (Instances.count(Address))
+      return false;
+    Instances.erase(It->second);
+    It->second = Address;
+    Instances[Address] = PTMI;
+    return true;
+  }
+
+  bool findAddress(const PointerToMemoryInstance &PTMI,
+                   uint64_t &Address) const {
+    AddressMap::const_iterator It = Addresses.find(PTMI);
+    if (It == Addresses.end())
+      return false;
+    Address = It->second;
+    return true;
+  }
+
+  bool findInstance(uint64_t Address, PointerToMemoryInstance &PTMI) const {
+    InstanceMap::const_iterator It = Instances.find(Address);
+    if (It == Instances.end())
+      return false;
+    PTMI = It->second;
+    return true;
+  }
+
+  bool hasInstance(const PointerToMemoryInstance &PTMI) const {
+    return Addresses.count(PTMI);
+  }
+  bool hasAddress(uint64_t Address) const { return Instances.count(Address); }
+
+  void erase(const PointerToMemoryInstance &PTMI) {
+    AddressMap::iterator It = Addresses.find(PTMI);
+    if (It == Addresses.end())
+      return;
+    Instances.erase(It->second);
+    Addresses.erase(It);
+  }
+
+  void compact() {
+    compactDenseMap(Addresses);
+    compactDenseMap(Instances);
+  }
+
+  // Iterates over (address, instance) pairs, in no particular order.
+  const_iterator begin() const { return Instances.begin(); }
+  const_iterator end() const { return Instances.end(); }
+  unsigned size() const { return Instances.size(); }
+
+private:
+  AddressMap Addresses;
+  InstanceMap Instances;
+};
 
 
 
@@ -396,16 +553,63 @@ struct InstructionDispatchInfo{
 };
 
 
-struct LessThanOrEqualValuePred
-{
-  uint64_t CompareValue;
-  
-  bool operator()(const uint64_t Value) const
-  {
-    return Value <= CompareValue;
+// =============================================================================
+//  Static properties of the instructions of the analyzed module
+//==============================================================================
+
+// Properties of an instruction that do not depend on its dynamic execution.
+// They are computed once per static instruction instead of once per dynamic
+// instance.
+struct InstructionDescriptor{
+  unsigned Opcode;        // Detects an instruction allocated at the address
+                          // of an erased one (e.g., lowered intrinsics)
+  int Type;               // Result of getInstructionType
+  int8_t FloatPrecision;  // FloatPrecision implied by the type (0 single,
+                          // 1 double), or -1 if the type does not set it
+  bool IsTargetFunction;  // The instruction belongs to the analyzed function
+  bool IsDebug;           // Call to a llvm.dbg intrinsic
+  unsigned NElementsVector; // Elements of the vector operand, 0 if scalar
+  // Operand positions of intrinsics, when the intrinsic is known
+  bool HasStoreOperandPosition;
+  int64_t StoreOperandPosition;
+  bool HasOperandsPositions;
+  vector<int64_t> OperandsPositions[2]; // Indexed by (valueRep > 1)
+  unsigned Number;        // Index of the per-instruction dynamic state
+  // Numbers of the users of the instruction, and whether each one is a PHI
+  // node
+  vector<pair<unsigned, bool> > Users;
+};
+
+// Descriptors of the instructions of a set of functions. Once built, the
+// table is read-only and can be shared by the interpreter and analyzers
+// running on other threads.
+// Instructions are numbered consecutively from zero. A function added again
+// keeps the numbers of the instructions already described, so that dynamic
+// state indexed by number survives it.
+class InstructionDescriptorTable{
+  string TargetFunction;
+  // A deque so that references to descriptors remain valid when functions
+  // are added.
+  deque<InstructionDescriptor> Descriptors;
+  DenseMap<const Instruction *, unsigned> Index;
+  unsigned NextNumber;
+  
+public:
+  InstructionDescriptorTable(string TargetFunction)
+      : TargetFunction(TargetFunction), NextNumber(0) {}
+  
+  void addFunction(Function &F);
+  void addModule(Module &M);
+  
+  const InstructionDescriptor *lookup(const Instruction &I) const {
+    DenseMap<const Instruction *, unsigned>::const_iterator It = Index.find(&I);
+    if (It == Index.end() || Descriptors[It->second].Opcode != I.getOpcode())
+      return NULL;
+    return &Descriptors[It->second];
   }
 };
 
+
 struct StructMemberLessThanOrEqualThanValuePred
 {
   const uint64_t CompareValue;
@@ -440,11 +644,18 @@ class TBV_node {
 };
 
 
+// A chunk of SplitTreeRange cycles. Each resource has a bit plane of 64-bit
+// words, one bit per cycle, and a summary with one bit per word that is set
+// when the word is all ones.
 class TBV {
   
   public:
   
-  vector<TBV_node> tbv_map;
+  vector< vector<uint64_t> > Planes;
+  vector< vector<uint64_t> > FullWords;
+#ifdef SOURCE_CODE_ANALYSIS
+  vector< vector<pair<unsigned,unsigned> > > SourceCodeLinesOperationPair;
+#endif
   bool e;
   
   
@@ -452,16 +663,19 @@ class TBV {
   void insert_source_code_line(uint64_t key, unsigned SourceCodeLine,
                                unsigned Resource);
   vector<pair<unsigned,unsigned> >  get_source_code_lines(uint64_t key);
-  bool get_size();
-  void resize();
+  bool has_plane(unsigned bitPosition);
   
   bool get_node(uint64_t key, unsigned bitPosition);
+  uint64_t find_next_unset(uint64_t key, unsigned bitPosition);
+  uint64_t find_next_set(uint64_t key, unsigned bitPosition);
   void insert_node(uint64_t key, unsigned bitPosition);
+  void insert_range(uint64_t From, uint64_t To, unsigned bitPosition);
   
   bool get_node_nb(uint64_t key, unsigned bitPosition);
   
   void delete_node(uint64_t key, unsigned bitPosition);
   bool empty();
+  void release();
 };
 
 
@@ -482,7 +696,7 @@ class ACT {
   
   public:
   bool get_node_ACT(uint64_t, unsigned);
-  void push_back(ACTNode*, unsigned);
+  void push_back(const ACTNode &, unsigned);
   void DebugACT();
   size_t size();
   void clear();
@@ -549,6 +763,9 @@ class DynamicAnalysis {
   //For every node, the execution unit in which it executes.
   vector<unsigned> ExecutionUnit;
   vector<vector<unsigned> > DispatchPort;
+  // For every node, bit p is set if the node can be dispatched to port
+  // PORT_0 + p.
+  vector<uint64_t> DispatchPortMask;
   vector<string> NodesNames;
   // For every execution unit, latency, throughput...
   vector<unsigned> ExecutionUnitsLatency;
@@ -597,6 +814,18 @@ class DynamicAnalysis {
   string TargetFunction;
   uint8_t FunctionCallStack;
   
+  // Static properties of the analyzed instructions. SharedInstructionDescriptors
+  // is built by the caller for the whole module and must describe every
+  // analyzed instruction. Without it (NULL), InstructionDescriptors is filled
+  // by the analyzer as functions are reached.
+  const InstructionDescriptorTable *SharedInstructionDescriptors;
+  InstructionDescriptorTable InstructionDescriptors;
+  
+  // Threads that compute the span matrices at the end of the analysis,
+  // shared by the analyzers of a run. Without it (NULL), each analyzer
+  // creates its own pool.
+  ThreadPool *SharedThreadPool;
+  
   
   
   int rep;
@@ -646,47 +875,68 @@ class DynamicAnalysis {
   int64_t RemainingInstructionsFetch;
   uint64_t InstructionFetchCycle;
   
-  vector<uint64_t> ReservationStationIssueCycles;
+  // Cycles at which the entries of each buffer are released, kept in order.
+  TimedBuffer<uint64_t> ReservationStationIssueCycles;
   deque<uint64_t> ReorderBufferCompletionCycles;
-  vector<uint64_t> LoadBufferCompletionCycles;
+  TimedBuffer<uint64_t> LoadBufferCompletionCycles;
   SimpleTree<uint64_t> *LoadBufferCompletionCyclesTree;
-  vector<uint64_t> StoreBufferCompletionCycles;
-  vector<uint64_t> LineFillBufferCompletionCycles;
+  NodePool< SimpleTree<uint64_t> > LoadBufferCompletionCyclesNodes;
+  TimedBuffer<uint64_t> StoreBufferCompletionCycles;
+  TimedBuffer<uint64_t> LineFillBufferCompletionCycles;
   vector<InstructionDispatchInfo> DispatchToLoadBufferQueue;
   ComplexTree<uint64_t> *DispatchToLoadBufferQueueTree;
+  NodePool< ComplexTree<uint64_t> > DispatchToLoadBufferQueueNodes;
   vector<pair<uint64_t,uint64_t> > DispatchToLoadBufferQueueTreeCyclesToRemove;
   Value * PrevBB;
   vector<InstructionDispatchInfo> DispatchToStoreBufferQueue;
   vector<InstructionDispatchInfo> DispatchToLineFillBufferQueue;
   
-  vector< Tree<uint64_t> * > AvailableCyclesTree;
+  vector< OccupancyTable > AvailableCycles;
   
 #ifdef EFF_TBV
   vector< TBV_node> FullOccupancyCyclesTree;
 #else
   vector< TBV> FullOccupancyCyclesTree;
 #endif
+  // Cycles below RetiredCycles can no longer be scheduled. Their levels are
+  // only kept as the intervals of non-empty levels of every resource.
+  uint64_t RetiredCycles;
+  vector< SpanIntervals > RetiredLevels;
   vector <Tree<uint64_t> * > StallCycles;
   vector <uint64_t> NInstructionsStalled;
   
   uint64_t MinLoadBuffer;
   uint64_t MaxDispatchToLoadBufferQueueTree;
   
-  vector<unsigned> IssuePorts;
+  // Ports that have issued instructions within the issue cycle granularity of
+  // the cycle last checked by thereIsAvailableBandwidth (bit p is port
+  // PORT_0 + p), and the number of instructions issued through them.
+  uint64_t IssuePorts;
+  unsigned NIssuePorts;
   
   // ===========================================================================
   // Data structures for tracking value analysis
   // ===========================================================================
   
-  map <PointerToMemoryInstance, PointerToMemoryInstance> PointerToMemoryInstanceMap;
-  typedef map<PointerToMemoryInstance, PointerToMemoryInstance> ::iterator PointerToMemoryInstanceMapIterator;
+  // Pointers to memory are interned: instances refer to them by their index
+  // in PointersToMemory.
+  vector<PointerToMemory> PointersToMemory;
+  DenseMap<PointerToMemory, unsigned> PointerToMemoryIndexMap;
+  
+  DenseMap<PointerToMemoryInstance, PointerToMemoryInstance> PointerToMemoryInstanceMap;
+  typedef DenseMap<PointerToMemoryInstance, PointerToMemoryInstance>::iterator
+                                             PointerToMemoryInstanceMapIterator;
   
-  map <PointerToMemoryInstance, uint64_t> PointerToMemoryInstanceNUsesMap;
-  typedef map<PointerToMemoryInstance, uint64_t> ::iterator
+  DenseMap<PointerToMemoryInstance, uint64_t> PointerToMemoryInstanceNUsesMap;
+  typedef DenseMap<PointerToMemoryInstance, uint64_t>::iterator
                                         PointerToMemoryInstanceNUsesMapIterator;
   
-  typedef boost::bimap< PointerToMemoryInstance, uint64_t > bm_type;
-  bm_type PointerToMemoryInstanceAddressBiMap;
+  PointerToMemoryInstanceAddressMap PointerToMemoryInstanceAddresses;
+  
+  // Instances whose number of uses dropped to zero in the analysis run,
+  // reclaimed in batches by collectDeadPointerToMemoryInstances.
+  vector<PointerToMemoryInstance> DeadPointerToMemoryInstances;
+  size_t NextDeadPointerToMemoryInstancesCollection;
   
   map <InstructionValue, int64_t> InstructionValueMap;
   
@@ -694,15 +944,21 @@ class DynamicAnalysis {
   vector<uint64_t> SpilledAddress;
   
   map <Value*, Value*> InstructionValueInstructionNameMap;
-  map <Value*, uint64_t> InstructionValueIssueCycleMap;
-  map <uint64_t , CacheLineInfo> CacheLineIssueCycleMap;
-  map <uint64_t , uint64_t> MemoryAddressIssueCycleMap;
+  // Indexed by InstructionDescriptor::Number
+  vector<uint64_t> InstructionValueIssueCycles;
+  // Cache lines are indexes, so they are dense. Addresses of 4-byte aligned
+  // accesses are stored in the pages, the others in the overflow map.
+  PageTable<CacheLineInfo, 10> CacheLineIssueCycleMap;
+  PageTable<uint64_t, 10, 2> MemoryAddressIssueCycleMap;
+  // Footprint of MemoryAddressIssueCycleMap after its last sweep by
+  // retireCycles.
+  size_t MemoryAddressSweepFootprint;
   
 #ifdef INTERMEDIATE_RESULTS_STACK
 #ifdef STACK_DEQUE
   deque<PointerToMemoryInstance> ReuseStack;
 #else
-  LinkedList<PointerToMemoryInstance> ReuseStack;
+  LRUStack<PointerToMemoryInstance, PointerToMemoryInstanceHash> ReuseStack;
 #endif
 #else
   deque<uint64_t> ReuseStack;
@@ -712,8 +968,15 @@ class DynamicAnalysis {
   // ===========================================================================
   // Variables for reuse distance analysis
   // ===========================================================================
+#ifdef SPLAY_REUSE_TREE
   Tree<uint64_t> * ReuseTree;
   Tree<uint64_t> * PrefetchReuseTree;
+  // Nodes of ReuseTree and PrefetchReuseTree
+  NodePool< Tree<uint64_t> > ReuseTreeNodes;
+#else
+  FenwickReuseTree ReuseTree;
+  FenwickReuseTree PrefetchReuseTree;
+#endif
   uint64_t PrefetchReuseTreeSize;
   map<int,int> ReuseDistanceDistribution;
   map<int,int> RegisterReuseDistanceDistribution;
@@ -741,9 +1004,10 @@ class DynamicAnalysis {
   // ===========================================================================
   // From Contech (): efficiently calculating span using bitvectors.
   // ===========================================================================
-  vector< dynamic_bitset<> > CGSFCache;
-  vector< dynamic_bitset<> > CISFCache;
-  vector< dynamic_bitset<> > CLSFCache;
+  // Spans of every resource, built as intervals while they are computed.
+  vector< SpanIntervals > CGSFSpans;
+  vector< SpanIntervals > CISFSpans;
+  vector< SpanIntervals > CLSFSpans;
   
   vector<vector<float> > BnkMat;
   ACT ACTFinal;
@@ -780,6 +1044,7 @@ class DynamicAnalysis {
                   bool ConstraintPortsx86,
                   bool ConstraintPortsARM,
                   bool ConstraintAGUs,
+                  unsigned DispatchPorts,
                   int rep,
                   bool InOrderExecution,
                   bool ReportOnlyPerformance,
@@ -846,6 +1111,8 @@ class DynamicAnalysis {
   
   void increaseNUses(PointerToMemoryInstance PTMI);
   void decreaseNUses(PointerToMemoryInstance PTMI);
+  bool isStalePointerToMemoryInstance(PointerToMemoryInstance PTMI);
+  void collectDeadPointerToMemoryInstances();
   
   uint64_t adjustMemoryAddress(PointerToMemory v, uint64_t addr,
                                bool forceAnalyze);
@@ -853,6 +1120,7 @@ class DynamicAnalysis {
                                        vector<Value *>&  originalIncomingEdges);
   
   void printInstructionValue(InstructionValue IV);
+  unsigned getPointerToMemoryIndex(const PointerToMemory &PTM);
   void printPointerToMemory (PointerToMemory ptrmem);
   void printPointerToMemoryGlobalVector();
   void printPointerToMemoryInstanceMap();
@@ -868,17 +1136,29 @@ class DynamicAnalysis {
   
   string getNodeName(unsigned Node);
   
+  const InstructionDescriptor &getInstructionDescriptor(Instruction &I);
+  
   int getInstructionType(Instruction &I);
+  int getInstructionType(const InstructionDescriptor &Descriptor);
   
   unsigned getLastRepetitionIntrinsic(string functionName);
   unsigned getLastNonMemRepetitionIntrinsic(string functionName);
   int64_t getStoreOperandPositionIntrinsic(string functionName);
+  int64_t getStoreOperandPositionIntrinsic(
+      Instruction &I, const InstructionDescriptor &Descriptor);
 
   void getOperandsPositionsIntrinsic(string functionName,
                                      vector<int64_t> & positions,
                                      unsigned valueRep);
+  void getOperandsPositionsIntrinsic(Instruction &I,
+                                     const InstructionDescriptor &Descriptor,
+                                     vector<int64_t> & positions,
+                                     unsigned valueRep);
 
-  uint64_t getInstructionValueIssueCycle(Value* v);
+  uint64_t getInstructionValueIssueCycle(unsigned Number);
+  void insertInstructionValueIssueCycle(unsigned Number,
+                                        uint64_t InstructionIssueCycle,
+                                        bool isPHINode = 0 );
   void insertInstructionValueIssueCycle(Value* v,uint64_t InstructionIssueCycle,
                                         bool isPHINode = 0 );
   void insertInstructionValueName(Value * v);
@@ -910,6 +1190,8 @@ class DynamicAnalysis {
   uint64_t getTreeChunk(uint64_t i);
 #endif
 
+  uint64_t getFullPorts(uint64_t Cycle, uint64_t Ports);
+  
   unsigned
   findNextAvailableIssueCyclePortAndThroughtput(unsigned InstructionIssueCycle,
                                                 unsigned ExtendedInstructionType,
@@ -957,6 +1239,11 @@ class DynamicAnalysis {
   
   void increaseInstructionFetchCycle(bool EmptyBuffers = false);
   
+#ifndef EFF_TBV
+  void retireCycles(uint64_t Cycle);
+#endif
+  void insertStallCycles(unsigned ResourceType, uint64_t From, uint64_t To);
+  
   
   //===----------------------------------------------------------------------===//
   //                Routines for Analysis of Reuse Distance
@@ -988,11 +1275,23 @@ class DynamicAnalysis {
   //        Routine to schedule a node in the DAG
   //===----------------------------------------------------------------------===//
   
-  void analyzeInstruction(Instruction &I, unsigned OpCode, uint64_t addr,
+  // Descriptor holds the static properties of I, looked up by the caller.
+  void analyzeInstruction(Instruction &I,
+                          const InstructionDescriptor &Descriptor,
+                          unsigned OpCode, uint64_t addr,
                            unsigned SourceCodeLine = 0 ,
                            bool forceAnalyze = false, unsigned VectorWidth = 1,
                            unsigned valueRep = 0, bool lastValue = true,
                            bool firstValue = true, bool isSpill = false);
+  void analyzeInstruction(Instruction &I, unsigned OpCode, uint64_t addr,
+                           unsigned SourceCodeLine = 0 ,
+                           bool forceAnalyze = false, unsigned VectorWidth = 1,
+                           unsigned valueRep = 0, bool lastValue = true,
+                           bool firstValue = true, bool isSpill = false) {
+    analyzeInstruction(I, getInstructionDescriptor(I), OpCode, addr,
+                       SourceCodeLine, forceAnalyze, VectorWidth, valueRep,
+                       lastValue, firstValue, isSpill);
+  }
   
   
   
@@ -1013,6 +1312,10 @@ class DynamicAnalysis {
   uint64_t calculateSpanFinal(int ResourceType);
   
   bool isEmptyLevelFinal(unsigned ExecutionResource, uint64_t Level);
+#ifndef EFF_TBV
+  SpanIntervals spanFromRetiredLevels(unsigned ResourceType, unsigned Latency,
+                                      uint64_t LastCycle);
+#endif
 
   unsigned calculateLatencyOnlySpanFinal(unsigned i);
   unsigned getGroupSpanFinal(vector<int> & ResourcesVector);
@@ -1021,8 +1324,8 @@ class DynamicAnalysis {
   unsigned getOneToAllOverlapCyclesFinal(vector < int >&ResourcesVector,
                                          bool Issue);
   unsigned calculateGroupSpanFinal(vector<int> & ResourcesVector);
+  unsigned getIssueStallSpanFinal(unsigned Resource, unsigned Stall);
 
-  void computeAvailableTreeFinalHelper(uint p, Tree<uint64_t>* t, uint d);
   void computeAvailableTreeFinal();
 
   
@@ -1068,6 +1371,8 @@ class DynamicAnalysis {
   void dispatchToStoreBuffer(uint64_t Cycle);
   void dispatchToLineFillBuffer(uint64_t Cycle);
   
+  void moveDispatchedToBuffer(vector<InstructionDispatchInfo> &Queue,
+                              TimedBuffer<uint64_t> &Buffer);
   uint64_t findIssueCycleWhenLoadBufferIsFull();
   uint64_t findIssueCycleWhenLoadBufferTreeIsFull();
   uint64_t findIssueCycleWhenStoreBufferIsFull();
@@ -0,0 +1,107 @@
+//=--------------- llvm/Support/DynamicAnalysisTrace.h ------======= -*- C++ -*//
+//
+//                     The LLVM Compiler Infrastructure
+//
+//===----------------------------------------------------------------------===//
+//
+// Binary trace of the dynamic instruction stream consumed by DynamicAnalysis.
+//
+// A capture run (lli -force-interpreter -capture-trace=<file>) records one
+// fixed-size record per instruction handed to analyzeInstruction. A replay
+// run (-replay-trace=<file>) loads the same bitcode, maps the static
+// instruction ids back to Instructions and drives DynamicAnalysis directly
+// from the trace, without interpreting the program. The file is a header
+// followed by a flat array of records, so it can be memory-mapped as is.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_DYNAMIC_ANALYSIS_TRACE_H
+#define LLVM_SUPPORT_DYNAMIC_ANALYSIS_TRACE_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace llvm {
+
+#define DYNAMIC_TRACE_MAGIC "ERMTRACE"
+#define DYNAMIC_TRACE_VERSION 1
+
+// Flags of a DynamicTraceRecord, describing how Payload is interpreted.
+#define TRACE_MEMORY_ACCESS 0x1 // Payload is the accessed memory address
+#define TRACE_BRANCH_EDGE   0x2 // Payload is the id of the first instruction
+                                // of the successor basic block
+
+struct DynamicTraceHeader {
+  char Magic[8];
+  uint32_t Version;
+  uint32_t RecordSize;
+  uint64_t NRecords;
+  // Number of static instructions in the module when the trace was captured.
+  // Used to reject a trace that does not belong to the loaded bitcode.
+  uint64_t NStaticInstructions;
+};
+
+struct DynamicTraceRecord {
+  uint32_t InstructionId; // Position of the instruction in module order
+  uint16_t OpCode;
+  uint16_t Flags;
+  uint64_t Payload;
+};
+
+static_assert(sizeof(DynamicTraceHeader) == 32,
+              "DynamicTraceHeader layout is part of the trace format");
+static_assert(sizeof(DynamicTraceRecord) == 16,
+              "DynamicTraceRecord layout is part of the trace format");
+
+class DynamicTraceWriter {
+  std::unique_ptr<raw_fd_ostream> OS;
+  std::vector<DynamicTraceRecord> Buffer;
+  uint64_t NRecords;
+  uint64_t NStaticInstructions;
+
+  void flush();
+
+public:
+  DynamicTraceWriter(const std::string &Filename, uint64_t NStaticInstructions);
+  ~DynamicTraceWriter();
+
+  void write(uint32_t InstructionId, unsigned OpCode, unsigned Flags,
+             uint64_t Payload) {
+    DynamicTraceRecord Record = {InstructionId, (uint16_t)OpCode,
+                                 (uint16_t)Flags, Payload};
+    Buffer.push_back(Record);
+    if (Buffer.size() == Buffer.capacity())
+      flush();
+  }
+
+  // Writes the pending records and the final header. Further writes are
+  // ignored.
+  void close();
+};
+
+class DynamicTraceReader {
+  std::unique_ptr<MemoryBuffer> File;
+  const DynamicTraceHeader *Header;
+
+public:
+  explicit DynamicTraceReader(const std::string &Filename);
+
+  uint64_t getNStaticInstructions() const {
+    return Header->NStaticInstructions;
+  }
+  ArrayRef<DynamicTraceRecord> records() const {
+    return makeArrayRef(reinterpret_cast<const DynamicTraceRecord *>(
+                            File->getBufferStart() + sizeof(DynamicTraceHeader)),
+                        Header->NRecords);
+  }
+};
+
+} // end namespace llvm
+
+#endif
@@ -0,0 +1,169 @@
+//=------------------- llvm/Support/FenwickReuseTree.h -----======= -*- C++ -*//
+//
+//                     The LLVM Compiler Infrastructure
+//
+//===----------------------------------------------------------------------===//
+//
+// Set of last-access timestamps, each with the address accessed, used to
+// compute reuse distances. It replaces the size-augmented splay trees for
+// keys inserted in non-decreasing order.
+//
+// The keys are stored in the slots of a table in the order they are inserted,
+// and a Fenwick tree over the slots counts the live ones, so counting the
+// keys not smaller than a given one takes two O(log n) searches on arrays and
+// no node is allocated per access. When the keys reach the end of the slots,
+// the live ones are compacted from zero into a table of at least twice their
+// number.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_FENWICK_REUSE_TREE_H
+#define LLVM_SUPPORT_FENWICK_REUSE_TREE_H
+
+#include "llvm/Support/ErrorHandling.h"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace llvm {
+
+class FenwickReuseTree {
+public:
+  FenwickReuseTree() { clear(); }
+
+  unsigned size() const { return NLive; }
+  bool empty() const { return NLive == 0; }
+
+  // Inserts Key, which cannot be smaller than the keys inserted before.
+  // Returns false, as insert_node does, if Key is already in the tree.
+  bool insert(uint64_t Key, uint64_t Address) {
+    if (End != 0 && Key < Keys[End - 1])
+      report_fatal_error("Keys of a FenwickReuseTree must not decrease");
+    if (find(Key) != End)
+      return false;
+    if (End == Keys.size())
+      compact();
+    Keys[End] = Key;
+    Addresses[End] = Address;
+    Live[End] = true;
+    update(End++, 1);
+    NLive++;
+    return true;
+  }
+
+  // Number of keys greater than or equal to Key.
+  unsigned countFrom(uint64_t Key) const {
+    return NLive - countBefore(lowerBound(Key));
+  }
+
+  // Reuse distance of Key, as SplayTree::reuse_distance computes it: the
+  // number of keys greater than Key, plus one for Key itself. The successor
+  // of a missing Key is not counted.
+  unsigned reuseDistance(uint64_t Key) const {
+    unsigned Count = countFrom(Key);
+    if (Count != 0 && find(Key) == End)
+      Count--;
+    return Count;
+  }
+
+  // Returns false if Key is not in the tree.
+  bool lookup(uint64_t Key, uint64_t &Address) const {
+    size_t Slot = find(Key);
+    if (Slot == End)
+      return false;
+    Address = Addresses[Slot];
+    return true;
+  }
+
+  // Returns false if Key is not in the tree.
+  bool erase(uint64_t Key) {
+    size_t Slot = find(Key);
+    if (Slot == End)
+      return false;
+    Live[Slot] = false;
+    update(Slot, -1);
+    NLive--;
+    return true;
+  }
+
+  void clear() { reset(MinSlots); }
+
+private:
+  static const size_t MinSlots = 1024;
+
+  void reset(size_t NSlots) {
+    Keys.assign(NSlots, 0);
+    Addresses.assign(NSlots, 0);
+    Live.assign(NSlots, false);
+    Tree.assign(NSlots + 1, 0);
+    End = 0;
+    NLive = 0;
+  }
+
+  // First slot whose key is not smaller than Key.
+  size_t lowerBound(uint64_t Key) const {
+    return std::lower_bound(Keys.begin(), Keys.begin() + End, Key) -
+           Keys.begin();
+  }
+
+  // Slot of the live Key, or End. Erased copies of Key may precede it.
+  size_t find(uint64_t Key) const {
+    for (size_t Slot = lowerBound(Key); Slot < End && Keys[Slot] == Key;
+         Slot++)
+      if (Live[Slot])
+        return Slot;
+    return End;
+  }
+
+  void update(size_t Slot, int Delta) {
+    for (size_t i = Slot + 1; i < Tree.size(); i += i & -i)
+      Tree[i] += Delta;
+  }
+
+  // Number of live keys in the slots before Slot.
+  unsigned countBefore(size_t Slot) const {
+    unsigned Count = 0;
+    for (size_t i = Slot; i != 0; i -= i & -i)
+      Count += Tree[i];
+    return Count;
+  }
+
+  void compact() {
+    size_t NSlots = MinSlots;
+    while (NSlots < 2 * (size_t)NLive)
+      NSlots *= 2;
+    size_t Slot = 0;
+    for (size_t i = 0; i < End; i++)
+      if (Live[i]) {
+        Keys[Slot] = Keys[i];
+        Addresses[Slot++] = Addresses[i];
+      }
+    Keys.resize(NSlots);
+    Addresses.resize(NSlots);
+    Live.assign(NSlots, false);
+    Tree.assign(NSlots + 1, 0);
+    // Build the Fenwick tree of the compacted slots in linear time.
+    for (size_t i = 1; i <= NSlots; i++) {
+      if (i <= Slot) {
+        Live[i - 1] = true;
+        Tree[i] += 1;
+      }
+      size_t Parent = i + (i & -i);
+      if (Parent < Tree.size())
+        Tree[Parent] += Tree[i];
+    }
+    End = Slot;
+  }
+
+  std::vector<uint64_t> Keys;
+  std::vector<uint64_t> Addresses;
+  std::vector<bool> Live;
+  // Fenwick tree over the slots, 1-based.
+  std::vector<int> Tree;
+  size_t End;
+  unsigned NLive;
+};
+
+} // end namespace llvm
+
+#endif
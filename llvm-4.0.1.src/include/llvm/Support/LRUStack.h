@@ -0,0 +1,146 @@
+//=------------------- llvm/Support/LRUStack.h -------------======= -*- C++ -*//
+//
+//                     The LLVM Compiler Infrastructure
+//
+//===----------------------------------------------------------------------===//
+//
+// Stack of distinct elements in least recently used order, used to model the
+// register file. Positions are counted from the least recently used element.
+//
+// Every push gives the element a new stamp, and the element is stored in the
+// slot of its stamp. A hash map gives the stamp of an element, and a Fenwick
+// tree over the slots counts the elements with a smaller stamp, so finding the
+// position of an element, moving it to the top and removing it take O(log n).
+// When the stamps reach the end of the slots, the elements are renumbered from
+// zero into a table of at least twice their number.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_LRU_STACK_H
+#define LLVM_SUPPORT_LRU_STACK_H
+
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+namespace llvm {
+
+template <typename T, typename Hash = std::hash<T>> class LRUStack {
+public:
+  LRUStack() { reset(MinSlots); }
+
+  unsigned size() const { return Stamps.size(); }
+  bool empty() const { return Stamps.empty(); }
+
+  // Position of Element, or -1 if it is not in the stack.
+  int position(const T &Element) const {
+    typename StampMap::const_iterator It = Stamps.find(Element);
+    if (It == Stamps.end())
+      return -1;
+    return countBefore(It->second);
+  }
+
+  // Pushes Element as the most recently used one. If it was already in the
+  // stack, it is moved to the top.
+  void push(const T &Element) {
+    remove(Element);
+    if (NextStamp == Slots.size())
+      renumber();
+    Slots[NextStamp] = Element;
+    Used[NextStamp] = true;
+    update(NextStamp, true);
+    Stamps[Element] = NextStamp++;
+  }
+
+  // Returns false if Element is not in the stack.
+  bool remove(const T &Element) {
+    typename StampMap::iterator It = Stamps.find(Element);
+    if (It == Stamps.end())
+      return false;
+    Used[It->second] = false;
+    update(It->second, false);
+    Stamps.erase(It);
+    return true;
+  }
+
+  // Least recently used element.
+  const T &front() const {
+    assert(!empty() && "front() of an empty stack");
+    return Slots[select(0)];
+  }
+
+  void pop_front() { remove(front()); }
+
+  // Element at Position, starting from the least recently used one.
+  const T &at(unsigned Position) const {
+    assert(Position < size() && "at() out of range");
+    return Slots[select(Position)];
+  }
+
+  void clear() { reset(MinSlots); }
+
+private:
+  typedef std::unordered_map<T, size_t, Hash> StampMap;
+  static const size_t MinSlots = 64;
+
+  void reset(size_t NSlots) {
+    Stamps.clear();
+    Slots.assign(NSlots, T());
+    Used.assign(NSlots, false);
+    Tree.assign(NSlots + 1, 0);
+    NextStamp = 0;
+  }
+
+  void update(size_t Stamp, bool Add) {
+    for (size_t i = Stamp + 1; i < Tree.size(); i += i & -i)
+      if (Add)
+        Tree[i]++;
+      else
+        Tree[i]--;
+  }
+
+  // Number of elements with a stamp smaller than Stamp.
+  unsigned countBefore(size_t Stamp) const {
+    unsigned Count = 0;
+    for (size_t i = Stamp; i != 0; i -= i & -i)
+      Count += Tree[i];
+    return Count;
+  }
+
+  // Stamp of the element at Position.
+  size_t select(unsigned Position) const {
+    size_t Stamp = 0;
+    for (size_t Step = Slots.size(); Step != 0; Step /= 2)
+      if (Stamp + Step < Tree.size() && Tree[Stamp + Step] <= Position) {
+        Stamp += Step;
+        Position -= Tree[Stamp];
+      }
+    return Stamp;
+  }
+
+  void renumber() {
+    std::vector<T> Elements;
+    for (size_t Stamp = 0; Stamp < NextStamp; Stamp++)
+      if (Used[Stamp])
+        Elements.push_back(Slots[Stamp]);
+    size_t NSlots = MinSlots;
+    while (NSlots < 2 * Elements.size())
+      NSlots *= 2;
+    reset(NSlots);
+    for (size_t i = 0; i < Elements.size(); i++)
+      push(Elements[i]);
+  }
+
+  StampMap Stamps;
+  std::vector<T> Slots;
+  std::vector<bool> Used;
+  // Fenwick tree over the slots, 1-based.
+  std::vector<unsigned> Tree;
+  size_t NextStamp;
+};
+
+} // end namespace llvm
+
+#endif
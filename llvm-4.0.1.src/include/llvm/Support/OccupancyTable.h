@@ -0,0 +1,93 @@
+//=------------------ llvm/Support/OccupancyTable.h ----------======= -*- C++ -*//
+//
+//                     The LLVM Compiler Infrastructure
+//
+//===----------------------------------------------------------------------===//
+//
+// Per-resource table of the cycles that are available for issue, i.e., the
+// cycles where something has been scheduled without the level getting full,
+// plus the next cycle after a level that got full.
+//
+// Almost every query of the scheduler falls within a few hundred cycles of
+// the fetch cycle, so the table keeps a window of consecutive cycles in a
+// circular array, with a presence bit per cycle. Cycles outside the window
+// are kept in an ordered overflow map. The window is moved forward with
+// advance() as the fetch cycle progresses.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_OCCUPANCY_TABLE_H
+#define LLVM_SUPPORT_OCCUPANCY_TABLE_H
+
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace llvm {
+
+struct OccupancyEntry {
+  OccupancyEntry()
+      : issueOccupancy(0), widthOccupancy(0), occupancyPrefetch(0),
+        issuePorts(0) {}
+
+  int32_t issueOccupancy;
+  int32_t widthOccupancy;
+  int32_t occupancyPrefetch;
+  // Bit p is set if an instruction was dispatched to port PORT_0 + p.
+  uint64_t issuePorts;
+#ifdef SOURCE_CODE_ANALYSIS
+  std::vector<std::pair<unsigned, unsigned>> SourceCodeLinesOperationPair;
+#endif
+};
+
+class OccupancyTable {
+public:
+  // WindowSize must be a power of two and a multiple of 64.
+  explicit OccupancyTable(unsigned WindowSize = 1024);
+
+  // Returns the entry of Cycle, or NULL if the cycle is not in the table.
+  OccupancyEntry *find(uint64_t Cycle);
+
+  // Returns the entry of Cycle, creating an empty one if needed. The
+  // reference is valid until the next insert, erase or advance.
+  OccupancyEntry &insert(uint64_t Cycle);
+
+  void erase(uint64_t Cycle);
+
+  // Sets Next to the smallest cycle in the table that is not smaller than
+  // Cycle. Returns false if there is none.
+  bool findNext(uint64_t Cycle, uint64_t &Next) const;
+
+  // Cycle is the current fetch cycle. The window is moved in steps of a
+  // quarter of its size, so that it always starts a little before Cycle.
+  void advance(uint64_t Cycle) {
+    if (Cycle >= Base + Size / 2)
+      slide(Cycle - Size / 4);
+  }
+
+  bool empty() const { return NPresent == 0 && Overflow.empty(); }
+  void clear();
+
+private:
+  bool inWindow(uint64_t Cycle) const {
+    return Cycle >= Base && Cycle - Base < Size;
+  }
+  bool isPresent(unsigned Slot) const {
+    return (Present[Slot / 64] >> (Slot % 64)) & 1;
+  }
+  unsigned findPresentSlot(unsigned From, unsigned To) const;
+  void slide(uint64_t NewBase);
+
+  unsigned Size;
+  unsigned Mask;
+  uint64_t Base;
+  unsigned NPresent;
+  std::vector<OccupancyEntry> Entries;
+  std::vector<uint64_t> Present;
+  std::map<uint64_t, OccupancyEntry> Overflow;
+};
+
+} // end namespace llvm
+
+#endif
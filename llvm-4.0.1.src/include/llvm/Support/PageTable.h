@@ -0,0 +1,137 @@
+//=------------------- llvm/Support/PageTable.h ------------======= -*- C++ -*//
+//
+//                     The LLVM Compiler Infrastructure
+//
+//===----------------------------------------------------------------------===//
+//
+// Map from 64-bit keys to values for key sets that are dense in a few
+// regions, such as the cache lines and addresses touched by a kernel.
+//
+// A key is split into a page number and an offset. Pages of 2^LogPageSize
+// values are allocated on the first write to one of their keys, and found
+// through a hash map of page numbers in front of which the last page used is
+// cached. Each value covers 2^LogGranularity consecutive keys, of which only
+// the first one is stored in the page; the other keys go to a hash map.
+// A value that was never written reads as T().
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_PAGE_TABLE_H
+#define LLVM_SUPPORT_PAGE_TABLE_H
+
+#include "llvm/ADT/DenseMap.h"
+#include <cstdint>
+
+namespace llvm {
+
+template <typename T, unsigned LogPageSize, unsigned LogGranularity = 0>
+class PageTable {
+  static_assert(LogPageSize + LogGranularity > 0, "Page numbers must be "
+                "smaller than the keys");
+
+public:
+  PageTable() : LastPageNumber(~0ULL), LastPage(nullptr) {}
+  PageTable(const PageTable &) = delete;
+  PageTable &operator=(const PageTable &) = delete;
+  ~PageTable() { clear(); }
+
+  T lookup(uint64_t Key) const {
+    if (Key & GranularityMask) {
+      typename OverflowMap::const_iterator It = Overflow.find(Key);
+      return It == Overflow.end() ? T() : It->second;
+    }
+    const T *Page = findPage(Key >> PageShift);
+    return Page ? Page[offset(Key)] : T();
+  }
+
+  T &operator[](uint64_t Key) {
+    if (Key & GranularityMask)
+      return Overflow[Key];
+    uint64_t PageNumber = Key >> PageShift;
+    T *Page = findPage(PageNumber);
+    if (!Page) {
+      Page = new T[PageSize]();
+      Pages[PageNumber] = Page;
+      LastPageNumber = PageNumber;
+      LastPage = Page;
+    }
+    return Page[offset(Key)];
+  }
+
+  // Number of values held, in the pages and in the overflow map.
+  size_t footprint() const {
+    return Pages.size() * (size_t)PageSize + Overflow.size();
+  }
+
+  // Resets the values for which Pred is true, and frees the pages left with
+  // only such values.
+  template <typename Predicate> void resetIf(Predicate Pred) {
+    for (typename PageMap::iterator It = Pages.begin(), E = Pages.end();
+         It != E;) {
+      typename PageMap::iterator Current = It++;
+      T *Page = Current->second;
+      bool AllReset = true;
+      for (unsigned i = 0; i < PageSize; i++) {
+        if (Pred(Page[i]))
+          Page[i] = T();
+        else
+          AllReset = false;
+      }
+      if (AllReset) {
+        delete[] Page;
+        Pages.erase(Current);
+      }
+    }
+    for (typename OverflowMap::iterator It = Overflow.begin(),
+                                        E = Overflow.end();
+         It != E;) {
+      typename OverflowMap::iterator Current = It++;
+      if (Pred(Current->second))
+        Overflow.erase(Current);
+    }
+    LastPageNumber = ~0ULL;
+    LastPage = nullptr;
+  }
+
+  void clear() {
+    for (typename PageMap::iterator It = Pages.begin(), E = Pages.end();
+         It != E; ++It)
+      delete[] It->second;
+    Pages.clear();
+    Overflow.clear();
+    LastPageNumber = ~0ULL;
+    LastPage = nullptr;
+  }
+
+private:
+  typedef DenseMap<uint64_t, T *> PageMap;
+  typedef DenseMap<uint64_t, T> OverflowMap;
+  static const unsigned PageSize = 1U << LogPageSize;
+  static const unsigned PageShift = LogPageSize + LogGranularity;
+  static const uint64_t GranularityMask = (1ULL << LogGranularity) - 1;
+
+  static unsigned offset(uint64_t Key) {
+    return (Key >> LogGranularity) & (PageSize - 1);
+  }
+
+  // Page numbers are below 2^64 >> PageShift, so ~0ULL never names a page.
+  T *findPage(uint64_t PageNumber) const {
+    if (PageNumber == LastPageNumber)
+      return LastPage;
+    typename PageMap::const_iterator It = Pages.find(PageNumber);
+    if (It == Pages.end())
+      return nullptr;
+    LastPageNumber = PageNumber;
+    LastPage = It->second;
+    return LastPage;
+  }
+
+  PageMap Pages;
+  OverflowMap Overflow;
+  mutable uint64_t LastPageNumber;
+  mutable T *LastPage;
+};
+
+} // end namespace llvm
+
+#endif
@@ -0,0 +1,94 @@
+//=------------------- llvm/Support/SpanIntervals.h --------======= -*- C++ -*//
+//
+//                     The LLVM Compiler Infrastructure
+//
+//===----------------------------------------------------------------------===//
+//
+// Set of cycles stored as sorted, disjoint and non-adjacent half-open
+// intervals. DynamicAnalysis keeps the spans of the resources in this form
+// once they have been computed. Resource activity comes in bursts, so a span
+// takes memory proportional to its number of bursts instead of one bit per
+// simulated cycle.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_SPAN_INTERVALS_H
+#define LLVM_SUPPORT_SPAN_INTERVALS_H
+
+#include <cstdint>
+#include <vector>
+
+namespace llvm {
+
+class SpanIntervals {
+public:
+  struct Interval {
+    uint64_t Begin;
+    uint64_t End;
+  };
+  typedef std::vector<Interval>::const_iterator const_iterator;
+
+  SpanIntervals() : NCycles(0) {}
+
+  // Adds the cycles [Begin, End), which must not start before the end of the
+  // last interval.
+  void append(uint64_t Begin, uint64_t End);
+
+  // Adds the cycles [Begin, End), which may overlap the last interval but
+  // must not start before it.
+  void cover(uint64_t Begin, uint64_t End);
+
+  // Number of cycles in the set.
+  uint64_t count() const { return NCycles; }
+  bool empty() const { return NCycles == 0; }
+  void clear();
+
+  // Whether Cycle is in the set, in logarithmic time.
+  bool contains(uint64_t Cycle) const;
+
+  const_iterator begin() const { return Intervals.begin(); }
+  const_iterator end() const { return Intervals.end(); }
+
+  // Cycles that are in at least MinSets and at most MaxSets of Sets. MinSets
+  // must be at least one.
+  static SpanIntervals combine(const std::vector<const SpanIntervals *> &Sets,
+                               unsigned MinSets, unsigned MaxSets);
+
+  // Number of cycles in the union of Sets, restricted to Mask if it is not
+  // NULL.
+  static uint64_t countUnion(const std::vector<const SpanIntervals *> &Sets,
+                             const SpanIntervals *Mask = nullptr);
+
+  // Number of cycles in all of Sets.
+  static uint64_t
+  countIntersection(const std::vector<const SpanIntervals *> &Sets);
+
+  // Cycles in exactly one of A and B.
+  static SpanIntervals symmetricDifference(const SpanIntervals &A,
+                                           const SpanIntervals &B);
+
+  // Answers membership queries for non-decreasing cycles in amortized
+  // constant time.
+  class Cursor {
+  public:
+    explicit Cursor(const SpanIntervals &Set)
+        : It(Set.Intervals.begin()), End(Set.Intervals.end()) {}
+    bool contains(uint64_t Cycle) {
+      while (It != End && It->End <= Cycle)
+        ++It;
+      return It != End && It->Begin <= Cycle;
+    }
+
+  private:
+    const_iterator It;
+    const_iterator End;
+  };
+
+private:
+  std::vector<Interval> Intervals;
+  uint64_t NCycles;
+};
+
+} // end namespace llvm
+
+#endif
@@ -0,0 +1,91 @@
+//=------------------- llvm/Support/TimedBuffer.h ----------======= -*- C++ -*//
+//
+//                     The LLVM Compiler Infrastructure
+//
+//===----------------------------------------------------------------------===//
+//
+// Multiset of cycles used to model the out-of-order buffers (reservation
+// station, load, store and line fill buffers). Each element is the cycle at
+// which an entry leaves the buffer, and entries leave in cycle order.
+//
+// The cycles are kept sorted in a vector, with the expired ones at the front
+// skipped through an index. The minimum and the k-th smallest cycle are
+// direct accesses, expiring is a binary search, and counting the cycles up to
+// a given one is a binary search. Inserting moves the cycles larger than the
+// new one, which are few because cycles arrive almost in increasing order.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_TIMED_BUFFER_H
+#define LLVM_SUPPORT_TIMED_BUFFER_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+namespace llvm {
+
+template <typename T> class TimedBuffer {
+public:
+  typedef typename std::vector<T>::const_iterator const_iterator;
+
+  TimedBuffer() : Head(0) {}
+
+  size_t size() const { return Cycles.size() - Head; }
+  bool empty() const { return Head == Cycles.size(); }
+
+  const_iterator begin() const { return Cycles.begin() + Head; }
+  const_iterator end() const { return Cycles.end(); }
+
+  void insert(T Cycle) {
+    if (Cycles.size() == Head || Cycles.back() <= Cycle) {
+      Cycles.push_back(Cycle);
+      return;
+    }
+    Cycles.insert(std::upper_bound(Cycles.begin() + Head, Cycles.end(), Cycle),
+                  Cycle);
+  }
+
+  // Smallest cycle in the buffer.
+  T min() const {
+    assert(!empty() && "min() of an empty buffer");
+    return Cycles[Head];
+  }
+
+  // K-th smallest cycle in the buffer, starting from 0.
+  T kth(size_t K) const {
+    assert(K < size() && "kth() out of range");
+    return Cycles[Head + K];
+  }
+
+  // Number of cycles in the buffer that are not larger than Cycle.
+  size_t countNotAfter(T Cycle) const {
+    return std::upper_bound(begin(), end(), Cycle) - begin();
+  }
+
+  // Removes all the cycles that are not larger than Cycle.
+  void expire(T Cycle) {
+    Head += countNotAfter(Cycle);
+    if (Head == Cycles.size()) {
+      Cycles.clear();
+      Head = 0;
+    } else if (Head >= 64 && Head >= Cycles.size() / 2) {
+      Cycles.erase(Cycles.begin(), Cycles.begin() + Head);
+      Head = 0;
+    }
+  }
+
+  void clear() {
+    Cycles.clear();
+    Head = 0;
+  }
+
+private:
+  std::vector<T> Cycles;
+  size_t Head;
+};
+
+} // end namespace llvm
+
+#endif
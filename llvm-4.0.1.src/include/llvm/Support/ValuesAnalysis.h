@@ -38,15 +38,15 @@ bool operator< (const PointerToMemory& a, const PointerToMemory& b )
 
 bool operator== ( PointerToMemoryInstance a, PointerToMemoryInstance b )
 {
-  return std::tie(a.PTM,  a.Rep, a.IterationCount) == std::tie(b.PTM,  b.Rep,
-                                                               b.IterationCount);
+  return std::tie(a.PTMindex, a.Rep, a.IterationCount) ==
+         std::tie(b.PTMindex, b.Rep, b.IterationCount);
 }
 
 
 bool operator <(const PointerToMemoryInstance& x, const PointerToMemoryInstance& y)
 {
-  return std::tie(x.PTM, x.Rep,x.IterationCount) < std::tie(y.PTM, y.Rep,
-                                                            y.IterationCount);
+  return std::tie(x.PTMindex, x.Rep, x.IterationCount) <
+         std::tie(y.PTMindex, y.Rep, y.IterationCount);
 }
 
 
@@ -60,12 +60,27 @@ DynamicAnalysis::printInstructionValue(InstructionValue IV)
 void
 DynamicAnalysis::printPointerToMemoryInstance(PointerToMemoryInstance PTMI)
 {
-  printPointerToMemory(PTMI.PTM);
+  printPointerToMemory(PointersToMemory[PTMI.PTMindex]);
   DEBUG(dbgs() << ", "<< PTMI.Rep);
   DEBUG(dbgs() << ", "<< PTMI.IterationCount);
 }
 
 
+unsigned
+DynamicAnalysis::getPointerToMemoryIndex(const PointerToMemory &PTM)
+{
+  std::pair<DenseMap<PointerToMemory, unsigned>::iterator, bool> Inserted =
+  PointerToMemoryIndexMap.insert(std::make_pair(PTM, PointersToMemory.size()));
+  if(Inserted.second){
+    if(PointersToMemory.size() >= DenseMapInfo<PointerToMemoryInstance>::
+       getTombstoneKey().PTMindex)
+      report_fatal_error("Too many pointers to memory");
+    PointersToMemory.push_back(PTM);
+  }
+  return Inserted.first->second;
+}
+
+
 void
 DynamicAnalysis::printPointerToMemory(PointerToMemory PTM)
 {
@@ -104,10 +119,103 @@ DynamicAnalysis::increaseNUses(PointerToMemoryInstance PTMI)
 }
 
 
+// Only called in the analysis run. The warm-up run only increases the
+// counts, which are the uses left for the analysis run, so no instance dies
+// before the analysis run starts.
 void
 DynamicAnalysis::decreaseNUses(PointerToMemoryInstance PTMI)
 {
-  PointerToMemoryInstanceNUsesMap[PTMI]--;
+  if(--PointerToMemoryInstanceNUsesMap[PTMI] == 0)
+    DeadPointerToMemoryInstances.push_back(PTMI);
+}
+
+
+// Operands are always looked up at the latest executed instance of their
+// instruction value, so older instances of an instruction are never looked up
+// again. Pointers to memory with offsets are not instructions and are kept.
+bool
+DynamicAnalysis::isStalePointerToMemoryInstance(PointerToMemoryInstance PTMI)
+{
+  const PointerToMemory &PTM = PointersToMemory[PTMI.PTMindex];
+  if(PTM.Offset1 != NULL)
+    return false;
+  int64_t NextInstance = getInstructionValueInstance({PTM.BasePointer,
+                                                      PTMI.Rep});
+  if(NextInstance < 2)
+    return false;
+  return PTMI.IterationCount == -1 || PTMI.IterationCount < NextInstance - 1;
+}
+
+
+// Reclaims the instances with no uses left that are not in the register
+// stack, together with the stale instruction instances associated to them.
+// An instance still associated to an instruction instance that may be looked
+// up again is retried in a later batch. Nothing is reclaimed in the warm-up
+// run, so the peak of these tables is reached at its end.
+void
+DynamicAnalysis::collectDeadPointerToMemoryInstances()
+{
+  if(DeadPointerToMemoryInstances.size() <
+     NextDeadPointerToMemoryInstancesCollection)
+    return;
+  
+  vector<PointerToMemoryInstance> Pending;
+  DenseMap<PointerToMemoryInstance, bool> Dead;
+  for(unsigned i = 0; i < DeadPointerToMemoryInstances.size(); i++){
+    PointerToMemoryInstance PTMI = DeadPointerToMemoryInstances[i];
+    PointerToMemoryInstanceNUsesMapIterator nUsesit =
+    PointerToMemoryInstanceNUsesMap.find(PTMI);
+    if(nUsesit == PointerToMemoryInstanceNUsesMap.end() ||
+       nUsesit->second != 0)
+      continue;
+    // Not checkRegisterStackReuseDistance, which moves PTMI to the top
+#ifdef STACK_DEQUE
+    bool InStack = find(ReuseStack.begin(), ReuseStack.end(), PTMI) !=
+    ReuseStack.end();
+#else
+    bool InStack = ReuseStack.position(PTMI) >= 0;
+#endif
+    if(InStack)
+      Pending.push_back(PTMI);
+    else
+      Dead[PTMI] = false;
+  }
+  
+  // Erasing from a DenseMap does not invalidate the other iterators.
+  for(PointerToMemoryInstanceMapIterator it = PointerToMemoryInstanceMap.begin(),
+      E = PointerToMemoryInstanceMap.end(); it != E;){
+    PointerToMemoryInstanceMapIterator Current = it++;
+    DenseMap<PointerToMemoryInstance, bool>::iterator DeadIt =
+    Dead.find(Current->second);
+    if(DeadIt == Dead.end())
+      continue;
+    if(isStalePointerToMemoryInstance(Current->first))
+      PointerToMemoryInstanceMap.erase(Current);
+    else
+      DeadIt->second = true;
+  }
+  
+  for(DenseMap<PointerToMemoryInstance, bool>::iterator it = Dead.begin(),
+      E = Dead.end(); it != E; ++it){
+    if(it->second){
+      Pending.push_back(it->first);
+    }else{
+      PointerToMemoryInstanceNUsesMap.erase(it->first);
+      PointerToMemoryInstanceAddresses.erase(it->first);
+    }
+  }
+  compactDenseMap(PointerToMemoryInstanceMap);
+  compactDenseMap(PointerToMemoryInstanceNUsesMap);
+  PointerToMemoryInstanceAddresses.compact();
+  
+  // Scanning PointerToMemoryInstanceMap is linear in its size, so wait for a
+  // batch proportional to it, and to the instances that could not be
+  // reclaimed yet.
+  DeadPointerToMemoryInstances.swap(Pending);
+  NextDeadPointerToMemoryInstancesCollection =
+  max(max((size_t)MinDeadPointerToMemoryInstancesBatch,
+          2 * DeadPointerToMemoryInstances.size()),
+      (size_t)PointerToMemoryInstanceMap.size() / 4);
 }
 
 
@@ -176,7 +284,7 @@ DynamicAnalysis::insertOperandsInRegisterStack(int i, Instruction & I,
   PointerToMemory operandPTM;
   PointerToMemoryInstance operandPTMI;
   PointerToMemoryInstance associatedPTMI =
-  {{NULL,NULL,NULL,NULL, NULL, NULL},0,-1};
+  {getPointerToMemoryIndex({NULL, NULL, NULL, NULL, NULL, NULL}), 0, -1};
   int64_t operandValueInstance;
   vector<PointerToMemoryInstance> associatedPTMIvector ;
   vector<unsigned> associatedPTMIindexesvector ;
@@ -208,7 +316,8 @@ DynamicAnalysis::insertOperandsInRegisterStack(int i, Instruction & I,
     operandValueInstance = operandValueInstance-1;
     
     operandPTM = {&I,NULL, NULL, NULL, NULL, NULL};
-    operandPTMI = {operandPTM,operandRepetition,operandValueInstance};
+    operandPTMI = {getPointerToMemoryIndex(operandPTM),
+      operandRepetition, operandValueInstance};
     associatedPTMI = operandPTMI;
   }else{
     if(dyn_cast<Constant> (I.getOperand(i)))
@@ -257,7 +366,8 @@ DynamicAnalysis::insertOperandsInRegisterStack(int i, Instruction & I,
               
               candidatePTM =
               {originalIncomingEdges.at(i), NULL, NULL, NULL, NULL, NULL};
-              candidatePTMI = {candidatePTM, 0, originalIncomingEdgeInstance};
+              candidatePTMI = {getPointerToMemoryIndex(candidatePTM),
+                0, originalIncomingEdgeInstance};
               
               PointerToMemoryInstanceMapIterator it =
               PointerToMemoryInstanceMap.find(candidatePTMI);
@@ -297,10 +407,12 @@ DynamicAnalysis::insertOperandsInRegisterStack(int i, Instruction & I,
           int SIToFPInstValueInstance =
           getInstructionValueInstance(SIToFPInstValue);
           if(SIToFPI)
-          operandPTMI = {{SIToFPI, NULL, NULL, NULL, NULL, NULL},
+          operandPTMI = {getPointerToMemoryIndex({SIToFPI, NULL, NULL, NULL,
+                                                  NULL, NULL}),
             0, SIToFPInstValueInstance};
           else if(UIToFPI){
-            operandPTMI = {{UIToFPI, NULL, NULL, NULL, NULL, NULL},
+            operandPTMI = {getPointerToMemoryIndex({UIToFPI, NULL, NULL, NULL,
+                                                    NULL, NULL}),
               0,SIToFPInstValueInstance};
           }else
           report_fatal_error("Instruction not SIToFPInst or  UIToFPInst\n");
@@ -351,7 +463,8 @@ DynamicAnalysis::insertOperandsInRegisterStack(int i, Instruction & I,
                 BIValueInstance = BIValueInstance-1;
               }
               operandPTMI =
-              {{BI, NULL, NULL, NULL, NULL, NULL},0,BIValueInstance};
+              {getPointerToMemoryIndex({BI, NULL, NULL, NULL, NULL, NULL}),
+                0, BIValueInstance};
               associatedPTMI = operandPTMI;
               if(WarmRun){
                 insertAssociatedPointerToMemoryInstance(operandPTMI,
@@ -393,7 +506,9 @@ DynamicAnalysis::insertOperandsInRegisterStack(int i, Instruction & I,
                 
                 InstructionValue SIValue = {SIV,0};
                 int SIValueInstance =  getInstructionValueInstance(SIValue);
-                operandPTMI = {{SIV, NULL, NULL, NULL, NULL, NULL},0,SIValueInstance};
+                operandPTMI = {getPointerToMemoryIndex({SIV, NULL, NULL, NULL,
+                                                        NULL, NULL}),
+                  0, SIValueInstance};
                 associatedPTMI = operandPTMI;
                 PointerToMemoryInstanceMapIterator it =
                 PointerToMemoryInstanceMap.find(operandPTMI);
@@ -426,7 +541,8 @@ DynamicAnalysis::insertOperandsInRegisterStack(int i, Instruction & I,
                 operandValueInstance = operandValueInstance-1;
               
               operandPTM = {I.getOperand(i),NULL, NULL, NULL, NULL, NULL};
-              operandPTMI = {operandPTM,operandRepetition,operandValueInstance};
+              operandPTMI = {getPointerToMemoryIndex(operandPTM),
+                operandRepetition, operandValueInstance};
             }
           }
           
@@ -496,9 +612,9 @@ DynamicAnalysis::insertOperandsInRegisterStack(int i, Instruction & I,
         // Use the same instruction to constraint data dependencies.
         if(!WarmRun)
           NRegisterSpillsLoads++;
-        bm_type::left_const_iterator left_iter =
-        PointerToMemoryInstanceAddressBiMap.left.find(associatedPTMI);
-        uint64_t SpillLoadAddress =left_iter->second;
+        uint64_t SpillLoadAddress = 0;
+        PointerToMemoryInstanceAddresses.findAddress(associatedPTMI,
+                                                     SpillLoadAddress);
 
         if(SpillLoadAddress == 0){
           report_fatal_error("Any value loaded that was a spill, should have \
@@ -523,13 +639,11 @@ DynamicAnalysis::insertOperandsInRegisterStack(int i, Instruction & I,
         // Use the same instruction to constraint data dependencies.
         if(!WarmRun)
         NRegisterSpillsLoads++;
-        bm_type::left_const_iterator left_iter =
-        PointerToMemoryInstanceAddressBiMap.left.find(associatedPTMI);
-        if(left_iter == PointerToMemoryInstanceAddressBiMap.left.end()){
+        if(!PointerToMemoryInstanceAddresses.findAddress(associatedPTMI,
+                                                         SpillLoadAddress)){
           report_fatal_error("There is not entry for associatedPTMI in \
-                             PointerToMemoryInstanceAddressBiMap\n");
-        }else
-          SpillLoadAddress=left_iter->second;
+                             PointerToMemoryInstanceAddresses\n");
+        }
 
         if(SpillLoadAddress == 0){
           report_fatal_error("Any value loaded that was a spill, should have an \
@@ -576,8 +690,11 @@ DynamicAnalysis::checkRegisterStackReuseDistance(PointerToMemoryInstance address
     }
   }
 #else
-  if(!ReuseStack.empty())
-    Distance = ReuseStack.findElement(address);
+  // Like the lookup in registerStackReuseDistance, this moves the value to the
+  // top of the stack.
+  Distance = ReuseStack.position(address);
+  if(Distance >= 0)
+    ReuseStack.push(address);
 #endif
   if(Distance > (int)RegisterFileSize)
     report_fatal_error("Distance > RegisterFileSize");
@@ -591,9 +708,9 @@ DynamicAnalysis::removeUnusedSpilledCacheLinesFromReuseTree(){
   PointerToMemoryInstanceNUsesMapIterator nUsesit;
   
   map <uint64_t, uint64_t> CacheLinesUses;
-  for (bm_type::right_iterator right_iter =
-      PointerToMemoryInstanceAddressBiMap.right.begin();
-      right_iter != PointerToMemoryInstanceAddressBiMap.right.end();
+  for (PointerToMemoryInstanceAddressMap::const_iterator right_iter =
+      PointerToMemoryInstanceAddresses.begin();
+      right_iter != PointerToMemoryInstanceAddresses.end();
        right_iter++){
     nUsesit = PointerToMemoryInstanceNUsesMap.find(right_iter->second);
     uint64_t CL = right_iter->first >> BitsPerCacheLine;
@@ -612,7 +729,11 @@ DynamicAnalysis::removeUnusedSpilledCacheLinesFromReuseTree(){
       it != CacheLinesUses.end(); it++){
     if(it->second==0){
       CacheLineInfo Info  = getCacheLineInfo (it->first);
-      ReuseTree=  delete_node(Info.LastAccess, ReuseTree);
+#ifdef SPLAY_REUSE_TREE
+      ReuseTree=  delete_node(Info.LastAccess, ReuseTree, &ReuseTreeNodes);
+#else
+      ReuseTree.erase(Info.LastAccess);
+#endif
     }
   }
 }
@@ -659,13 +780,9 @@ DynamicAnalysis::registerStackReuseDistance(PointerToMemoryInstance address,
     ReuseStack.push_back(address);
   }
 #else
-  if(!ReuseStack.empty()){
-    Distance = ReuseStack.findElement(address);
-    if(Distance >= 0){
-      ReuseStack.removeElement(address);
-      ReuseStack.insertAtBack(address);
-    }
-  }
+  Distance = ReuseStack.position(address);
+  if(Distance >= 0)
+    ReuseStack.push(address);
 #endif
   return Distance;
 }
@@ -687,7 +804,7 @@ void DynamicAnalysis::printRegisterStack()
   unsigned counter = 1;
   for(unsigned i = 0; i< ReuseStack.size(); i++){
     DEBUG( dbgs() <<counter << "\t");
-    printPointerToMemoryInstance(ReuseStack.elementAt(i));
+    printPointerToMemoryInstance(ReuseStack.at(i));
     DEBUG(dbgs()<< "\n");
     counter++;
   }
@@ -710,7 +827,9 @@ DynamicAnalysis::removeRegisterStack(PointerToMemoryInstance address)
   else
     ReuseStack.erase(it);
 #else
-  ReuseStack.removeElement(address);
+  if(ReuseStack.empty())
+    report_fatal_error("Cannot remove an element from an empty list");
+  ReuseStack.remove(address);
 #endif
   
 }
@@ -734,9 +853,9 @@ void DynamicAnalysis::insertRegisterStack(PointerToMemoryInstance address,
     ReuseStack.pop_front();
     ReuseStack.push_back(address);
 #else
-    PointerToMemoryInstance SpilledPointerToMemory = ReuseStack.getFront();
-    ReuseStack.removeFromFront();
-    ReuseStack.insertAtBack(address);
+    PointerToMemoryInstance SpilledPointerToMemory = ReuseStack.front();
+    ReuseStack.pop_front();
+    ReuseStack.push(address);
 #endif
     
     bool forceSpill = true;
@@ -763,8 +882,9 @@ void DynamicAnalysis::insertRegisterStack(PointerToMemoryInstance address,
       bool SpilledValueWasMemOp = true;
       PointerToMemoryInstanceMapIterator it =
       PointerToMemoryInstanceMap.find(SpilledPointerToMemory);
-      bm_type::left_iterator left_iter =
-      PointerToMemoryInstanceAddressBiMap.left.find(SpilledPointerToMemory);
+      uint64_t SpilledAddress;
+      bool SpilledHasAddress = PointerToMemoryInstanceAddresses.
+      findAddress(SpilledPointerToMemory, SpilledAddress);
       
       if(it != PointerToMemoryInstanceMap.end() ){
         if(it->second == SpilledPointerToMemory)
@@ -780,7 +900,7 @@ void DynamicAnalysis::insertRegisterStack(PointerToMemoryInstance address,
       if(WarmRun){
         if(SpilledValueWasMemOp == false){
           // Check whether there is an associated address
-          if(left_iter == PointerToMemoryInstanceAddressBiMap.left.end()){
+          if(!SpilledHasAddress){
             // Make sure that the memAddress does not exist
             // If the spill is triggered by an artificial mem op, then the
             // artificial address assigned to the spill and the address of the
@@ -791,42 +911,33 @@ void DynamicAnalysis::insertRegisterStack(PointerToMemoryInstance address,
               GlobalAddrForArtificialMemOps = getNextArtificialAddress();
             
             MemAddress = GlobalAddrForArtificialMemOps;
-            bm_type::right_iterator address_iter =
-            PointerToMemoryInstanceAddressBiMap.right.find(MemAddress);
-            if(address_iter != PointerToMemoryInstanceAddressBiMap.right.end())
+            if(PointerToMemoryInstanceAddresses.hasAddress(MemAddress))
               report_fatal_error("Trying to insert an entry in \
-                                 PointerToMemoryInstanceAddressBiMap for an \
+                                 PointerToMemoryInstanceAddresses for an \
                                  address that exists already");
             
-            bm_type::left_iterator PTMI_iter =
-            PointerToMemoryInstanceAddressBiMap.left.find(SpilledPointerToMemory);
-            
-            if(PTMI_iter != PointerToMemoryInstanceAddressBiMap.left.end())
-              report_fatal_error("Trying to insert an entry in \
-                                 PointerToMemoryInstanceAddressBiMap for a PTMI \
-                                 that exists already");
-            PointerToMemoryInstanceAddressBiMap.
-            insert(bm_type::value_type(SpilledPointerToMemory,MemAddress));
+            PointerToMemoryInstanceAddresses.insert(SpilledPointerToMemory,
+                                                    MemAddress);
             GlobalAddrForArtificialMemOps = getNextArtificialAddress();
           }else
-            MemAddress = left_iter->second;
+            MemAddress = SpilledAddress;
         }else{
           // A spilled mem opt must have an associated address.
-          if(left_iter == PointerToMemoryInstanceAddressBiMap.left.end())
+          if(!SpilledHasAddress)
             report_fatal_error("A spill of a mem op should have already an \
                                associated address");
           else
-            MemAddress = left_iter->second;
+            MemAddress = SpilledAddress;
         }
       }else{
         // In analysis run, everything should have an associated address.
         // But still need to make sure that there is an associated address
-        if(left_iter == PointerToMemoryInstanceAddressBiMap.left.end())
+        if(!SpilledHasAddress)
           report_fatal_error("In analysis run, all spills should have already \
                              an associated address, regardless they are mem op \
                              or not");
         else
-          MemAddress = left_iter->second;
+          MemAddress = SpilledAddress;
       }
       
       if(SpilledValueWasMemOp){
@@ -846,7 +957,7 @@ void DynamicAnalysis::insertRegisterStack(PointerToMemoryInstance address,
 #ifdef STACK_DEQUE
     ReuseStack.push_back(address);
 #else
-    ReuseStack.insertAtBack(address);
+    ReuseStack.push(address);
 #endif
   }
 }
@@ -957,7 +1068,7 @@ DynamicAnalysis::insertUsesOfPointerToMemory(Value * v,
           insertUse = true;
           useInstructionValue = {LI, 0};
           instructionPTM = {LI, NULL, NULL, NULL, NULL, NULL};
-          instructionPTMI = {instructionPTM, 0,
+          instructionPTMI = {getPointerToMemoryIndex(instructionPTM), 0,
             getInstructionValueInstance(useInstructionValue)};
           insertAssociatedPointerToMemoryInstance(instructionPTMI, associatedPTMI);
         }
@@ -966,7 +1077,7 @@ DynamicAnalysis::insertUsesOfPointerToMemory(Value * v,
           insertUse = true;
           useInstructionValue = {SI, 0};
           instructionPTM = {SI, NULL, NULL, NULL, NULL, NULL};
-          instructionPTMI = {instructionPTM, 0,
+          instructionPTMI = {getPointerToMemoryIndex(instructionPTM), 0,
             getInstructionValueInstance(useInstructionValue)};
           insertAssociatedPointerToMemoryInstance(instructionPTMI, associatedPTMI);
         }
@@ -975,7 +1086,7 @@ DynamicAnalysis::insertUsesOfPointerToMemory(Value * v,
           insertUse = true;
           useInstructionValue = {CI, 0};
           instructionPTM = {CI, NULL, NULL, NULL, NULL, NULL};
-          instructionPTMI = {instructionPTM, 0,
+          instructionPTMI = {getPointerToMemoryIndex(instructionPTM), 0,
             getInstructionValueInstance(useInstructionValue)};
           insertAssociatedPointerToMemoryInstance(instructionPTMI, associatedPTMI);
         }else if(CI->getCalledFunction()->getName().find("__ct") == string::npos){
@@ -990,7 +1101,7 @@ DynamicAnalysis::insertUsesOfPointerToMemory(Value * v,
                 insertUse = true;
                 useInstructionValue = {*vi, 0};
                 instructionPTM = {*vi, NULL, NULL, NULL, NULL, NULL};
-                instructionPTMI = {instructionPTM, 0,
+                instructionPTMI = {getPointerToMemoryIndex(instructionPTM), 0,
                   getInstructionValueInstance(useInstructionValue)};
                 insertAssociatedPointerToMemoryInstance(instructionPTMI,
                                                         associatedPTMI);
@@ -1080,16 +1191,18 @@ DynamicAnalysis::adjustMemoryAddress(uint64_t addr, uint64_t addrFound,
                   newDuplicatedPMTI.IterationCount++;
                 PointerToMemoryInstanceMap[instructionsPTMI.at(j)]=
                 newDuplicatedPMTI;
-                bm_type::right_iterator address_iter =
-                PointerToMemoryInstanceAddressBiMap.right.find(addrFound);
-                if(address_iter->second == instructionsPTMI.at(i)){
-                  // TODO: check if element inserted exists or not with iterators
-                  PointerToMemoryInstanceAddressBiMap.
-                  insert(bm_type::value_type(instructionsPTMI.at(j),addr));
+                PointerToMemoryInstance addrFoundPTMI;
+                bool addrFoundHasPTMI = PointerToMemoryInstanceAddresses.
+                findInstance(addrFound, addrFoundPTMI);
+                if(addrFoundHasPTMI && addrFoundPTMI == instructionsPTMI.at(i)){
+                  // TODO: check if element inserted exists or not
+                  PointerToMemoryInstanceAddresses.insert(instructionsPTMI.at(j),
+                                                          addr);
                 }else{
-                  if(address_iter->second == instructionsPTMI.at(j)){
-                    PointerToMemoryInstanceAddressBiMap.
-                    insert(bm_type::value_type(instructionsPTMI.at(i),addr));
+                  if(addrFoundHasPTMI &&
+                     addrFoundPTMI == instructionsPTMI.at(j)){
+                    PointerToMemoryInstanceAddresses.
+                    insert(instructionsPTMI.at(i), addr);
                   }else{
                     report_fatal_error("CHECK, there might be more than 2 \
                                        instructionsPTMI with the same associated PTMI");
@@ -1170,20 +1283,15 @@ DynamicAnalysis::managePointerToMemory(PointerToMemoryInstance instructionPTMI,
       //      load/store inst has an address check whether there is an entry in
       //      AddressMap for the given address
       //========================================================================
-      bm_type::right_iterator address_iter =
-      PointerToMemoryInstanceAddressBiMap.right.find(addr);
-      if(address_iter != PointerToMemoryInstanceAddressBiMap.right.end()){
+      if(PointerToMemoryInstanceAddresses.findInstance(addr, associatedPTMI)){
         // =====================================================================
         //  This address already appeared and have an associated pointer to
         //  memory. Associate that pointer to memory to the instructionPTMI
         //======================================================================
         // associatedPTMI already has an entry in addressMap and NUsesMap
-        associatedPTMI = address_iter->second;
         insertAssociatedPointerToMemoryInstance(instructionPTMI, associatedPTMI);
       }else{
-        bm_type::left_iterator P_iter =
-        PointerToMemoryInstanceAddressBiMap.left.find(instructionPTMI);
-        if(P_iter != PointerToMemoryInstanceAddressBiMap.left.end()){
+        if(PointerToMemoryInstanceAddresses.hasInstance(instructionPTMI)){
           report_fatal_error("Case not considered\n");
         }
         // =====================================================================
@@ -1223,7 +1331,7 @@ DynamicAnalysis::managePointerToMemory(PointerToMemoryInstance instructionPTMI,
             for (int instance = valueInstance -1; instance >= 0; instance--){
               if(instance == 0)
                 instance = -1;
-              prevInstructionPTMI = {instructionPTMI.PTM,
+              prevInstructionPTMI = {instructionPTMI.PTMindex,
                 instructionPTMI.Rep, instance};
               prevIt  =  PointerToMemoryInstanceMap.find(prevInstructionPTMI);
               if(prevIt != PointerToMemoryInstanceMap.end()){
@@ -1234,7 +1342,8 @@ DynamicAnalysis::managePointerToMemory(PointerToMemoryInstance instructionPTMI,
                                    associated PTMI");
             }
           }else if(associadtedPTMinstance == 1){
-            associatedPTMI = {associatedPTM, valueRep, -1};
+            associatedPTMI = {getPointerToMemoryIndex(associatedPTM),
+              valueRep, -1};
           }
         }else{
           unsigned operandIndex = 0;
@@ -1266,7 +1375,7 @@ DynamicAnalysis::managePointerToMemory(PointerToMemoryInstance instructionPTMI,
             else if(NOperands == 6)
               associatedPTM = {CE->getOperand(0), CE->getOperand(1),
                 CE->getOperand(2), CE->getOperand(3), CE->getOperand(4), CE->getOperand(5)};
-            associatedPTMI = {associatedPTM, 0, -1};
+            associatedPTMI = {getPointerToMemoryIndex(associatedPTM), 0, -1};
           }else{
             if(dyn_cast<Argument> (I.getOperand(operandIndex))){
               Function * F = (&I)->getParent ()->getParent();
@@ -1278,7 +1387,8 @@ DynamicAnalysis::managePointerToMemory(PointerToMemoryInstance instructionPTMI,
                   loadArgument = true;
                   associatedPTM = {I.getOperand(operandIndex), NULL, NULL,
                     NULL, NULL, NULL};
-                  associatedPTMI = {associatedPTM, 0, -1};
+                  associatedPTMI = {getPointerToMemoryIndex(associatedPTM),
+                    0, -1};
                   break;
                 }
               }
@@ -1296,19 +1406,13 @@ DynamicAnalysis::managePointerToMemory(PointerToMemoryInstance instructionPTMI,
         // of the instruction
         insertAssociatedPointerToMemoryInstance(instructionPTMI, associatedPTMI);
         // Insert address
-        bm_type::left_iterator PTMI_iter =
-        PointerToMemoryInstanceAddressBiMap.left.find(associatedPTMI);
-        if(PTMI_iter != PointerToMemoryInstanceAddressBiMap.left.end()){
-        }else{
-          bm_type::right_iterator address_iter =
-          PointerToMemoryInstanceAddressBiMap.right.find(addr);
-          if(address_iter != PointerToMemoryInstanceAddressBiMap.right.end()){
+        if(!PointerToMemoryInstanceAddresses.hasInstance(associatedPTMI)){
+          if(PointerToMemoryInstanceAddresses.hasAddress(addr)){
             report_fatal_error("Trying to insert an entry in \
-                               PointerToMemoryInstanceAddressBiMap for an \
+                               PointerToMemoryInstanceAddresses for an \
                                address that exists already");
           }
-          PointerToMemoryInstanceAddressBiMap.
-          insert(bm_type::value_type(associatedPTMI,addr));
+          PointerToMemoryInstanceAddresses.insert(associatedPTMI, addr);
         }
       }
     }else{
@@ -1317,10 +1421,9 @@ DynamicAnalysis::managePointerToMemory(PointerToMemoryInstance instructionPTMI,
       // 1.2. The load/store address has an associated pointer to memory.
       //========================================================================
       // Check whether the associatedPTMI already has an address
-      bm_type::left_iterator associatedPTMIAddress_iter =
-      PointerToMemoryInstanceAddressBiMap.left.find(associatedPTMI);
-      
-      if(associatedPTMIAddress_iter == PointerToMemoryInstanceAddressBiMap.left.end()){
+      uint64_t addressFound;
+      if(!PointerToMemoryInstanceAddresses.findAddress(associatedPTMI,
+                                                       addressFound)){
         // ======================================================================
         // The associated PTMI does not have an associated address.
         // In principle, simply set the address to the address of the current
@@ -1347,49 +1450,29 @@ DynamicAnalysis::managePointerToMemory(PointerToMemoryInstance instructionPTMI,
         // which in fact access the same memory location.
         // In this case, stick to the first memory location
         // =====================================================================
-        bm_type::right_iterator addressAssociatedPTMI_iter =
-        PointerToMemoryInstanceAddressBiMap.right.find(addr);
-        if(addressAssociatedPTMI_iter ==
-           PointerToMemoryInstanceAddressBiMap.right.end()){
+        PointerToMemoryInstance existingPTMI;
+        if(!PointerToMemoryInstanceAddresses.findInstance(addr, existingPTMI)){
           // The address does not have another associated PTMI => create an
           // entry for this address and the associatedPTMI
-          bm_type::right_iterator address_iter =
-          PointerToMemoryInstanceAddressBiMap.right.find(addr);
-          if(address_iter != PointerToMemoryInstanceAddressBiMap.right.end()){
-            report_fatal_error("Trying to insert an entry in \
-                               PointerToMemoryInstanceAddressBiMap for an \
-                               address that exists already");
-          }
-          bm_type::left_iterator PTMI_iter =
-          PointerToMemoryInstanceAddressBiMap.left.find(associatedPTMI);
-          if(PTMI_iter != PointerToMemoryInstanceAddressBiMap.left.end()){
-            report_fatal_error("Trying to insert an entry in \
-                               PointerToMemoryInstanceAddressBiMap for a PTMI \
-                               that exists already");
-          }
-          PointerToMemoryInstanceAddressBiMap.
-          insert(bm_type::value_type(associatedPTMI,addr) );
+          PointerToMemoryInstanceAddresses.insert(associatedPTMI, addr);
         }else{
           // Keep the first PTMI
-          PointerToMemoryInstance existingPTMI = addressAssociatedPTMI_iter->second;
           updateAssociatedPointerToMemoryInstance(instructionPTMI, existingPTMI);
           associatedPTMI = existingPTMI;
         }
       }else{
         // If the associatedPTMI has an associated address, compare with the
         // address of the current instruction.
-        uint64_t addressFound = associatedPTMIAddress_iter->second;
         uint64_t finalAddress = 0;
         if(addr!=addressFound){
           finalAddress = adjustMemoryAddress(addr, addressFound,
-                                             associatedPTMIAddress_iter->first,
-                                             forceAnalyze);
+                                             associatedPTMI, forceAnalyze);
           //finalAddress is either addr or addressFound
           if(finalAddress != addr){
             addr = finalAddress;
           }else{
-            PointerToMemoryInstanceAddressBiMap.left.
-            replace_data(associatedPTMIAddress_iter,addr);
+            PointerToMemoryInstanceAddresses.replaceAddress(associatedPTMI,
+                                                            addr);
           }
         }// Else, if addresses are the same, so nothing.
       }
@@ -51,7 +51,9 @@
 */
 
 #include <iostream>
+#include <new>
 #include <set>
+#include <type_traits>
 #include <boost/dynamic_bitset.hpp>
 
 //#define SOURCE_CODE_ANALYSIS
@@ -64,6 +66,92 @@ using namespace std;
 //define SOURCE_CODE_ANALYSIS
 
 
+// Allocator for the nodes of a tree. Nodes are carved out of blocks of
+// NodesPerBlock nodes and recycled through a free list, and all the blocks
+// are released at once by clear() or the destructor. The insert and delete
+// functions of the trees below take an optional pool, and use new and delete
+// when it is NULL.
+template <typename NodeT, unsigned NodesPerBlock = 1024>
+class NodePool {
+public:
+  NodePool() : FreeList(NULL), NextInBlock(NodesPerBlock) {}
+  ~NodePool() { clear(); }
+
+  NodeT * allocate() {
+    NodeT * Slot;
+    if (FreeList != NULL) {
+      Slot = FreeList;
+      FreeList = *reinterpret_cast<NodeT **>(Slot);
+    } else {
+      if (NextInBlock == NodesPerBlock) {
+        Blocks.push_back(static_cast<NodeT *>(
+            ::operator new(NodesPerBlock * sizeof(NodeT))));
+        Live.resize(Blocks.size() * NodesPerBlock, false);
+        NextInBlock = 0;
+      }
+      Slot = Blocks.back() + NextInBlock++;
+    }
+    setLive(Slot, true);
+    return new (Slot) NodeT();
+  }
+
+  void deallocate(NodeT * Node) {
+    Node->~NodeT();
+    setLive(Node, false);
+    *reinterpret_cast<NodeT **>(Node) = FreeList;
+    FreeList = Node;
+  }
+
+  // Releases every node, including those still linked in a tree.
+  void clear() {
+    for (size_t b = 0; b < Blocks.size(); b++) {
+      if (!std::is_trivially_destructible<NodeT>::value)
+        for (unsigned n = 0; n < NodesPerBlock; n++)
+          if (Live[b * NodesPerBlock + n])
+            Blocks[b][n].~NodeT();
+      ::operator delete(Blocks[b]);
+    }
+    Blocks.clear();
+    Live.clear();
+    FreeList = NULL;
+    NextInBlock = NodesPerBlock;
+  }
+
+private:
+  NodePool(const NodePool &) = delete;
+  NodePool & operator=(const NodePool &) = delete;
+
+  // Live is only needed to destroy the remaining nodes in clear().
+  void setLive(NodeT * Node, bool Value) {
+    if (std::is_trivially_destructible<NodeT>::value)
+      return;
+    for (size_t b = Blocks.size(); b > 0; b--)
+      if (Node >= Blocks[b - 1] && Node < Blocks[b - 1] + NodesPerBlock) {
+        Live[(b - 1) * NodesPerBlock + (Node - Blocks[b - 1])] = Value;
+        return;
+      }
+  }
+
+  vector<NodeT *> Blocks;
+  vector<bool> Live;
+  NodeT * FreeList;
+  unsigned NextInBlock;
+};
+
+template <typename NodeT>
+inline NodeT * allocate_node(NodePool<NodeT> * Pool) {
+  return (Pool == NULL) ? new NodeT() : Pool->allocate();
+}
+
+template <typename NodeT>
+inline void deallocate_node(NodeT * Node, NodePool<NodeT> * Pool) {
+  if (Pool == NULL)
+    delete Node;
+  else
+    Pool->deallocate(Node);
+}
+
+
 
 //
 // Removed: for generic T we may have defined >, <, == but not -
@@ -93,11 +181,6 @@ namespace SplayTree{
     int32_t widthOccupancy;
     int32_t occupancyPrefetch;
     uint64_t address;
-    vector<unsigned> issuePorts;
-#ifdef SOURCE_CODE_ANALYSIS
-//    set<uint64_t> SourceCodeLines;
-    vector<pair<unsigned,unsigned>> SourceCodeLinesOperationPair;
-#endif
     
   };
 
@@ -193,7 +276,8 @@ namespace SplayTree{
   // Return a pointer to the resulting tree.                   
   //
   template <typename T>
-  Tree<T> * insert_node(T i, Tree<T> * t, uint64_t a = 0) {
+  Tree<T> * insert_node(T i, Tree<T> * t, uint64_t a = 0,
+                        NodePool<Tree<T> > * Pool = NULL) {
 
     
     Tree<T> * new_node;
@@ -208,7 +292,7 @@ namespace SplayTree{
     }
     //new_node = (Tree *) malloc (sizeof (Tree));
     //    if (new_node == NULL) {printf("Ran out of space\n"); exit(1);}
-    new_node = new Tree<T>();
+    new_node = allocate_node(Pool);
     if(new_node == NULL)
        std::cout << "Object could not be allocated!\n";
     
@@ -245,7 +329,7 @@ namespace SplayTree{
   // Return a pointer to the resulting tree.              
   //
   template <typename T>
-  Tree<T> * delete_node(T i, Tree<T> *t) {
+  Tree<T> * delete_node(T i, Tree<T> *t, NodePool<Tree<T> > * Pool = NULL) {
     Tree<T> * x;
     size_t tsize;
 
@@ -262,7 +346,7 @@ namespace SplayTree{
 	x->right = t->right;
       }
       //free(t);
-      delete t;
+      deallocate_node(t, Pool);
       if (x != NULL) {
 	x->size = tsize-1;
 
@@ -275,6 +359,41 @@ namespace SplayTree{
 
   
 
+  // Reuse distance of key i, without changing the tree: the number of keys
+  // greater than i, plus one for i itself. Host is set to the node of i, or
+  // NULL if i is not in the tree. The successor of a missing i is not counted.
+  // From the paper "Program Locality Analysis Using Reuse Distance", by
+  // Y. Zhong, X. Sheng and C. Ding, 2009.
+  //
+  template <typename T>
+  size_t reuse_distance(T i, Tree<T> *t, Tree<T> **Host) {
+    size_t Distance = 0;
+    bool CountedSuccessor = false;
+    *Host = NULL;
+    while (t != NULL) {
+      if (i < t->key) {
+        Distance += node_size(t->right);
+        if (t->left == NULL)
+          break;               // t is the successor of i
+        Distance++;
+        CountedSuccessor = true;
+        t = t->left;
+      } else if (i > t->key) {
+        if (t->right == NULL) {
+          // The successor is the last node left behind on the way down.
+          if (CountedSuccessor)
+            Distance--;
+          break;
+        }
+        t = t->right;
+      } else {
+        *Host = t;
+        return Distance + node_size(t->right) + 1;
+      }
+    }
+    return Distance;
+  }
+
   //Returns a pointer to the node in the tree with the given rank.  
   // Returns NULL if there is no such node.                          
   //  Does not change the tree.  To guarantee logarithmic behavior,  
@@ -1044,7 +1163,8 @@ r_size -= y->duplicates+node_size(y->right);
   // Return a pointer to the resulting tree.
   //
   template <typename T>
-  SimpleTree<T> * insert_node(T i, SimpleTree<T> * t) {
+  SimpleTree<T> * insert_node(T i, SimpleTree<T> * t,
+                              NodePool<SimpleTree<T> > * Pool = NULL) {
     
          
     SimpleTree<T> * new_node;
@@ -1064,7 +1184,7 @@ t->size=t->size+1;
     }
     //new_node = (SimpleTree *) malloc (sizeof (SimpleTree));
     //    if (new_node == NULL) {printf("Ran out of space\n"); exit(1);}
-    new_node = new SimpleTree<T>();
+    new_node = allocate_node(Pool);
     if(new_node == NULL)
       std::cout << "Object could not be allocated!\n";
     
@@ -1106,7 +1226,8 @@ new_node->duplicates = 1;
   // Return a pointer to the resulting SimpleTree.
   //
   template <typename T>
-  SimpleTree<T> * delete_node(T i, SimpleTree<T> *t) {
+  SimpleTree<T> * delete_node(T i, SimpleTree<T> *t,
+                              NodePool<SimpleTree<T> > * Pool = NULL) {
     SimpleTree<T> * x;
     size_t tsize;
     
@@ -1133,7 +1254,7 @@ return t;
    //   std::cerr << "Root of the returned tree "<< x->key<<"\n";
       }
       //free(t);
-      delete t;
+      deallocate_node(t, Pool);
       if (x != NULL) {
         x->size = tsize-1;
         
@@ -1368,7 +1489,8 @@ r_size += r->IssueCycles.size()+node_size(r->right);
   // Return a pointer to the resulting tree.
   //
   template <typename T>
-  ComplexTree<T> * insert_node(T i, T j, ComplexTree<T> * t) {
+  ComplexTree<T> * insert_node(T i, T j, ComplexTree<T> * t,
+                               NodePool<ComplexTree<T> > * Pool = NULL) {
     
    // dbgs() << "Inserting node\n";
     ComplexTree<T> * new_node;
@@ -1387,7 +1509,7 @@ t->size = t->size +1;
     }
     //new_node = (ComplexTree *) malloc (sizeof (ComplexTree));
     //    if (new_node == NULL) {printf("Ran out of space\n"); exit(1);}
-    new_node = new ComplexTree<T>();
+    new_node = allocate_node(Pool);
     if(new_node == NULL)
       std::cout << "Object could not be allocated!\n";
     
@@ -1434,7 +1556,8 @@ t->size =  t->IssueCycles.size()+node_size(t->left);
   // Return a pointer to the resulting ComplexTree.
   //
   template <typename T>
-  ComplexTree<T> * delete_node(T i, T j, ComplexTree<T> *t) {
+  ComplexTree<T> * delete_node(T i, T j, ComplexTree<T> *t,
+                               NodePool<ComplexTree<T> > * Pool = NULL) {
 typedef typename std::vector<T>::iterator iterator;
     ComplexTree<T> * x;
     size_t tsize;
@@ -1487,7 +1610,7 @@ exit(0);
         x->right = t->right;
       }
       //free(t);
-      delete t;
+      deallocate_node(t, Pool);
       if (x != NULL) {
         x->size = tsize-1;
         
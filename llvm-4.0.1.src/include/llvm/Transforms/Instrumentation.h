@@ -172,6 +172,10 @@ inline ModulePass *createDataFlowSanitizerPassForJIT(
 // checking on loads, stores, and other memory intrinsics.
 FunctionPass *createBoundsCheckingPass();
 
+// ERMInstrumentation - This pass instruments the function analyzed by ERM to
+// record its dynamic instruction stream from native code.
+ModulePass *createERMInstrumentationPass();
+
 /// \brief Calculate what to divide by to scale counts.
 ///
 /// Given the maximum count, calculate a divisor that will scale all the
@@ -18,6 +18,8 @@
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Type.h"
 #include "llvm/Support/ErrorHandling.h"
@@ -590,6 +592,76 @@ void IntrinsicLowering::LowerIntrinsicCall(CallInst *CI) {
   CI->eraseFromParent();
 }
 
+bool IntrinsicLowering::isLowerableIntrinsicCall(const CallInst &CI) {
+  if (isa<DbgInfoIntrinsic>(CI))
+    return false;
+  const Function *Callee = CI.getCalledFunction();
+  if (!Callee)
+    return false;
+  // Must match the cases handled by LowerIntrinsicCall.
+  switch (Callee->getIntrinsicID()) {
+  default:
+    return false;
+  case Intrinsic::expect:
+  case Intrinsic::setjmp:
+  case Intrinsic::sigsetjmp:
+  case Intrinsic::longjmp:
+  case Intrinsic::siglongjmp:
+  case Intrinsic::ctpop:
+  case Intrinsic::bswap:
+  case Intrinsic::ctlz:
+  case Intrinsic::cttz:
+  case Intrinsic::stacksave:
+  case Intrinsic::stackrestore:
+  case Intrinsic::get_dynamic_area_offset:
+  case Intrinsic::returnaddress:
+  case Intrinsic::frameaddress:
+  case Intrinsic::addressofreturnaddress:
+  case Intrinsic::prefetch:
+  case Intrinsic::pcmarker:
+  case Intrinsic::readcyclecounter:
+  case Intrinsic::eh_typeid_for:
+  case Intrinsic::annotation:
+  case Intrinsic::ptr_annotation:
+  case Intrinsic::assume:
+  case Intrinsic::var_annotation:
+  case Intrinsic::memcpy:
+  case Intrinsic::memmove:
+  case Intrinsic::memset:
+  case Intrinsic::sqrt:
+  case Intrinsic::log:
+  case Intrinsic::log2:
+  case Intrinsic::log10:
+  case Intrinsic::exp:
+  case Intrinsic::exp2:
+  case Intrinsic::pow:
+  case Intrinsic::sin:
+  case Intrinsic::cos:
+  case Intrinsic::floor:
+  case Intrinsic::ceil:
+  case Intrinsic::trunc:
+  case Intrinsic::round:
+  case Intrinsic::copysign:
+  case Intrinsic::flt_rounds:
+  case Intrinsic::invariant_start:
+  case Intrinsic::lifetime_start:
+  case Intrinsic::invariant_end:
+  case Intrinsic::lifetime_end:
+    return true;
+  }
+}
+
+bool IntrinsicLowering::LowerIntrinsicCalls(Function &F) {
+  SmallVector<CallInst *, 16> Calls;
+  for (Instruction &I : instructions(F))
+    if (CallInst *CI = dyn_cast<CallInst>(&I))
+      if (isLowerableIntrinsicCall(*CI))
+        Calls.push_back(CI);
+  for (CallInst *CI : Calls)
+    LowerIntrinsicCall(CI);
+  return !Calls.empty();
+}
+
 bool IntrinsicLowering::LowerToByteSwap(CallInst *CI) {
   // Verify this is a simple bswap.
   if (CI->getNumArgOperands() != 1 ||
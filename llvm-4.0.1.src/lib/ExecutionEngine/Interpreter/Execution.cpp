@@ -14,6 +14,7 @@
 
 #include "Interpreter.h"
 #include "llvm/ADT/APInt.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/CodeGen/IntrinsicLowering.h"
 #include "llvm/IR/Constants.h"
@@ -23,12 +24,24 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MathExtras.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/YAMLParser.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <condition_variable>
+#include <ctime>
+#include <mutex>
+#include <thread>
 
 #include "llvm/Support/DynamicAnalysis.h"
+#include "llvm/Support/DynamicAnalysisTrace.h"
 
 using namespace llvm;
 
@@ -182,6 +195,11 @@ static cl::opt<bool> ConstraintAGUs("constraint-agus", cl::Hidden,
                                              "Constraint agus according to specified architecture. Default value is FALSE"),
                                     cl::init(false));
 
+static cl::opt<unsigned> DispatchPorts("dispatch-ports", cl::Hidden,
+                                       cl::desc(
+                                                "Number of dispatch ports. Ports beyond the ones nodes are mapped to are idle. Default value is 0, the ports of the microarchitecture"),
+                                       cl::init(0));
+
 static cl::opt<bool> ConstraintPortsx86("constraint-ports-x86", cl::Hidden,
                                         cl::desc(
                                                  "Constraint ports dispatch according to x86 architecture. Default value is FALSE"),
@@ -224,6 +242,22 @@ static cl::opt<std::string> TaskGraphFileName("taskgraph-file",
 static cl::opt<std::string> OutputDir("output-dir",
                                  cl::desc("Directory where to output results"), cl::value_desc("/local"),cl::init("/local"));
 
+static cl::opt<std::string> CaptureTrace("capture-trace",
+                                    cl::desc("Write the dynamic instruction stream of the analyzed function to a binary trace"),
+                                    cl::value_desc("filename"), cl::init(""));
+
+static cl::opt<std::string> ReplayTrace("replay-trace",
+                                   cl::desc("Drive the analysis from a binary trace instead of interpreting the program"),
+                                   cl::value_desc("filename"), cl::init(""));
+
+static cl::opt<bool> PipelinedAnalysis("pipelined-analysis",
+                                       cl::desc("Run the analysis on a separate thread, overlapped with the interpretation"),
+                                       cl::init(false));
+
+static cl::list<std::string> Configs("configs", cl::CommaSeparated,
+                                     cl::desc("Simulate several microarchitectures in a single run, one JSON configuration file per analyzer"),
+                                     cl::value_desc("a.json,b.json,..."));
+
 
 
 
@@ -231,8 +265,36 @@ static cl::opt<std::string> OutputDir("output-dir",
 //                     Various Helper Functions
 //===----------------------------------------------------------------------===//
 
+void DecodedFunction::numberValues() {
+  for (Argument &A : F.args())
+    getOrAddSlot(&A);
+  for (BasicBlock &BB : F)
+    for (Instruction &I : BB)
+      if (!I.getType()->isVoidTy())
+        getOrAddSlot(&I);
+  for (BasicBlock &BB : F)
+    for (Instruction &I : BB)
+      for (Value *Op : I.operands())
+        if (isa<Constant>(Op) &&
+            Index.insert(std::make_pair(Op, -1 - (int)Constants.size()))
+                .second) {
+          ConstantOperands.push_back(cast<Constant>(Op));
+          Constants.emplace_back();
+        }
+  Materialized.resize(Constants.size(), false);
+}
+
 static void SetValue(Value *V, GenericValue Val, ExecutionContext &SF) {
-  SF.Values[V] = Val;
+  // The result slot of the instruction being executed is resolved when its
+  // function is decoded.
+  const DecodedInstruction *DI =
+      SF.PC != 0 ? &SF.Decoded->Code[SF.PC - 1] : nullptr;
+  unsigned Slot = DI && DI->I == V && DI->Result != DecodedFunction::NoSlot
+                      ? DI->Result
+                      : SF.Decoded->getOrAddSlot(V);
+  if (Slot >= SF.Values.size())
+    SF.Values.resize(SF.Decoded->NSlots);
+  SF.Values[Slot] = Val;
 }
 
 //===----------------------------------------------------------------------===//
@@ -470,8 +532,8 @@ static GenericValue executeICMP_SGE(GenericValue Src1, GenericValue Src2,
  void Interpreter::visitICmpInst(ICmpInst &I) {
   ExecutionContext &SF = ECStack.back();
   Type *Ty    = I.getOperand(0)->getType();
-  GenericValue Src1 = getOperandValue(I.getOperand(0), SF);
-  GenericValue Src2 = getOperandValue(I.getOperand(1), SF);
+  GenericValue Src1 = getOperandValue(I, 0, SF);
+  GenericValue Src2 = getOperandValue(I, 1, SF);
   GenericValue R;   // Result
   
   switch (I.getPredicate()) {
@@ -804,8 +866,8 @@ static GenericValue executeFCMP_BOOL(GenericValue Src1, GenericValue Src2,
 void Interpreter::visitFCmpInst(FCmpInst &I) {
   ExecutionContext &SF = ECStack.back();
   Type *Ty    = I.getOperand(0)->getType();
-  GenericValue Src1 = getOperandValue(I.getOperand(0), SF);
-  GenericValue Src2 = getOperandValue(I.getOperand(1), SF);
+  GenericValue Src1 = getOperandValue(I, 0, SF);
+  GenericValue Src2 = getOperandValue(I, 1, SF);
   GenericValue R;   // Result
   
   switch (I.getPredicate()) {
@@ -877,8 +939,8 @@ static GenericValue executeCmpInst(unsigned predicate, GenericValue Src1,
 void Interpreter::visitBinaryOperator(BinaryOperator &I) {
   ExecutionContext &SF = ECStack.back();
   Type *Ty    = I.getOperand(0)->getType();
-  GenericValue Src1 = getOperandValue(I.getOperand(0), SF);
-  GenericValue Src2 = getOperandValue(I.getOperand(1), SF);
+  GenericValue Src1 = getOperandValue(I, 0, SF);
+  GenericValue Src2 = getOperandValue(I, 1, SF);
   GenericValue R;   // Result
 
   // First process vector operation
@@ -1004,9 +1066,9 @@ static GenericValue executeSelectInst(GenericValue Src1, GenericValue Src2,
 void Interpreter::visitSelectInst(SelectInst &I) {
   ExecutionContext &SF = ECStack.back();
   Type * Ty = I.getOperand(0)->getType();
-  GenericValue Src1 = getOperandValue(I.getOperand(0), SF);
-  GenericValue Src2 = getOperandValue(I.getOperand(1), SF);
-  GenericValue Src3 = getOperandValue(I.getOperand(2), SF);
+  GenericValue Src1 = getOperandValue(I, 0, SF);
+  GenericValue Src2 = getOperandValue(I, 1, SF);
+  GenericValue Src3 = getOperandValue(I, 2, SF);
   GenericValue R = executeSelectInst(Src1, Src2, Src3, Ty);
   SetValue(&I, R, SF);
    // return nullptr;
@@ -1067,7 +1129,7 @@ void Interpreter::visitReturnInst(ReturnInst &I) {
   // Save away the return value... (if we are not 'ret void')
   if (I.getNumOperands()) {
     RetTy  = I.getReturnValue()->getType();
-    Result = getOperandValue(I.getReturnValue(), SF);
+    Result = getOperandValue(I, 0, SF);
   }
 
   popStackAndReturnValueToCaller(RetTy, Result);
@@ -1114,7 +1176,7 @@ void Interpreter::visitSwitchInst(SwitchInst &I) {
 
 void Interpreter::visitIndirectBrInst(IndirectBrInst &I) {
   ExecutionContext &SF = ECStack.back();
-  void *Dest = GVTOP(getOperandValue(I.getAddress(), SF));
+  void *Dest = GVTOP(getOperandValue(I, 0, SF));
   SwitchToNewBasicBlock((BasicBlock*)Dest, SF);
    // return nullptr;
 }
@@ -1133,17 +1195,17 @@ void Interpreter::visitIndirectBrInst(IndirectBrInst &I) {
 void Interpreter::SwitchToNewBasicBlock(BasicBlock *Dest, ExecutionContext &SF){
 
   BasicBlock *PrevBB = SF.CurBB;      // Remember where we came from...
-  SF.CurBB   = Dest;                  // Update CurBB to branch destination
-  SF.CurInst = SF.CurBB->begin();     // Update new instruction ptr...
+  SF.CurBB = Dest;                    // Update CurBB to branch destination
+  SF.PC = SF.Decoded->BlockStart.lookup(Dest); // Update new instruction ptr...
 
-  if (!isa<PHINode>(SF.CurInst)){
-return;  // Nothing fancy to do
-}
+  if (!isa<PHINode>(Dest->begin()))
+    return;  // Nothing fancy to do
 
   // Loop over all of the PHI nodes in the current block, reading their inputs.
   std::vector<GenericValue> ResultValues;
 
-  for (; PHINode *PN = dyn_cast<PHINode>(SF.CurInst); ++SF.CurInst) {
+  for (BasicBlock::iterator It = Dest->begin();
+       PHINode *PN = dyn_cast<PHINode>(It); ++It) {
     // Search for the value corresponding to this previous bb...
     int i = PN->getBasicBlockIndex(PrevBB);
     assert(i != -1 && "PHINode doesn't contain entry for predecessor??");
@@ -1154,11 +1216,64 @@ return;  // Nothing fancy to do
   }
 
   // Now loop over all of the PHI nodes setting their values...
-  SF.CurInst = SF.CurBB->begin();
-  for (unsigned i = 0; isa<PHINode>(SF.CurInst); ++SF.CurInst, ++i) {
-    PHINode *PN = cast<PHINode>(SF.CurInst);
-    SetValue(PN, ResultValues[i], SF);
+  BasicBlock::iterator It = Dest->begin();
+  for (unsigned i = 0; isa<PHINode>(It); ++It, ++i)
+    SetValue(&*It, ResultValues[i], SF);
+}
+
+// takeEdge - Decoded form of SwitchToNewBasicBlock: the incoming values of the
+// PHI nodes of the destination were resolved when the function was decoded.
+//
+void Interpreter::takeEdge(const DecodedEdge &Edge, ExecutionContext &SF) {
+  SF.CurBB = Edge.Dest;
+  SF.PC = Edge.Target;
+
+  const PHIMove *Move = &SF.Decoded->Moves[Edge.FirstMove];
+  if (Edge.NMoves == 0)
+    return;
+  if (SF.Values.size() < SF.Decoded->NSlots)
+    SF.Values.resize(SF.Decoded->NSlots);
+  if (Edge.NMoves == 1) {
+    SF.Values[Move->Dest] = getSlotValue(Move->Source, SF);
+    return;
   }
+
+  // All the PHI nodes read their inputs before any of them is updated.
+  SmallVector<GenericValue, 8> ResultValues;
+  for (unsigned i = 0; i < Edge.NMoves; i++)
+    ResultValues.push_back(getSlotValue(Move[i].Source, SF));
+  for (unsigned i = 0; i < Edge.NMoves; i++)
+    SF.Values[Move[i].Dest] = ResultValues[i];
+}
+
+void Interpreter::executeBranch(Interpreter &Interp,
+                                const DecodedInstruction &DI,
+                                ExecutionContext &SF) {
+  Interp.takeEdge(SF.Decoded->Edges[DI.FirstEdge], SF);
+}
+
+void Interpreter::executeCondBranch(Interpreter &Interp,
+                                    const DecodedInstruction &DI,
+                                    ExecutionContext &SF) {
+  // The second edge is taken if the condition is false.
+  bool False = Interp.getSlotValue(DI.Condition, SF).IntVal == 0;
+  Interp.takeEdge(SF.Decoded->Edges[DI.FirstEdge + False], SF);
+}
+
+void Interpreter::executeSwitch(Interpreter &Interp,
+                                const DecodedInstruction &DI,
+                                ExecutionContext &SF) {
+  GenericValue CondVal = Interp.getSlotValue(DI.Condition, SF);
+  const DecodedEdge *Edges = &SF.Decoded->Edges[DI.FirstEdge];
+
+  // Check to see if any of the cases match, the first edge is the default.
+  unsigned Taken = 0;
+  for (unsigned i = 1; i < DI.NEdges; i++)
+    if (Edges[i].CaseValue->getValue() == CondVal.IntVal) {
+      Taken = i;
+      break;
+    }
+  Interp.takeEdge(Edges[Taken], SF);
 }
 
 //===----------------------------------------------------------------------===//
@@ -1172,7 +1287,7 @@ void Interpreter::visitAllocaInst(AllocaInst &I) {
 
   // Get the number of elements being allocated by the array...
   unsigned NumElements = 
-    getOperandValue(I.getOperand(0), SF).IntVal.getZExtValue();
+    getOperandValue(I, 0, SF).IntVal.getZExtValue();
 
   unsigned TypeSize = (size_t)getDataLayout().getTypeAllocSize(Ty);
 
@@ -1198,15 +1313,23 @@ void Interpreter::visitAllocaInst(AllocaInst &I) {
 
 // getElementOffset - The workhorse for getelementptr.
 //
-GenericValue Interpreter::executeGEPOperation(Value *Ptr, gep_type_iterator I,
-                                              gep_type_iterator E,
-                                              ExecutionContext &SF) {
-  assert(Ptr->getType()->isPointerTy() &&
+GenericValue Interpreter::executeGEPOperation(User *GEP, ExecutionContext &SF) {
+  assert(GEP->getOperand(0)->getType()->isPointerTy() &&
          "Cannot getElementOffset of a nonpointer type!");
 
+  // The operands of an instruction are read from their slots, those of a
+  // constant expression are evaluated.
+  Instruction *Inst = dyn_cast<Instruction>(GEP);
+  auto getOperand = [&](unsigned i) {
+    return Inst ? getOperandValue(*Inst, i, SF)
+                : getOperandValue(GEP->getOperand(i), SF);
+  };
+
   uint64_t Total = 0;
 
-  for (; I != E; ++I) {
+  unsigned Op = 1;
+  for (gep_type_iterator I = gep_type_begin(GEP), E = gep_type_end(GEP); I != E;
+       ++I, ++Op) {
     if (StructType *STy = I.getStructTypeOrNull()) {
       const StructLayout *SLO = getDataLayout().getStructLayout(STy);
 
@@ -1216,7 +1339,7 @@ GenericValue Interpreter::executeGEPOperation(Value *Ptr, gep_type_iterator I,
       Total += SLO->getElementOffset(Index);
     } else {
       // Get the index number for the array... which must be long type...
-      GenericValue IdxGV = getOperandValue(I.getOperand(), SF);
+      GenericValue IdxGV = getOperand(Op);
 
       int64_t Idx;
       unsigned BitWidth = 
@@ -1232,60 +1355,49 @@ GenericValue Interpreter::executeGEPOperation(Value *Ptr, gep_type_iterator I,
   }
 
   GenericValue Result;
-  Result.PointerVal = ((char*)getOperandValue(Ptr, SF).PointerVal) + Total;
+  Result.PointerVal = ((char*)getOperand(0).PointerVal) + Total;
 
   return Result;
 }
 
 void Interpreter::visitGetElementPtrInst(GetElementPtrInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executeGEPOperation(I.getPointerOperand(),
-                                   gep_type_begin(I), gep_type_end(I), SF), SF);
+  SetValue(&I, executeGEPOperation(&I, SF), SF);
 
   // return nullptr;
 }
 
+void Interpreter::recordMemoryAccess(MemoryAccessEvent::AccessKind Kind,
+                                     void *Ptr, Type *Ty) {
+  LastMemoryAccess.Kind = Kind;
+  LastMemoryAccess.Address = (uint64_t)(intptr_t)Ptr;
+  LastMemoryAccess.SourceAddress = 0;
+  LastMemoryAccess.Size = getDataLayout().getTypeStoreSize(Ty);
+  LastMemoryAccess.NElements = Ty->isVectorTy() ? Ty->getVectorNumElements() : 1;
+}
+
 void Interpreter::visitLoadInst(LoadInst &I) {
   ExecutionContext &SF = ECStack.back();
-  GenericValue SRC = getOperandValue(I.getPointerOperand(), SF);
+  GenericValue SRC = getOperandValue(I, 0, SF);
   GenericValue *Ptr = (GenericValue*)GVTOP(SRC);
   GenericValue Result;
   LoadValueFromMemory(Result, Ptr, I.getType());
   SetValue(&I, Result, SF);
+  recordMemoryAccess(MemoryAccessEvent::Load, Ptr, I.getType());
   if (I.isVolatile() && PrintVolatile)
     dbgs() << "Volatile load " << I;
- //  return Ptr;
 }
 
-
-  GenericValue * Interpreter::getValueLoadInst(LoadInst * I){
-  ExecutionContext &SF = ECStack.back();
-  GenericValue SRC = getOperandValue(I->getPointerOperand(), SF);
-  GenericValue *Ptr = (GenericValue*)GVTOP(SRC);
-//  GenericValue Result;
- // LoadValueFromMemory(Result, Ptr, I.getType());
- // SetValue(&I, Result, SF);
- // if (I.isVolatile() && PrintVolatile)
- //   dbgs() << "Volatile load " << I;
-   return Ptr;
-}
-
-
 void Interpreter::visitStoreInst(StoreInst &I) {
   ExecutionContext &SF = ECStack.back();
-  GenericValue Val = getOperandValue(I.getOperand(0), SF);
-  GenericValue SRC = getOperandValue(I.getPointerOperand(), SF);
+  GenericValue Val = getOperandValue(I, 0, SF);
+  GenericValue SRC = getOperandValue(I, 1, SF);
   StoreValueToMemory(Val, (GenericValue *)GVTOP(SRC),
                      I.getOperand(0)->getType());
+  recordMemoryAccess(MemoryAccessEvent::Store, GVTOP(SRC),
+                     I.getOperand(0)->getType());
   if (I.isVolatile() && PrintVolatile)
     dbgs() << "Volatile store: " << I;
- // return (GenericValue *) GVTOP(SRC);
-}
-
- GenericValue * Interpreter::getValueStoreInst(StoreInst * I){
-  ExecutionContext &SF = ECStack.back();
-  GenericValue SRC = getOperandValue(I->getPointerOperand(), SF);
-  return (GenericValue *) GVTOP(SRC);
 }
 
 
@@ -1315,7 +1427,8 @@ void Interpreter::visitCallSite(CallSite CS) {
     case Intrinsic::vaend:    // va_end is a noop for the interpreter
        return;
     case Intrinsic::vacopy:   // va_copy: dest = src
-      SetValue(CS.getInstruction(), getOperandValue(*CS.arg_begin(), SF), SF);
+      SetValue(CS.getInstruction(),
+               getOperandValue(*CS.getInstruction(), 0, SF), SF);
       return;
     default:
       // If it is an unknown intrinsic function, use the intrinsic lowering
@@ -1327,33 +1440,46 @@ void Interpreter::visitCallSite(CallSite CS) {
       if (!atBegin)
         --me;
       IL->LowerIntrinsicCall(cast<CallInst>(CS.getInstruction()));
+      LoweredInstruction = true;
 
-      // Restore the CurInst pointer to the first instruction newly inserted, if
-      // any.
+      // Resume at the first instruction newly inserted, if any.
       if (atBegin) {
-        SF.CurInst = Parent->begin();
+        me = Parent->begin();
       } else {
-        SF.CurInst = me;
-        ++SF.CurInst;
+        ++me;
       }
+      redecodeFunction(*SF.Decoded, &*me);
       return;
     }
 
 
   SF.Caller = CS;
+  Instruction &Call = *CS.getInstruction();
   std::vector<GenericValue> ArgVals;
   const unsigned NumArgs = SF.Caller.arg_size();
   ArgVals.reserve(NumArgs);
-  uint16_t pNum = 1;
-  for (CallSite::arg_iterator i = SF.Caller.arg_begin(),
-         e = SF.Caller.arg_end(); i != e; ++i, ++pNum) {
-    Value *V = *i;
-    ArgVals.push_back(getOperandValue(V, SF));
+  for (unsigned i = 0; i != NumArgs; ++i)
+    ArgVals.push_back(getOperandValue(Call, i, SF));
+
+  // Footprint of the library calls that copy or set memory (also the result
+  // of lowering llvm.memcpy, llvm.memmove and llvm.memset).
+  if (F && F->isDeclaration() && ArgVals.size() == 3) {
+    StringRef Name = F->getName();
+    if (Name == "memcpy" || Name == "memmove" || Name == "memset") {
+      LastMemoryAccess.Kind = Name == "memset" ? MemoryAccessEvent::Set
+                                               : MemoryAccessEvent::Copy;
+      LastMemoryAccess.Address = (uint64_t)(intptr_t)GVTOP(ArgVals[0]);
+      LastMemoryAccess.SourceAddress =
+          Name == "memset" ? 0 : (uint64_t)(intptr_t)GVTOP(ArgVals[1]);
+      LastMemoryAccess.Size = ArgVals[2].IntVal.getZExtValue();
+      LastMemoryAccess.NElements = 1;
+    }
   }
 
   // To handle indirect calls, we must get the pointer value from the argument
   // and treat it as a function pointer.
-  GenericValue SRC = getOperandValue(SF.Caller.getCalledValue(), SF);
+  GenericValue SRC = getOperandValue(
+      Call, Call.getNumOperands() - (CS.isCall() ? 1 : 3), SF);
   callFunction((Function*)GVTOP(SRC), ArgVals);
 
   //return nullptr;
@@ -1373,8 +1499,8 @@ static unsigned getShiftAmount(uint64_t orgShiftAmount,
 
 void Interpreter::visitShl(BinaryOperator &I) {
   ExecutionContext &SF = ECStack.back();
-  GenericValue Src1 = getOperandValue(I.getOperand(0), SF);
-  GenericValue Src2 = getOperandValue(I.getOperand(1), SF);
+  GenericValue Src1 = getOperandValue(I, 0, SF);
+  GenericValue Src2 = getOperandValue(I, 1, SF);
   GenericValue Dest;
   Type *Ty = I.getType();
 
@@ -1401,8 +1527,8 @@ void Interpreter::visitShl(BinaryOperator &I) {
 
 void Interpreter::visitLShr(BinaryOperator &I) {
   ExecutionContext &SF = ECStack.back();
-  GenericValue Src1 = getOperandValue(I.getOperand(0), SF);
-  GenericValue Src2 = getOperandValue(I.getOperand(1), SF);
+  GenericValue Src1 = getOperandValue(I, 0, SF);
+  GenericValue Src2 = getOperandValue(I, 1, SF);
   GenericValue Dest;
   Type *Ty = I.getType();
 
@@ -1430,8 +1556,8 @@ void Interpreter::visitLShr(BinaryOperator &I) {
 
 void Interpreter::visitAShr(BinaryOperator &I) {
   ExecutionContext &SF = ECStack.back();
-  GenericValue Src1 = getOperandValue(I.getOperand(0), SF);
-  GenericValue Src2 = getOperandValue(I.getOperand(1), SF);
+  GenericValue Src1 = getOperandValue(I, 0, SF);
+  GenericValue Src2 = getOperandValue(I, 1, SF);
   GenericValue Dest;
   Type *Ty = I.getType();
 
@@ -1456,10 +1582,9 @@ void Interpreter::visitAShr(BinaryOperator &I) {
   // return nullptr;
 }
 
-GenericValue Interpreter::executeTruncInst(Value *SrcVal, Type *DstTy,
-                                           ExecutionContext &SF) {
-  GenericValue Dest, Src = getOperandValue(SrcVal, SF);
-  Type *SrcTy = SrcVal->getType();
+GenericValue Interpreter::executeTruncInst(GenericValue Src, Type *SrcTy,
+                                           Type *DstTy) {
+  GenericValue Dest;
   if (SrcTy->isVectorTy()) {
     Type *DstVecTy = DstTy->getScalarType();
     unsigned DBitWidth = cast<IntegerType>(DstVecTy)->getBitWidth();
@@ -1476,10 +1601,9 @@ GenericValue Interpreter::executeTruncInst(Value *SrcVal, Type *DstTy,
   return Dest;
 }
 
-GenericValue Interpreter::executeSExtInst(Value *SrcVal, Type *DstTy,
-                                          ExecutionContext &SF) {
-  Type *SrcTy = SrcVal->getType();
-  GenericValue Dest, Src = getOperandValue(SrcVal, SF);
+GenericValue Interpreter::executeSExtInst(GenericValue Src, Type *SrcTy,
+                                          Type *DstTy) {
+  GenericValue Dest;
   if (SrcTy->isVectorTy()) {
     Type *DstVecTy = DstTy->getScalarType();
     unsigned DBitWidth = cast<IntegerType>(DstVecTy)->getBitWidth();
@@ -1496,10 +1620,9 @@ GenericValue Interpreter::executeSExtInst(Value *SrcVal, Type *DstTy,
   return Dest;
 }
 
-GenericValue Interpreter::executeZExtInst(Value *SrcVal, Type *DstTy,
-                                          ExecutionContext &SF) {
-  Type *SrcTy = SrcVal->getType();
-  GenericValue Dest, Src = getOperandValue(SrcVal, SF);
+GenericValue Interpreter::executeZExtInst(GenericValue Src, Type *SrcTy,
+                                          Type *DstTy) {
+  GenericValue Dest;
   if (SrcTy->isVectorTy()) {
     Type *DstVecTy = DstTy->getScalarType();
     unsigned DBitWidth = cast<IntegerType>(DstVecTy)->getBitWidth();
@@ -1517,12 +1640,12 @@ GenericValue Interpreter::executeZExtInst(Value *SrcVal, Type *DstTy,
   return Dest;
 }
 
-GenericValue Interpreter::executeFPTruncInst(Value *SrcVal, Type *DstTy,
-                                             ExecutionContext &SF) {
-  GenericValue Dest, Src = getOperandValue(SrcVal, SF);
+GenericValue Interpreter::executeFPTruncInst(GenericValue Src, Type *SrcTy,
+                                             Type *DstTy) {
+  GenericValue Dest;
 
-  if (SrcVal->getType()->getTypeID() == Type::VectorTyID) {
-    assert(SrcVal->getType()->getScalarType()->isDoubleTy() &&
+  if (SrcTy->getTypeID() == Type::VectorTyID) {
+    assert(SrcTy->getScalarType()->isDoubleTy() &&
            DstTy->getScalarType()->isFloatTy() &&
            "Invalid FPTrunc instruction");
 
@@ -1532,7 +1655,7 @@ GenericValue Interpreter::executeFPTruncInst(Value *SrcVal, Type *DstTy,
     for (unsigned i = 0; i < size; i++)
       Dest.AggregateVal[i].FloatVal = (float)Src.AggregateVal[i].DoubleVal;
   } else {
-    assert(SrcVal->getType()->isDoubleTy() && DstTy->isFloatTy() &&
+    assert(SrcTy->isDoubleTy() && DstTy->isFloatTy() &&
            "Invalid FPTrunc instruction");
     Dest.FloatVal = (float)Src.DoubleVal;
   }
@@ -1540,12 +1663,12 @@ GenericValue Interpreter::executeFPTruncInst(Value *SrcVal, Type *DstTy,
   return Dest;
 }
 
-GenericValue Interpreter::executeFPExtInst(Value *SrcVal, Type *DstTy,
-                                           ExecutionContext &SF) {
-  GenericValue Dest, Src = getOperandValue(SrcVal, SF);
+GenericValue Interpreter::executeFPExtInst(GenericValue Src, Type *SrcTy,
+                                           Type *DstTy) {
+  GenericValue Dest;
 
-  if (SrcVal->getType()->getTypeID() == Type::VectorTyID) {
-    assert(SrcVal->getType()->getScalarType()->isFloatTy() &&
+  if (SrcTy->getTypeID() == Type::VectorTyID) {
+    assert(SrcTy->getScalarType()->isFloatTy() &&
            DstTy->getScalarType()->isDoubleTy() && "Invalid FPExt instruction");
 
     unsigned size = Src.AggregateVal.size();
@@ -1554,7 +1677,7 @@ GenericValue Interpreter::executeFPExtInst(Value *SrcVal, Type *DstTy,
     for (unsigned i = 0; i < size; i++)
       Dest.AggregateVal[i].DoubleVal = (double)Src.AggregateVal[i].FloatVal;
   } else {
-    assert(SrcVal->getType()->isFloatTy() && DstTy->isDoubleTy() &&
+    assert(SrcTy->isFloatTy() && DstTy->isDoubleTy() &&
            "Invalid FPExt instruction");
     Dest.DoubleVal = (double)Src.FloatVal;
   }
@@ -1562,10 +1685,9 @@ GenericValue Interpreter::executeFPExtInst(Value *SrcVal, Type *DstTy,
   return Dest;
 }
 
-GenericValue Interpreter::executeFPToUIInst(Value *SrcVal, Type *DstTy,
-                                            ExecutionContext &SF) {
-  Type *SrcTy = SrcVal->getType();
-  GenericValue Dest, Src = getOperandValue(SrcVal, SF);
+GenericValue Interpreter::executeFPToUIInst(GenericValue Src, Type *SrcTy,
+                                            Type *DstTy) {
+  GenericValue Dest;
 
   if (SrcTy->getTypeID() == Type::VectorTyID) {
     Type *DstVecTy = DstTy->getScalarType();
@@ -1600,10 +1722,9 @@ GenericValue Interpreter::executeFPToUIInst(Value *SrcVal, Type *DstTy,
   return Dest;
 }
 
-GenericValue Interpreter::executeFPToSIInst(Value *SrcVal, Type *DstTy,
-                                            ExecutionContext &SF) {
-  Type *SrcTy = SrcVal->getType();
-  GenericValue Dest, Src = getOperandValue(SrcVal, SF);
+GenericValue Interpreter::executeFPToSIInst(GenericValue Src, Type *SrcTy,
+                                            Type *DstTy) {
+  GenericValue Dest;
 
   if (SrcTy->getTypeID() == Type::VectorTyID) {
     Type *DstVecTy = DstTy->getScalarType();
@@ -1637,11 +1758,11 @@ GenericValue Interpreter::executeFPToSIInst(Value *SrcVal, Type *DstTy,
   return Dest;
 }
 
-GenericValue Interpreter::executeUIToFPInst(Value *SrcVal, Type *DstTy,
-                                            ExecutionContext &SF) {
-  GenericValue Dest, Src = getOperandValue(SrcVal, SF);
+GenericValue Interpreter::executeUIToFPInst(GenericValue Src, Type *SrcTy,
+                                            Type *DstTy) {
+  GenericValue Dest;
 
-  if (SrcVal->getType()->getTypeID() == Type::VectorTyID) {
+  if (SrcTy->getTypeID() == Type::VectorTyID) {
     Type *DstVecTy = DstTy->getScalarType();
     unsigned size = Src.AggregateVal.size();
     // the sizes of src and dst vectors must be equal
@@ -1669,11 +1790,11 @@ GenericValue Interpreter::executeUIToFPInst(Value *SrcVal, Type *DstTy,
   return Dest;
 }
 
-GenericValue Interpreter::executeSIToFPInst(Value *SrcVal, Type *DstTy,
-                                            ExecutionContext &SF) {
-  GenericValue Dest, Src = getOperandValue(SrcVal, SF);
+GenericValue Interpreter::executeSIToFPInst(GenericValue Src, Type *SrcTy,
+                                            Type *DstTy) {
+  GenericValue Dest;
 
-  if (SrcVal->getType()->getTypeID() == Type::VectorTyID) {
+  if (SrcTy->getTypeID() == Type::VectorTyID) {
     Type *DstVecTy = DstTy->getScalarType();
     unsigned size = Src.AggregateVal.size();
     // the sizes of src and dst vectors must be equal
@@ -1703,19 +1824,19 @@ GenericValue Interpreter::executeSIToFPInst(Value *SrcVal, Type *DstTy,
   return Dest;
 }
 
-GenericValue Interpreter::executePtrToIntInst(Value *SrcVal, Type *DstTy,
-                                              ExecutionContext &SF) {
+GenericValue Interpreter::executePtrToIntInst(GenericValue Src, Type *SrcTy,
+                                              Type *DstTy) {
   uint32_t DBitWidth = cast<IntegerType>(DstTy)->getBitWidth();
-  GenericValue Dest, Src = getOperandValue(SrcVal, SF);
-  assert(SrcVal->getType()->isPointerTy() && "Invalid PtrToInt instruction");
+  GenericValue Dest;
+  assert(SrcTy->isPointerTy() && "Invalid PtrToInt instruction");
 
   Dest.IntVal = APInt(DBitWidth, (intptr_t) Src.PointerVal);
   return Dest;
 }
 
-GenericValue Interpreter::executeIntToPtrInst(Value *SrcVal, Type *DstTy,
-                                              ExecutionContext &SF) {
-  GenericValue Dest, Src = getOperandValue(SrcVal, SF);
+GenericValue Interpreter::executeIntToPtrInst(GenericValue Src, Type *SrcTy,
+                                              Type *DstTy) {
+  GenericValue Dest;
   assert(DstTy->isPointerTy() && "Invalid PtrToInt instruction");
 
   uint32_t PtrSize = getDataLayout().getPointerSizeInBits();
@@ -1726,13 +1847,12 @@ GenericValue Interpreter::executeIntToPtrInst(Value *SrcVal, Type *DstTy,
   return Dest;
 }
 
-GenericValue Interpreter::executeBitCastInst(Value *SrcVal, Type *DstTy,
-                                             ExecutionContext &SF) {
+GenericValue Interpreter::executeBitCastInst(GenericValue Src, Type *SrcTy,
+                                             Type *DstTy) {
 
   // This instruction supports bitwise conversion of vectors to integers and
   // to vectors of other types (as long as they have the same size)
-  Type *SrcTy = SrcVal->getType();
-  GenericValue Dest, Src = getOperandValue(SrcVal, SF);
+  GenericValue Dest;
 
   if ((SrcTy->getTypeID() == Type::VectorTyID) ||
       (DstTy->getTypeID() == Type::VectorTyID)) {
@@ -1895,73 +2015,97 @@ GenericValue Interpreter::executeBitCastInst(Value *SrcVal, Type *DstTy,
 
 void Interpreter::visitTruncInst(TruncInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executeTruncInst(I.getOperand(0), I.getType(), SF), SF);
+  SetValue(&I, executeTruncInst(getOperandValue(I, 0, SF),
+                                I.getOperand(0)->getType(), I.getType()),
+           SF);
   // return nullptr;
 }
 
 void Interpreter::visitSExtInst(SExtInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executeSExtInst(I.getOperand(0), I.getType(), SF), SF);
+  SetValue(&I, executeSExtInst(getOperandValue(I, 0, SF),
+                               I.getOperand(0)->getType(), I.getType()),
+           SF);
   // return nullptr;
 }
 
 void Interpreter::visitZExtInst(ZExtInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executeZExtInst(I.getOperand(0), I.getType(), SF), SF);
+  SetValue(&I, executeZExtInst(getOperandValue(I, 0, SF),
+                               I.getOperand(0)->getType(), I.getType()),
+           SF);
   // return nullptr;
 }
 
 void Interpreter::visitFPTruncInst(FPTruncInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executeFPTruncInst(I.getOperand(0), I.getType(), SF), SF);
+  SetValue(&I, executeFPTruncInst(getOperandValue(I, 0, SF),
+                                  I.getOperand(0)->getType(), I.getType()),
+           SF);
   // return nullptr;
 }
 
 void Interpreter::visitFPExtInst(FPExtInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executeFPExtInst(I.getOperand(0), I.getType(), SF), SF);
+  SetValue(&I, executeFPExtInst(getOperandValue(I, 0, SF),
+                                I.getOperand(0)->getType(), I.getType()),
+           SF);
   // return nullptr;
 }
 
 void Interpreter::visitUIToFPInst(UIToFPInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executeUIToFPInst(I.getOperand(0), I.getType(), SF), SF);
+  SetValue(&I, executeUIToFPInst(getOperandValue(I, 0, SF),
+                                 I.getOperand(0)->getType(), I.getType()),
+           SF);
   // return nullptr;
 }
 
 void Interpreter::visitSIToFPInst(SIToFPInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executeSIToFPInst(I.getOperand(0), I.getType(), SF), SF);
+  SetValue(&I, executeSIToFPInst(getOperandValue(I, 0, SF),
+                                 I.getOperand(0)->getType(), I.getType()),
+           SF);
   // return nullptr;
 }
 
 void Interpreter::visitFPToUIInst(FPToUIInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executeFPToUIInst(I.getOperand(0), I.getType(), SF), SF);
+  SetValue(&I, executeFPToUIInst(getOperandValue(I, 0, SF),
+                                 I.getOperand(0)->getType(), I.getType()),
+           SF);
   // return nullptr;
 }
 
 void Interpreter::visitFPToSIInst(FPToSIInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executeFPToSIInst(I.getOperand(0), I.getType(), SF), SF);
+  SetValue(&I, executeFPToSIInst(getOperandValue(I, 0, SF),
+                                 I.getOperand(0)->getType(), I.getType()),
+           SF);
   // return nullptr;
 }
 
 void Interpreter::visitPtrToIntInst(PtrToIntInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executePtrToIntInst(I.getOperand(0), I.getType(), SF), SF);
+  SetValue(&I, executePtrToIntInst(getOperandValue(I, 0, SF),
+                                   I.getOperand(0)->getType(), I.getType()),
+           SF);
   // return nullptr;
 }
 
 void Interpreter::visitIntToPtrInst(IntToPtrInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executeIntToPtrInst(I.getOperand(0), I.getType(), SF), SF);
+  SetValue(&I, executeIntToPtrInst(getOperandValue(I, 0, SF),
+                                   I.getOperand(0)->getType(), I.getType()),
+           SF);
   // return nullptr;
 }
 
 void Interpreter::visitBitCastInst(BitCastInst &I) {
   ExecutionContext &SF = ECStack.back();
-  SetValue(&I, executeBitCastInst(I.getOperand(0), I.getType(), SF), SF);
+  SetValue(&I, executeBitCastInst(getOperandValue(I, 0, SF),
+                                  I.getOperand(0)->getType(), I.getType()),
+           SF);
   // return nullptr;
 }
 
@@ -1973,7 +2117,7 @@ void Interpreter::visitVAArgInst(VAArgInst &I) {
 
   // Get the incoming valist parameter.  LLI treats the valist as a
   // (ec-stack-depth var-arg-index) pair.
-  GenericValue VAList = getOperandValue(I.getOperand(0), SF);
+  GenericValue VAList = getOperandValue(I, 0, SF);
   GenericValue Dest;
   GenericValue Src = ECStack[VAList.UIntPairVal.first]
                       .VarArgs[VAList.UIntPairVal.second];
@@ -2001,8 +2145,8 @@ void Interpreter::visitVAArgInst(VAArgInst &I) {
 
 void Interpreter::visitExtractElementInst(ExtractElementInst &I) {
   ExecutionContext &SF = ECStack.back();
-  GenericValue Src1 = getOperandValue(I.getOperand(0), SF);
-  GenericValue Src2 = getOperandValue(I.getOperand(1), SF);
+  GenericValue Src1 = getOperandValue(I, 0, SF);
+  GenericValue Src2 = getOperandValue(I, 1, SF);
   GenericValue Dest;
 
   Type *Ty = I.getType();
@@ -2040,9 +2184,9 @@ void Interpreter::visitInsertElementInst(InsertElementInst &I) {
   if(!(Ty->isVectorTy()) )
     llvm_unreachable("Unhandled dest type for insertelement instruction");
 
-  GenericValue Src1 = getOperandValue(I.getOperand(0), SF);
-  GenericValue Src2 = getOperandValue(I.getOperand(1), SF);
-  GenericValue Src3 = getOperandValue(I.getOperand(2), SF);
+  GenericValue Src1 = getOperandValue(I, 0, SF);
+  GenericValue Src2 = getOperandValue(I, 1, SF);
+  GenericValue Src3 = getOperandValue(I, 2, SF);
   GenericValue Dest;
 
   Type *TyContained = Ty->getContainedType(0);
@@ -2076,9 +2220,9 @@ void Interpreter::visitShuffleVectorInst(ShuffleVectorInst &I){
   if(!(Ty->isVectorTy()))
     llvm_unreachable("Unhandled dest type for shufflevector instruction");
 
-  GenericValue Src1 = getOperandValue(I.getOperand(0), SF);
-  GenericValue Src2 = getOperandValue(I.getOperand(1), SF);
-  GenericValue Src3 = getOperandValue(I.getOperand(2), SF);
+  GenericValue Src1 = getOperandValue(I, 0, SF);
+  GenericValue Src2 = getOperandValue(I, 1, SF);
+  GenericValue Src3 = getOperandValue(I, 2, SF);
   GenericValue Dest;
 
   // There is no need to check types of src1 and src2, because the compiled
@@ -2144,7 +2288,7 @@ void Interpreter::visitExtractValueInst(ExtractValueInst &I) {
   ExecutionContext &SF = ECStack.back();
   Value *Agg = I.getAggregateOperand();
   GenericValue Dest;
-  GenericValue Src = getOperandValue(Agg, SF);
+  GenericValue Src = getOperandValue(I, 0, SF);
 
   ExtractValueInst::idx_iterator IdxBegin = I.idx_begin();
   unsigned Num = I.getNumIndices();
@@ -2188,8 +2332,8 @@ void Interpreter::visitInsertValueInst(InsertValueInst &I) {
   ExecutionContext &SF = ECStack.back();
   Value *Agg = I.getAggregateOperand();
 
-  GenericValue Src1 = getOperandValue(Agg, SF);
-  GenericValue Src2 = getOperandValue(I.getOperand(1), SF);
+  GenericValue Src1 = getOperandValue(I, 0, SF);
+  GenericValue Src2 = getOperandValue(I, 1, SF);
   GenericValue Dest = Src1; // Dest is a slightly changed Src1
 
   ExtractValueInst::idx_iterator IdxBegin = I.idx_begin();
@@ -2235,32 +2379,43 @@ GenericValue Interpreter::getConstantExprValue (ConstantExpr *CE,
                                                 ExecutionContext &SF) {
   switch (CE->getOpcode()) {
   case Instruction::Trunc:
-      return executeTruncInst(CE->getOperand(0), CE->getType(), SF);
+      return executeTruncInst(getOperandValue(CE->getOperand(0), SF),
+                              CE->getOperand(0)->getType(), CE->getType());
   case Instruction::ZExt:
-      return executeZExtInst(CE->getOperand(0), CE->getType(), SF);
+      return executeZExtInst(getOperandValue(CE->getOperand(0), SF),
+                             CE->getOperand(0)->getType(), CE->getType());
   case Instruction::SExt:
-      return executeSExtInst(CE->getOperand(0), CE->getType(), SF);
+      return executeSExtInst(getOperandValue(CE->getOperand(0), SF),
+                             CE->getOperand(0)->getType(), CE->getType());
   case Instruction::FPTrunc:
-      return executeFPTruncInst(CE->getOperand(0), CE->getType(), SF);
+      return executeFPTruncInst(getOperandValue(CE->getOperand(0), SF),
+                                CE->getOperand(0)->getType(), CE->getType());
   case Instruction::FPExt:
-      return executeFPExtInst(CE->getOperand(0), CE->getType(), SF);
+      return executeFPExtInst(getOperandValue(CE->getOperand(0), SF),
+                              CE->getOperand(0)->getType(), CE->getType());
   case Instruction::UIToFP:
-      return executeUIToFPInst(CE->getOperand(0), CE->getType(), SF);
+      return executeUIToFPInst(getOperandValue(CE->getOperand(0), SF),
+                               CE->getOperand(0)->getType(), CE->getType());
   case Instruction::SIToFP:
-      return executeSIToFPInst(CE->getOperand(0), CE->getType(), SF);
+      return executeSIToFPInst(getOperandValue(CE->getOperand(0), SF),
+                               CE->getOperand(0)->getType(), CE->getType());
   case Instruction::FPToUI:
-      return executeFPToUIInst(CE->getOperand(0), CE->getType(), SF);
+      return executeFPToUIInst(getOperandValue(CE->getOperand(0), SF),
+                               CE->getOperand(0)->getType(), CE->getType());
   case Instruction::FPToSI:
-      return executeFPToSIInst(CE->getOperand(0), CE->getType(), SF);
+      return executeFPToSIInst(getOperandValue(CE->getOperand(0), SF),
+                               CE->getOperand(0)->getType(), CE->getType());
   case Instruction::PtrToInt:
-      return executePtrToIntInst(CE->getOperand(0), CE->getType(), SF);
+      return executePtrToIntInst(getOperandValue(CE->getOperand(0), SF),
+                                 CE->getOperand(0)->getType(), CE->getType());
   case Instruction::IntToPtr:
-      return executeIntToPtrInst(CE->getOperand(0), CE->getType(), SF);
+      return executeIntToPtrInst(getOperandValue(CE->getOperand(0), SF),
+                                 CE->getOperand(0)->getType(), CE->getType());
   case Instruction::BitCast:
-      return executeBitCastInst(CE->getOperand(0), CE->getType(), SF);
+      return executeBitCastInst(getOperandValue(CE->getOperand(0), SF),
+                                CE->getOperand(0)->getType(), CE->getType());
   case Instruction::GetElementPtr:
-    return executeGEPOperation(CE->getOperand(0), gep_type_begin(CE),
-                               gep_type_end(CE), SF);
+    return executeGEPOperation(CE, SF);
   case Instruction::FCmp:
   case Instruction::ICmp:
     return executeCmpInst(CE->getPredicate(),
@@ -2314,7 +2469,46 @@ GenericValue Interpreter::getConstantExprValue (ConstantExpr *CE,
   return Dest;
 }
 
+GenericValue Interpreter::getSlotValue(int Slot, ExecutionContext &SF) {
+  if (Slot >= 0)
+    return (unsigned)Slot < SF.Values.size() ? SF.Values[Slot]
+                                             : GenericValue();
+
+  // Constants do not depend on the frame, evaluate them once.
+  DecodedFunction &DF = *SF.Decoded;
+  unsigned C = -1 - Slot;
+  if (!DF.Materialized[C]) {
+    if (ConstantExpr *CE = dyn_cast<ConstantExpr>(DF.ConstantOperands[C]))
+      DF.Constants[C] = getConstantExprValue(CE, SF);
+    else
+      DF.Constants[C] = getConstantValue(DF.ConstantOperands[C]);
+    DF.Materialized[C] = true;
+  }
+  return DF.Constants[C];
+}
+
+// Operand i of I. The slots of the operands of the instruction being executed
+// are resolved when its function is decoded; other values are looked up.
+GenericValue Interpreter::getOperandValue(Instruction &I, unsigned i,
+                                          ExecutionContext &SF) {
+  if (SF.Decoded && SF.PC != 0) {
+    const DecodedInstruction &DI = SF.Decoded->Code[SF.PC - 1];
+    if (DI.I == &I) {
+      int Slot = SF.Decoded->OperandSlots[DI.FirstOperand + i];
+      if (Slot != DecodedFunction::NoSlot)
+        return getSlotValue(Slot, SF);
+    }
+  }
+  return getOperandValue(I.getOperand(i), SF);
+}
+
 GenericValue Interpreter::getOperandValue(Value *V, ExecutionContext &SF) {
+  if (SF.Decoded) {
+    DenseMap<const Value *, int>::iterator It = SF.Decoded->Index.find(V);
+    if (It != SF.Decoded->Index.end())
+      return getSlotValue(It->second, SF);
+  }
+
   if (ConstantExpr *CE = dyn_cast<ConstantExpr>(V)) {
     return getConstantExprValue(CE, SF);
   } else if (Constant *CPV = dyn_cast<Constant>(V)) {
@@ -2322,7 +2516,8 @@ GenericValue Interpreter::getOperandValue(Value *V, ExecutionContext &SF) {
   } else if (GlobalValue *GV = dyn_cast<GlobalValue>(V)) {
     return PTOGV(getPointerToGlobal(GV));
   } else {
-    return SF.Values[V];
+    // A value of the frame that has not been defined yet.
+    return GenericValue();
   }
 }
 
@@ -2330,6 +2525,136 @@ GenericValue Interpreter::getOperandValue(Value *V, ExecutionContext &SF) {
 //                        Dispatch and Execution Code
 //===----------------------------------------------------------------------===//
 
+// Handlers of the instructions without a specialized implementation: the
+// visit method of the opcode, resolved without going through InstVisitor.
+#define HANDLE_INST(NUM, OPCODE, CLASS)                                        \
+  static void dispatch##OPCODE(Interpreter &Interp,                            \
+                               const DecodedInstruction &DI,                   \
+                               ExecutionContext &SF) {                         \
+    Interp.visit##OPCODE(*static_cast<CLASS *>(DI.I));                         \
+  }
+#include "llvm/IR/Instruction.def"
+
+static InstructionHandler getInstructionHandler(unsigned Opcode) {
+  switch (Opcode) {
+#define HANDLE_INST(NUM, OPCODE, CLASS)                                        \
+  case NUM:                                                                    \
+    return dispatch##OPCODE;
+#include "llvm/IR/Instruction.def"
+  default:
+    llvm_unreachable("Unknown instruction opcode");
+  }
+}
+
+// Static properties of the instructions of the interpreted modules. Built
+// when the first function is decoded, after the intrinsics have been lowered,
+// and read-only afterwards, so it is shared with analyzers running on other
+// threads. Decoded instructions point to their descriptor.
+static std::unique_ptr<InstructionDescriptorTable> Descriptors;
+
+static void describeModules(SmallVectorImpl<std::unique_ptr<Module> > &Modules) {
+  if (Descriptors)
+    return;
+  Descriptors.reset(new InstructionDescriptorTable(TargetFunction));
+  for (std::unique_ptr<Module> &M : Modules)
+    Descriptors->addModule(*M);
+}
+
+static const InstructionDescriptor &getDescriptor(Instruction &I) {
+  const InstructionDescriptor *Descriptor = Descriptors->lookup(I);
+  if (!Descriptor)
+    report_fatal_error("Instruction created after the descriptors were built");
+  return *Descriptor;
+}
+
+void Interpreter::decodeFunction(DecodedFunction &DF) {
+  describeModules(Modules);
+  DF.numberValues();
+  DF.Code.clear();
+  DF.OperandSlots.clear();
+  DF.Edges.clear();
+  DF.Moves.clear();
+  DF.BlockStart.clear();
+  DF.Position.clear();
+
+  // Lay out the blocks, without their PHI nodes.
+  unsigned NInstructions = 0;
+  for (BasicBlock &BB : DF.F) {
+    DF.BlockStart[&BB] = NInstructions;
+    for (Instruction &I : BB)
+      if (!isa<PHINode>(I))
+        DF.Position[&I] = NInstructions++;
+  }
+  DF.Code.reserve(NInstructions);
+
+  auto addEdge = [&DF](BasicBlock *From, BasicBlock *Dest,
+                       const ConstantInt *CaseValue) {
+    DecodedEdge Edge = {Dest, DF.BlockStart[Dest], (unsigned)DF.Moves.size(),
+                        0, CaseValue};
+    for (BasicBlock::iterator It = Dest->begin();
+         PHINode *PN = dyn_cast<PHINode>(It); ++It) {
+      int i = PN->getBasicBlockIndex(From);
+      assert(i != -1 && "PHINode doesn't contain entry for predecessor??");
+      PHIMove Move = {(unsigned)DF.Index[PN],
+                      DF.Index[PN->getIncomingValue(i)]};
+      DF.Moves.push_back(Move);
+      Edge.NMoves++;
+    }
+    DF.Edges.push_back(Edge);
+  };
+
+  for (BasicBlock &BB : DF.F)
+    for (Instruction &I : BB) {
+      if (isa<PHINode>(I))
+        continue;
+      DecodedInstruction DI = {&I, &getDescriptor(I),
+                               getInstructionHandler(I.getOpcode()), 0,
+                               (unsigned)DF.Edges.size(), 0,
+                               (unsigned)DF.OperandSlots.size(),
+                               I.getType()->isVoidTy() ? DecodedFunction::NoSlot
+                                                       : DF.Index[&I]};
+      for (Value *Op : I.operands()) {
+        DenseMap<const Value *, int>::iterator It = DF.Index.find(Op);
+        DF.OperandSlots.push_back(
+            It != DF.Index.end() ? It->second : DecodedFunction::NoSlot);
+      }
+      if (BranchInst *BI = dyn_cast<BranchInst>(&I)) {
+        if (BI->isUnconditional()) {
+          DI.Handler = executeBranch;
+        } else {
+          DI.Handler = executeCondBranch;
+          DI.Condition = DF.Index[BI->getCondition()];
+        }
+        for (BasicBlock *Succ : BI->successors())
+          addEdge(&BB, Succ, nullptr);
+      } else if (SwitchInst *SI = dyn_cast<SwitchInst>(&I)) {
+        DI.Handler = executeSwitch;
+        DI.Condition = DF.Index[SI->getCondition()];
+        addEdge(&BB, SI->getDefaultDest(), nullptr);
+        for (auto Case : SI->cases())
+          addEdge(&BB, Case.getCaseSuccessor(), Case.getCaseValue());
+      }
+      DI.NEdges = DF.Edges.size() - DI.FirstEdge;
+      DF.Code.push_back(DI);
+    }
+}
+
+void Interpreter::redecodeFunction(DecodedFunction &DF, Instruction *Resume) {
+  // Frames of DF.F below the top of the stack are suspended at a call, which
+  // is the instruction before their PC.
+  std::vector<Instruction *> Calls(ECStack.size() - 1, nullptr);
+  for (unsigned i = 0; i + 1 < ECStack.size(); i++)
+    if (ECStack[i].Decoded == &DF)
+      Calls[i] = DF.Code[ECStack[i].PC - 1].I;
+
+  decodeFunction(DF);
+
+  for (unsigned i = 0; i + 1 < ECStack.size(); i++)
+    if (Calls[i])
+      ECStack[i].PC = DF.Position[Calls[i]] + 1;
+  ECStack.back().PC = DF.Position[Resume];
+}
+
 //===----------------------------------------------------------------------===//
 // callFunction - Execute the specified function...
 //
@@ -2350,9 +2675,18 @@ void Interpreter::callFunction(Function *F, ArrayRef<GenericValue> ArgVals) {
     return;
   }
 
+  // Decode the function the first time it is called.
+  std::unique_ptr<DecodedFunction> &Decoded = DecodedFunctions[F];
+  if (!Decoded) {
+    Decoded.reset(new DecodedFunction(*F));
+    decodeFunction(*Decoded);
+  }
+  StackFrame.Decoded = Decoded.get();
+  StackFrame.Values.resize(Decoded->NSlots);
+
   // Get pointers to first LLVM BB & Instruction in function.
   StackFrame.CurBB     = &F->front();
-  StackFrame.CurInst   = StackFrame.CurBB->begin();
+  StackFrame.PC        = 0;
 
   // Run through the function arguments and initialize their values...
   assert((ArgVals.size() == F->arg_size() ||
@@ -2370,201 +2704,803 @@ void Interpreter::callFunction(Function *F, ArrayRef<GenericValue> ArgVals) {
 }
 
 
-void Interpreter::run() {
-	
-    
-
-	//================== Code inserted into the interpreter ================
-
-	uint64_t Address = 0;
-	clock_t  tStartPostProcessing, tEndPostProcessing,
-			tStartCacheWarmed, tEndCacheWarmed;
-	float CyclesPostProcessing,
-			ExecutionTimePostProcessing, ExecutionTimeActualSimulation;
-	static DynamicAnalysis* Analyzer;
-	Analyzer = new DynamicAnalysis(TargetFunction, Microarchitecture,
-                                 MemoryWordSize, CacheLineSize, RegisterFileSize, L1CacheSize,
-                                 L2CacheSize, LLCCacheSize, ExecutionUnitsLatency,
-                                 ExecutionUnitsThroughput, ExecutionUnitsParallelIssue,
-                                 MemAccessGranularity, AddressGenerationUnits, IFB,
-                                 ReservationStation, ReorderBuffer, LoadBuffer, StoreBuffer,
-                                 LineFillBuffer, WarmCache, x86MemoryModel, ARMMemoryModel, SpatialPrefetcher,
-                                 ConstraintPorts, ConstraintPortsx86, ConstraintPortsARM, ConstraintAGUs, 0,
-                                 InOrderExecution, ReportOnlyPerformance, PrefetchLevel,
-                                 PrefetchDispatch, PrefetchTarget,OutputDir,FloatPrecision, VectorCode, VectorWidth);
-  
-
-
-	//tStart = clock();
-	bool startAnalysis = false;
-
-
-
-
-  while (!ECStack.empty()) {
-    // Interpret a single instruction & increment the "PC".
-    ExecutionContext &SF = ECStack.back();  // Current stack frame
-
-    Instruction &I = *SF.CurInst++;         // Increment before execute
+//===----------------------------------------------------------------------===//
+//                  Dynamic analysis of the instruction stream
+//===----------------------------------------------------------------------===//
 
-    // Track the number of dynamic instructions executed.
-    ++NumDynamicInsts;
+// Parameters of a modeled microarchitecture, i.e., the arguments of the
+// DynamicAnalysis constructor. They are taken from the command line and, in
+// a multi-configuration run, overridden by a JSON configuration file whose
+// keys are the names of the command line options.
+struct AnalysisParameters {
+  std::string Microarchitecture;
+  unsigned MemoryWordSize;
+  unsigned CacheLineSize;
+  unsigned RegisterFileSize;
+  unsigned L1CacheSize;
+  unsigned L2CacheSize;
+  unsigned LLCCacheSize;
+  std::vector<float> ExecutionUnitsLatency;
+  std::vector<double> ExecutionUnitsThroughput;
+  std::vector<int> ExecutionUnitsParallelIssue;
+  std::vector<unsigned> MemAccessGranularity;
+  int AddressGenerationUnits;
+  int InstructionFetchBandwidth;
+  int ReservationStationSize;
+  int ReorderBufferSize;
+  int LoadBufferSize;
+  int StoreBufferSize;
+  int LineFillBufferSize;
+  bool WarmCache;
+  bool x86MemoryModel;
+  bool ARMMemoryModel;
+  bool SpatialPrefetcher;
+  bool ConstraintPorts;
+  bool ConstraintPortsx86;
+  bool ConstraintPortsARM;
+  bool ConstraintAGUs;
+  unsigned DispatchPorts;
+  bool InOrderExecution;
+  bool ReportOnlyPerformance;
+  unsigned PrefetchLevel;
+  unsigned PrefetchDispatch;
+  unsigned PrefetchTarget;
+  std::string OutputDir;
+  bool FloatPrecision;
+  bool VectorCode;
+  unsigned VectorWidth;
+};
+
+static AnalysisParameters getCommandLineParameters() {
+  AnalysisParameters P;
+  P.Microarchitecture = Microarchitecture;
+  P.MemoryWordSize = MemoryWordSize;
+  P.CacheLineSize = CacheLineSize;
+  P.RegisterFileSize = RegisterFileSize;
+  P.L1CacheSize = L1CacheSize;
+  P.L2CacheSize = L2CacheSize;
+  P.LLCCacheSize = LLCCacheSize;
+  P.ExecutionUnitsLatency = ExecutionUnitsLatency;
+  P.ExecutionUnitsThroughput = ExecutionUnitsThroughput;
+  P.ExecutionUnitsParallelIssue = ExecutionUnitsParallelIssue;
+  P.MemAccessGranularity = MemAccessGranularity;
+  P.AddressGenerationUnits = AddressGenerationUnits;
+  P.InstructionFetchBandwidth = IFB;
+  P.ReservationStationSize = ReservationStation;
+  P.ReorderBufferSize = ReorderBuffer;
+  P.LoadBufferSize = LoadBuffer;
+  P.StoreBufferSize = StoreBuffer;
+  P.LineFillBufferSize = LineFillBuffer;
+  P.WarmCache = WarmCache;
+  P.x86MemoryModel = x86MemoryModel;
+  P.ARMMemoryModel = ARMMemoryModel;
+  P.SpatialPrefetcher = SpatialPrefetcher;
+  P.ConstraintPorts = ConstraintPorts;
+  P.ConstraintPortsx86 = ConstraintPortsx86;
+  P.ConstraintPortsARM = ConstraintPortsARM;
+  P.ConstraintAGUs = ConstraintAGUs;
+  P.DispatchPorts = DispatchPorts;
+  P.InOrderExecution = InOrderExecution;
+  P.ReportOnlyPerformance = ReportOnlyPerformance;
+  P.PrefetchLevel = PrefetchLevel;
+  P.PrefetchDispatch = PrefetchDispatch;
+  P.PrefetchTarget = PrefetchTarget;
+  P.OutputDir = OutputDir;
+  P.FloatPrecision = FloatPrecision;
+  P.VectorCode = VectorCode;
+  P.VectorWidth = VectorWidth;
+  return P;
+}
+
+// Threads that compute the span matrices at the end of the analysis, shared
+// by all the analyzers, so that a run with several configurations does not
+// create a pool of hardware threads for each of them.
+static std::unique_ptr<ThreadPool> SpanThreadPool;
+
+static DynamicAnalysis *createAnalyzer(const AnalysisParameters &P) {
+  DynamicAnalysis *Analyzer = new DynamicAnalysis(TargetFunction, P.Microarchitecture,
+                             P.MemoryWordSize, P.CacheLineSize, P.RegisterFileSize, P.L1CacheSize,
+                             P.L2CacheSize, P.LLCCacheSize, P.ExecutionUnitsLatency,
+                             P.ExecutionUnitsThroughput, P.ExecutionUnitsParallelIssue,
+                             P.MemAccessGranularity, P.AddressGenerationUnits, P.InstructionFetchBandwidth,
+                             P.ReservationStationSize, P.ReorderBufferSize, P.LoadBufferSize, P.StoreBufferSize,
+                             P.LineFillBufferSize, P.WarmCache, P.x86MemoryModel, P.ARMMemoryModel, P.SpatialPrefetcher,
+                             P.ConstraintPorts, P.ConstraintPortsx86, P.ConstraintPortsARM, P.ConstraintAGUs, P.DispatchPorts, 0,
+                             P.InOrderExecution, P.ReportOnlyPerformance, P.PrefetchLevel,
+                             P.PrefetchDispatch, P.PrefetchTarget, P.OutputDir, P.FloatPrecision, P.VectorCode, P.VectorWidth);
+  Analyzer->SharedInstructionDescriptors = Descriptors.get();
+  if (!SpanThreadPool)
+    SpanThreadPool.reset(new ThreadPool());
+  Analyzer->SharedThreadPool = SpanThreadPool.get();
+  return Analyzer;
+}
+
+template <typename T>
+static T parseConfigValue(StringRef Key, StringRef Value, const std::string &Filename) {
+  T Result;
+  if (Value.trim().getAsInteger(0, Result))
+    report_fatal_error("Invalid value '" + Value + "' for " + Key + " in " +
+                       Filename);
+  return Result;
+}
 
- 		
+template <>
+bool parseConfigValue<bool>(StringRef Key, StringRef Value, const std::string &Filename) {
+  Value = Value.trim();
+  if (Value == "true")
+    return true;
+  if (Value == "false")
+    return false;
+  return parseConfigValue<unsigned>(Key, Value, Filename) != 0;
+}
+
+template <>
+double parseConfigValue<double>(StringRef Key, StringRef Value, const std::string &Filename) {
+  std::string Str = Value.trim();
+  char *End;
+  double Result = strtod(Str.c_str(), &End);
+  if (Str.empty() || *End != '\0')
+    report_fatal_error("Invalid value '" + Value + "' for " + Key + " in " +
+                       Filename);
+  return Result;
+}
 
+template <>
+float parseConfigValue<float>(StringRef Key, StringRef Value, const std::string &Filename) {
+  return parseConfigValue<double>(Key, Value, Filename);
+}
 
-		// Check for conditions of execution. It is doing before visiting the instruction
-		// because lowering some instructions may cause a segmentation fault when
-		// accessing instruction properties.
+// Lists are written as in the command line, optionally between braces, e.g.
+// "{3,3,5,5}".
+template <typename T>
+static std::vector<T> parseConfigList(StringRef Key, StringRef Value, const std::string &Filename) {
+  std::vector<T> Result;
+  SmallVector<StringRef, 32> Elements;
+  Value = Value.trim();
+  if (Value.startswith("{") && Value.endswith("}"))
+    Value = Value.drop_front().drop_back();
+  Value.split(Elements, ',', -1, false);
+  for (StringRef Element : Elements)
+    Result.push_back(parseConfigValue<T>(Key, Element, Filename));
+  return Result;
+}
 
-		bool isTargetFunction = (I.getParent()->getParent()->getName().find(
-				TargetFunction) != string::npos);
+static void setConfigParameter(AnalysisParameters &P, StringRef Key, StringRef Value,
+                               const std::string &Filename) {
+  if (Key == "uarch") P.Microarchitecture = Value;
+  else if (Key == "memory-word-size") P.MemoryWordSize = parseConfigValue<unsigned>(Key, Value, Filename);
+  else if (Key == "cache-line-size") P.CacheLineSize = parseConfigValue<unsigned>(Key, Value, Filename);
+  else if (Key == "register-file-size") P.RegisterFileSize = parseConfigValue<unsigned>(Key, Value, Filename);
+  else if (Key == "l1-cache-size") P.L1CacheSize = parseConfigValue<unsigned>(Key, Value, Filename);
+  else if (Key == "l2-cache-size") P.L2CacheSize = parseConfigValue<unsigned>(Key, Value, Filename);
+  else if (Key == "llc-cache-size") P.LLCCacheSize = parseConfigValue<unsigned>(Key, Value, Filename);
+  else if (Key == "execution-units-latency") P.ExecutionUnitsLatency = parseConfigList<float>(Key, Value, Filename);
+  else if (Key == "execution-units-throughput") P.ExecutionUnitsThroughput = parseConfigList<double>(Key, Value, Filename);
+  else if (Key == "execution-units-parallel-issue") P.ExecutionUnitsParallelIssue = parseConfigList<int>(Key, Value, Filename);
+  else if (Key == "mem-access-granularity") P.MemAccessGranularity = parseConfigList<unsigned>(Key, Value, Filename);
+  else if (Key == "address-generation-units") P.AddressGenerationUnits = parseConfigValue<int>(Key, Value, Filename);
+  else if (Key == "instruction-fetch-bandwidth") P.InstructionFetchBandwidth = parseConfigValue<int>(Key, Value, Filename);
+  else if (Key == "reservation-station-size") P.ReservationStationSize = parseConfigValue<int>(Key, Value, Filename);
+  else if (Key == "reorder-buffer-size") P.ReorderBufferSize = parseConfigValue<int>(Key, Value, Filename);
+  else if (Key == "load-buffer-size") P.LoadBufferSize = parseConfigValue<int>(Key, Value, Filename);
+  else if (Key == "store-buffer-size") P.StoreBufferSize = parseConfigValue<int>(Key, Value, Filename);
+  else if (Key == "line-fill-buffer-size") P.LineFillBufferSize = parseConfigValue<int>(Key, Value, Filename);
+  else if (Key == "warm-cache") P.WarmCache = parseConfigValue<bool>(Key, Value, Filename);
+  else if (Key == "x86-memory-model") P.x86MemoryModel = parseConfigValue<bool>(Key, Value, Filename);
+  else if (Key == "arm-memory-model") P.ARMMemoryModel = parseConfigValue<bool>(Key, Value, Filename);
+  else if (Key == "spatial-prefetcher") P.SpatialPrefetcher = parseConfigValue<bool>(Key, Value, Filename);
+  else if (Key == "constraint-ports") P.ConstraintPorts = parseConfigValue<bool>(Key, Value, Filename);
+  else if (Key == "constraint-ports-x86") P.ConstraintPortsx86 = parseConfigValue<bool>(Key, Value, Filename);
+  else if (Key == "constraint-ports-ARM") P.ConstraintPortsARM = parseConfigValue<bool>(Key, Value, Filename);
+  else if (Key == "constraint-agus") P.ConstraintAGUs = parseConfigValue<bool>(Key, Value, Filename);
+  else if (Key == "dispatch-ports") P.DispatchPorts = parseConfigValue<unsigned>(Key, Value, Filename);
+  else if (Key == "in-order-execution") P.InOrderExecution = parseConfigValue<bool>(Key, Value, Filename);
+  else if (Key == "report-only-performance") P.ReportOnlyPerformance = parseConfigValue<bool>(Key, Value, Filename);
+  else if (Key == "prefetch-level") P.PrefetchLevel = parseConfigValue<unsigned>(Key, Value, Filename);
+  else if (Key == "prefetch-dispatch") P.PrefetchDispatch = parseConfigValue<unsigned>(Key, Value, Filename);
+  else if (Key == "prefetch-target") P.PrefetchTarget = parseConfigValue<unsigned>(Key, Value, Filename);
+  else if (Key == "output-dir") P.OutputDir = Value;
+  else if (Key == "float-precision") P.FloatPrecision = parseConfigValue<bool>(Key, Value, Filename);
+  else if (Key == "vector-code") P.VectorCode = parseConfigValue<bool>(Key, Value, Filename);
+  else if (Key == "max-vector-width") P.VectorWidth = parseConfigValue<unsigned>(Key, Value, Filename);
+  else
+    report_fatal_error("Unknown parameter " + Key + " in " + Filename);
+}
+
+// Read a configuration file (configs/configX.json) on top of the command line
+// parameters. The results of each configuration go to a subdirectory of
+// -output-dir named after the file, unless the file sets output-dir itself.
+static AnalysisParameters readConfigFile(const std::string &Filename) {
+  AnalysisParameters P = getCommandLineParameters();
+  P.OutputDir = OutputDir + "/" + sys::path::stem(Filename).str();
+
+  ErrorOr<std::unique_ptr<MemoryBuffer>> FileOrErr = MemoryBuffer::getFile(Filename);
+  if (std::error_code EC = FileOrErr.getError())
+    report_fatal_error("Cannot open configuration file " + Filename + ": " +
+                       EC.message());
+  // JSON is a subset of YAML, so the YAML parser is enough to read the file.
+  SourceMgr SM;
+  yaml::Stream Stream(FileOrErr.get()->getBuffer(), SM);
+  yaml::document_iterator DI = Stream.begin();
+  yaml::MappingNode *Root =
+      DI == Stream.end() ? nullptr : dyn_cast_or_null<yaml::MappingNode>(DI->getRoot());
+  if (Root == nullptr)
+    report_fatal_error("Configuration file " + Filename + " must be a JSON object");
+  for (yaml::KeyValueNode &KV : *Root) {
+    yaml::ScalarNode *Key = dyn_cast_or_null<yaml::ScalarNode>(KV.getKey());
+    yaml::ScalarNode *Value = dyn_cast_or_null<yaml::ScalarNode>(KV.getValue());
+    if (Key == nullptr || Value == nullptr)
+      report_fatal_error("Invalid entry in configuration file " + Filename);
+    SmallString<32> KeyStorage;
+    SmallString<128> ValueStorage;
+    setConfigParameter(P, Key->getValue(KeyStorage), Value->getValue(ValueStorage),
+                       Filename);
+  }
+  if (Stream.failed())
+    report_fatal_error("Cannot parse configuration file " + Filename);
+
+  if (std::error_code EC = sys::fs::create_directories(P.OutputDir))
+    report_fatal_error("Cannot create output directory " + P.OutputDir + ": " +
+                       EC.message());
+  return P;
+}
+
+// State of the analysis that persists along the dynamic instruction stream,
+// whether the stream comes from the interpreter or from a trace.
+struct AnalysisRunState {
+  bool startAnalysis;
+  clock_t tStartCacheWarmed;
+  // Name of the configuration, printed before the report when several
+  // configurations are simulated at once.
+  std::string ConfigName;
+
+  AnalysisRunState() : startAnalysis(false), tStartCacheWarmed(0) {}
+};
+
+// Reports of analyzers running on different threads are printed one at a time.
+static std::mutex ReportMutex;
+
+// Number the instructions of M in module order. The position of an
+// instruction in Instructions is the id stored in a dynamic trace.
+static void numberInstructions(Module &M, std::vector<Instruction *> &Instructions,
+                               DenseMap<Instruction *, uint32_t> &Ids) {
+  for (Function &F : M)
+    for (BasicBlock &BB : F)
+      for (Instruction &I : BB) {
+        Ids[&I] = Instructions.size();
+        Instructions.push_back(&I);
+      }
+}
 
+// Id of I in a dynamic trace. Every instruction of the modules is numbered
+// before the trace is written, so a missing id is an error rather than id 0.
+static uint32_t getStaticInstructionId(
+    const DenseMap<Instruction *, uint32_t> &Ids, Instruction *I) {
+  DenseMap<Instruction *, uint32_t>::const_iterator It = Ids.find(I);
+  if (It == Ids.end())
+    report_fatal_error("Instruction without a static id in the trace");
+  return It->second;
+}
 
-		bool isDebugInstruction = (I.getOpcode() == Instruction::Call
-				&& (I.getOperand(I.getNumOperands() - 1))->getName().str().find(
-						"llvm.dbg") != string::npos);
-		bool isCallInstruction = (I.getOpcode() == Instruction::Call);
-		bool isReturnInstruction = (I.getOpcode() == Instruction::Ret);
-		bool isCalledFromTarget = (Analyzer->FunctionCallStack > 0);
+// Functions called from the target function are analyzed too.
+// FunctionCallStack counts the calls to defined functions made from the
+// target function that have not returned yet. The call is accounted before
+// the instruction is analyzed, and the return after.
+static void enterFunctionCall(Instruction &I, uint8_t &FunctionCallStack) {
+  if (I.getOpcode() != Instruction::Call)
+    return;
+  // Make sure it is not a C++ built-in function (check llvm-nm.cpp to see how
+  //to distinguish different function types, e.g., declared functions vs. defined function).
+
+  // Check first if the called function is a function, to avoid
+  // segmentation faults in instructions like this one:
+  // %call31.i.i.i = call i8* %49(i8* %50, i32 %mul29.i.i.i, i32 1) nounwind
+  if (static_cast<CallInst&>(I).getCalledFunction()) {
+    if (!static_cast<CallInst&>(I).getCalledFunction()->isDeclaration()) {
+      FunctionCallStack++;
+    }
+  } else {
+    FunctionCallStack++;
+  }
+}
 
-		GenericValue * visitResult;
+// Returns true if I returns from the target function.
+static bool exitFunctionCall(Instruction &I, bool isTargetFunction,
+                             uint8_t &FunctionCallStack) {
+  if (I.getOpcode() != Instruction::Ret)
+    return false;
+  if (isTargetFunction && FunctionCallStack == 0)
+    return true;
+  FunctionCallStack--;
+  return false;
+}
 
-		if (!isDebugInstruction) {
-   	      	// DEBUG(dbgs() << "About to interpret: " << I);
-               if(LoadInst *LI = dyn_cast<LoadInst> (&I))
-                visitResult = getValueLoadInst(LI);
-			if(StoreInst *SI = dyn_cast<StoreInst> (&I))
-                visitResult = getValueStoreInst(SI);
-    			//visitResult = visit(I);   // Dispatch to one of the visit* methods...
- 			visit(I); 
-		}
+// Hand one dynamic instruction to the analyzer. I belongs to the target
+// function or to a function called from it, and Descriptor holds its static
+// properties. NextBB is the basic block where control is transferred to if I
+// is a branch, and null otherwise. Returns true when the analysis of the
+// target function has been completed.
+static bool analyzeDynamicInstruction(DynamicAnalysis *Analyzer, Instruction &I,
+                                      const InstructionDescriptor &Descriptor,
+                                      uint64_t Address, BasicBlock *NextBB,
+                                      AnalysisRunState &State) {
+  clock_t tStartPostProcessing, tEndPostProcessing, tEndCacheWarmed;
+  float CyclesPostProcessing, ExecutionTimePostProcessing,
+      ExecutionTimeActualSimulation;
+  bool isTargetFunction = Descriptor.IsTargetFunction;
 
-		if (isTargetFunction == true && startAnalysis == false) {
-			tStartCacheWarmed = clock();
-			startAnalysis = true;
-		}
+  if (isTargetFunction == true && State.startAnalysis == false) {
+    State.tStartCacheWarmed = clock();
+    State.startAnalysis = true;
+  }
 
-		if (isTargetFunction == true && Analyzer->rep == 1 && !WarmCache) {
-			report_fatal_error("The target function was called twice in a cold cache scenario\n");
-		}
+  if (isTargetFunction == true && Analyzer->rep == 1 && !Analyzer->WarmCache) {
+    report_fatal_error("The target function was called twice in a cold cache scenario\n");
+  }
 
-		if (!isDebugInstruction && (isTargetFunction || isCalledFromTarget)) {
+  if (Descriptor.IsDebug)
+    return false;
 
-			if (isCallInstruction) {
+  enterFunctionCall(I, Analyzer->FunctionCallStack);
+  Analyzer->TotalInstructions++;
 
-				// Make sure it is not a C++ built-in function (check llvm-nm.cpp to see how
-				//to distinguish different function types, e.g., declared functions vs. defined function).
+  Analyzer->analyzeInstruction(I, Descriptor, I.getOpcode(), Address, 0, false, 1, 0, true, true, false);
+#ifdef VALUE_ANALYSIS
+  Analyzer->collectDeadPointerToMemoryInstances();
+#endif
 
-				// Check first if the called function is a function, to avoid
-				// segmentation faults in instructions like this one:
-				// %call31.i.i.i = call i8* %49(i8* %50, i32 %mul29.i.i.i, i32 1) nounwind
-				if (static_cast<CallInst&>(I).getCalledFunction()) {
-					if (!static_cast<CallInst&>(I).getCalledFunction()->isDeclaration()) {
-						Analyzer->FunctionCallStack++;
-					}
-				} else {
-					Analyzer->FunctionCallStack++;
-				}
-			}
-			Analyzer->TotalInstructions++;
-
-  			if(visitResult != NULL){
-  		  //Transform visitResult to uint64_t
-            SmallString < 128 > StrVal;
-            raw_svector_ostream OS (StrVal);
-            OS << visitResult;
-           Address = strtol (OS.str ().str ().c_str (), NULL, 16);
-			}
+  // Dependences through PHI nodes
+  if (NextBB != nullptr) {
+    // Loop over all of the PHI nodes in the successor block, reading their inputs.
+    for (BasicBlock::iterator It = NextBB->begin();
+         PHINode *PN = dyn_cast<PHINode>(&*It); ++It) {
+      const InstructionDescriptor &PHIDescriptor = Analyzer->getInstructionDescriptor(*PN);
+      uint64_t InstructionIssueCycle = max (max (Analyzer->InstructionFetchCycle, Analyzer->BasicBlockBarrier), Analyzer->getInstructionValueIssueCycle (PHIDescriptor.Number));
+
+      // Iterate through the uses of the PHI node
+      for (const std::pair<unsigned, bool> &U : PHIDescriptor.Users)
+        Analyzer->insertInstructionValueIssueCycle (U.first, InstructionIssueCycle, U.second);
+    }
+  }
 
-           
-			Analyzer->analyzeInstruction(I, I.getOpcode(), Address, 0, false, 1, 0, true, true, false);
+  if (exitFunctionCall(I, isTargetFunction, Analyzer->FunctionCallStack)) {
+    if (!(Analyzer->WarmCache && Analyzer->rep == 0)) {
+      std::lock_guard<std::mutex> Lock(ReportMutex);
+      if (!State.ConfigName.empty())
+        Analyzer->printHeaderStat("Configuration " + State.ConfigName);
 
+      tEndCacheWarmed = clock();
+      ExecutionTimeActualSimulation =
+          ((double) (tEndCacheWarmed - State.tStartCacheWarmed))
+              / CLOCKS_PER_SEC;
+      dbgs() << "Execution time actual simulation " << ExecutionTimeActualSimulation << " s\n";
 
-  // Dependences through PHI nodes
+      tStartPostProcessing = clock();
 
+      Analyzer->finishAnalysisContechSimplified();
+      tEndPostProcessing = clock();
+      CyclesPostProcessing = ((float) tEndPostProcessing - (float) tStartPostProcessing);
+      ExecutionTimePostProcessing = CyclesPostProcessing / CLOCKS_PER_SEC;
+      dbgs() << "Execution time Post processing " << ExecutionTimePostProcessing << " s\n";
+      return true;
+    } else {
+      State.tStartCacheWarmed = clock();
 
-	 if(I.getOpcode() == Instruction::Switch || (I.getOpcode() == Instruction::Br) || (I.getOpcode() == Instruction::IndirectBr))
-        {
+      Analyzer->rep = 1;
+      Analyzer->ReuseStack.clear();
+      Analyzer->removeUnusedSpilledCacheLinesFromReuseTree();
+      Analyzer->resetInstructionValueMap();
+    }
+  }
+  return false;
+}
+
+// A dynamic instruction of the target function, or of a function called from
+// it, as handed to the analyzers.
+struct AnalysisEvent {
+  Instruction *I;
+  const InstructionDescriptor *Descriptor; // Static properties of I
+  uint64_t Address;
+  BasicBlock *NextBB;
+};
+
+// Single-producer/single-consumer ring of fixed-size records. The
+// interpreter thread pushes and the worker thread pops without locks: each
+// index is written by one thread only, and each side keeps a cached copy of
+// the other side's index to avoid touching its cache line on every access.
+template <typename T, unsigned LogCapacity>
+class SPSCRing {
+  static const size_t Capacity = size_t(1) << LogCapacity;
+  static const size_t Mask = Capacity - 1;
+
+  std::vector<T> Slots;
+  // Consumer side
+  std::atomic<size_t> Head;
+  size_t CachedTail;
+  char PadConsumer[64];
+  // Producer side
+  std::atomic<size_t> Tail;
+  size_t CachedHead;
+  char PadProducer[64];
+
+public:
+  SPSCRing() : Slots(Capacity), Head(0), CachedTail(0), Tail(0), CachedHead(0) {}
+
+  bool tryPush(const T &Record) {
+    size_t T0 = Tail.load(std::memory_order_relaxed);
+    if (T0 - CachedHead == Capacity) {
+      CachedHead = Head.load(std::memory_order_acquire);
+      if (T0 - CachedHead == Capacity)
+        return false;
+    }
+    Slots[T0 & Mask] = Record;
+    Tail.store(T0 + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Apply F to all the available records and release their slots at once.
+  // Returns the number of records consumed.
+  template <typename Fn> size_t popAll(Fn F) {
+    size_t H = Head.load(std::memory_order_relaxed);
+    if (H == CachedTail) {
+      CachedTail = Tail.load(std::memory_order_acquire);
+      if (H == CachedTail)
+        return 0;
+    }
+    for (size_t i = H; i != CachedTail; i++)
+      F(Slots[i & Mask]);
+    Head.store(CachedTail, std::memory_order_release);
+    return CachedTail - H;
+  }
+
+  // Can be called from either side, to decide whether to wait.
+  bool empty() const {
+    return Head.load(std::memory_order_acquire) ==
+           Tail.load(std::memory_order_acquire);
+  }
+  bool full() const {
+    return Tail.load(std::memory_order_acquire) -
+               Head.load(std::memory_order_acquire) ==
+           Capacity;
+  }
+};
+
+// Log2 of the number of events that fit in the ring of a worker thread.
+#define ANALYSIS_RING_LOG_SIZE 16
+// Number of times a side of the ring yields before blocking.
+#define ANALYSIS_SPIN_LIMIT 1024
+
+// Analyzer of one configuration. Events are analyzed on the caller's thread,
+// or, in a pipelined or multi-configuration run, pushed into a ring consumed
+// by a worker thread that owns the analyzer.
+class AnalysisWorker {
+  std::unique_ptr<DynamicAnalysis> Analyzer;
+  AnalysisRunState State;
+
+  bool Threaded;
+  std::thread Thread;
+  SPSCRing<AnalysisEvent, ANALYSIS_RING_LOG_SIZE> Ring;
+  std::atomic<bool> Done;
+  // Set once the analysis of the target function has been completed.
+  std::atomic<bool> Completed;
+
+  // A side that has spun ANALYSIS_SPIN_LIMIT times without progress blocks
+  // until the other side notifies it. The waiting side publishes its flag and
+  // then checks the ring again, and the notifying side publishes its progress
+  // and then checks the flag. The fences between both steps ensure that at
+  // least one of them sees the other, so a wakeup cannot be missed.
+  std::mutex WaitMutex;
+  std::condition_variable ConsumerCV;
+  std::condition_variable ProducerCV;
+  std::atomic<bool> ConsumerWaiting;
+  std::atomic<bool> ProducerWaiting;
+
+  template <typename Pred>
+  void wait(std::condition_variable &CV, std::atomic<bool> &Waiting, Pred P) {
+    std::unique_lock<std::mutex> Lock(WaitMutex);
+    Waiting.store(true, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    CV.wait(Lock, P);
+    Waiting.store(false, std::memory_order_relaxed);
+  }
+
+  void notify(std::condition_variable &CV, const std::atomic<bool> &Waiting) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!Waiting.load(std::memory_order_seq_cst))
+      return;
+    // The waiting side holds the mutex from the moment it sets its flag until
+    // it sleeps, so the notification cannot arrive before the wait.
+    std::lock_guard<std::mutex> Lock(WaitMutex);
+    CV.notify_one();
+  }
+
+  void consume() {
+    auto Analyze = [this](const AnalysisEvent &E) {
+      if (analyzeDynamicInstruction(Analyzer.get(), *E.I, *E.Descriptor,
+                                    E.Address, E.NextBB, State))
+        Completed.store(true, std::memory_order_release);
+    };
+    unsigned Spins = 0;
+    while (true) {
+      if (Ring.popAll(Analyze) != 0) {
+        notify(ProducerCV, ProducerWaiting);
+        Spins = 0;
+        continue;
+      }
+      // Done is set after the last push, so the ring has to be checked again.
+      if (Done.load(std::memory_order_acquire)) {
+        Ring.popAll(Analyze);
+        return;
+      }
+      if (++Spins < ANALYSIS_SPIN_LIMIT) {
+        std::this_thread::yield();
+        continue;
+      }
+      wait(ConsumerCV, ConsumerWaiting, [this] {
+        return !Ring.empty() || Done.load(std::memory_order_acquire);
+      });
+    }
+  }
 
+public:
+  AnalysisWorker(DynamicAnalysis *Analyzer, const std::string &ConfigName,
+                 bool Threaded)
+      : Analyzer(Analyzer), Threaded(Threaded), Done(false), Completed(false),
+        ConsumerWaiting(false), ProducerWaiting(false) {
+    State.ConfigName = ConfigName;
+    if (Threaded)
+      Thread = std::thread(&AnalysisWorker::consume, this);
+  }
 
-          // Loop over all of the PHI nodes in the current block, reading their inputs.
-  BasicBlock *PrevBB = SF.CurBB;      // Remember where we came from...
-  BasicBlock::iterator PrevInst =   SF.CurInst;      // Remember where we came from...
+  ~AnalysisWorker() { finish(); }
 
-		SF.CurInst = SF.CurBB->begin();
+  // Returns true when the analysis of the target function has been completed.
+  // An analyzer running on a worker thread reports it some events later.
+  bool analyze(const AnalysisEvent &E) {
+    if (!Threaded) {
+      if (analyzeDynamicInstruction(Analyzer.get(), *E.I, *E.Descriptor,
+                                    E.Address, E.NextBB, State))
+        Completed.store(true, std::memory_order_relaxed);
+      return isCompleted();
+    }
+    for (unsigned Spins = 0; !Ring.tryPush(E);) {
+      if (++Spins < ANALYSIS_SPIN_LIMIT) {
+        std::this_thread::yield();
+        continue;
+      }
+      wait(ProducerCV, ProducerWaiting, [this] { return !Ring.full(); });
+    }
+    notify(ConsumerCV, ConsumerWaiting);
+    return isCompleted();
+  }
 
+  bool isCompleted() const { return Completed.load(std::memory_order_acquire); }
 
-          for (unsigned i = 0; PHINode * PN = dyn_cast < PHINode > (SF.CurInst); ++SF.CurInst, ++i)
-          {
-          
-            uint64_t InstructionIssueCycle = max (max (Analyzer->InstructionFetchCycle, Analyzer->BasicBlockBarrier), Analyzer->getInstructionValueIssueCycle (PN));
+  // Wait until all the events have been analyzed.
+  void finish() {
+    if (!Threaded || !Thread.joinable())
+      return;
+    Done.store(true, std::memory_order_release);
+    {
+      std::lock_guard<std::mutex> Lock(WaitMutex);
+      ConsumerCV.notify_one();
+    }
+    Thread.join();
+  }
+};
+
+// Drive the analyzers with the dynamic instruction stream recorded in
+// ReplayTrace, instead of interpreting the program.
+static void replayDynamicTrace(std::vector<std::unique_ptr<AnalysisWorker> > &Workers,
+                               const std::vector<Instruction *> &Instructions) {
+  DynamicTraceReader Reader(ReplayTrace);
+  if (Reader.getNStaticInstructions() != Instructions.size())
+    report_fatal_error("The trace " + ReplayTrace +
+                       " was not captured from this bitcode");
+
+  std::vector<const InstructionDescriptor *> InstructionDescriptors;
+  for (Instruction *I : Instructions)
+    InstructionDescriptors.push_back(&getDescriptor(*I));
+
+  AnalysisEvent Event = {nullptr, nullptr, 0, nullptr};
+  for (const DynamicTraceRecord &Record : Reader.records()) {
+    if (Record.InstructionId >= Instructions.size())
+      report_fatal_error("Invalid instruction id in trace");
+    Instruction &I = *Instructions[Record.InstructionId];
+    if (I.getOpcode() != Record.OpCode)
+      report_fatal_error("Trace record does not match the instruction opcode");
+
+    Event.I = &I;
+    Event.Descriptor = InstructionDescriptors[Record.InstructionId];
+    Event.NextBB = nullptr;
+    // Non-memory instructions keep the last address, as in the interpreter.
+    if (Record.Flags & TRACE_MEMORY_ACCESS)
+      Event.Address = Record.Payload;
+    if (Record.Flags & TRACE_BRANCH_EDGE) {
+      if (Record.Payload >= Instructions.size())
+        report_fatal_error("Invalid successor block in trace");
+      Event.NextBB = Instructions[Record.Payload]->getParent();
+    }
+    for (std::unique_ptr<AnalysisWorker> &W : Workers)
+      W->analyze(Event);
+  }
+}
 
-            // Iterate through the uses of the PHI node
-            for (Value::use_iterator ui = PN->use_begin (), ie = PN->use_end (); ui != ie; ++ui) {
-	 Use &U = *ui;
-      auto *i = cast<Instruction>(U.getUser());
+void Interpreter::run() {
+	
+    
 
-              if (PHINode * P = dyn_cast < PHINode > (i)) {
-                Analyzer->insertInstructionValueIssueCycle (i, InstructionIssueCycle, true);
-              }
-              else {
-                Analyzer->insertInstructionValueIssueCycle (i, InstructionIssueCycle);
-              } 
-            }          
-          }
+	//================== Code inserted into the interpreter ================
 
-// Restore pointers of execution context
-SF.CurBB = PrevBB;
-SF.CurInst = PrevInst;
+	uint64_t Address = 0;
 
-        }
+	// One analyzer per simulated configuration. The analyzers are owned by
+	// a static so that they are also completed if the program calls exit().
+	// They are kept across calls to run() until every configuration has seen
+	// all the calls to the target function it analyzes, because with
+	// lli -fast-forward each call to the target function is a separate run().
+	describeModules(Modules);
+
+	static std::vector<std::unique_ptr<AnalysisWorker> > Workers;
+	static unsigned TargetReturns = 0;
+	static unsigned RequiredTargetReturns = 0;
+	if (Workers.empty()) {
+	  TargetReturns = 0;
+	  RequiredTargetReturns = 0;
+	  std::vector<AnalysisParameters> Parameters;
+	  std::vector<std::string> ConfigNames;
+	  if (Configs.empty()) {
+	    Parameters.push_back(getCommandLineParameters());
+	    ConfigNames.push_back("");
+	  } else {
+	    for (const std::string &Config : Configs) {
+	      Parameters.push_back(readConfigFile(Config));
+	      ConfigNames.push_back(sys::path::stem(Config));
+	    }
+	  }
+	  for (unsigned i = 0; i < Parameters.size(); i++) {
+	    // A warm-cache analysis needs a first call to warm up the caches.
+	    RequiredTargetReturns = std::max(RequiredTargetReturns,
+	                                     Parameters[i].WarmCache ? 2u : 1u);
+	    Workers.emplace_back(new AnalysisWorker(createAnalyzer(Parameters[i]),
+	                                            ConfigNames[i],
+	                                            PipelinedAnalysis || !Configs.empty()));
+	  }
+	}
+
+	// Static instruction ids, shared by trace capture and replay.
+	static std::vector<Instruction *> StaticInstructions;
+	static DenseMap<Instruction *, uint32_t> StaticInstructionIds;
+	if ((!CaptureTrace.empty() || !ReplayTrace.empty()) &&
+	    StaticInstructions.empty())
+	  for (std::unique_ptr<Module> &M : Modules)
+	    numberInstructions(*M, StaticInstructions, StaticInstructionIds);
+
+	if (!ReplayTrace.empty()) {
+	  // The trace holds the whole analyzed stream, so it is replayed only once
+	  // even if the execution engine calls run() several times (e.g., for
+	  // static constructors). The program itself is not executed.
+	  static bool TraceReplayed = false;
+	  if (!TraceReplayed) {
+	    TraceReplayed = true;
+	    replayDynamicTrace(Workers, StaticInstructions);
+	  }
+	  Workers.clear();
+	  ECStack.clear();
+	  return;
+	}
+
+	// Owned by a static so that the trace is completed if the program calls
+	// exit().
+	static std::unique_ptr<DynamicTraceWriter> TraceWriter;
+	static bool TraceCaptured = false;
+	if (!CaptureTrace.empty() && !TraceWriter && !TraceCaptured)
+	  TraceWriter.reset(new DynamicTraceWriter(CaptureTrace, StaticInstructions.size()));
+
+	// Calls from the target function, tracked on the interpreter side to know
+	// which instructions are analyzed.
+	uint8_t FunctionCallStack = 0;
 
+  while (!ECStack.empty()) {
+    // Interpret a single instruction & increment the "PC".
+    ExecutionContext &SF = ECStack.back();  // Current stack frame
 
+    const DecodedInstruction &DI = SF.Decoded->Code[SF.PC++]; // Increment before execute
+    Instruction &I = *DI.I;
 
+    // Track the number of dynamic instructions executed.
+    ++NumDynamicInsts;
 
-			if (isReturnInstruction) {
-				if (isTargetFunction && Analyzer->FunctionCallStack == 0) {
-					//tEnd = clock();
-					//Cycles = ((float) tEnd - (float) tStart);
-					//ExecutionTime = Cycles / CLOCKS_PER_SEC;
-					if (!(WarmCache && Analyzer->rep == 0)) {
+ 		
 
-						tEndCacheWarmed = clock();
-//CyclesActualSimulation=(tEndCacheWarmed - tStartCacheWarmed);
-						// ExecutionTimeActualSimulation = CyclesActualSimulation / ((float)CLOCKS_PER_SEC);
-						ExecutionTimeActualSimulation =
-								((double) (tEndCacheWarmed - tStartCacheWarmed))
-										/ CLOCKS_PER_SEC;
-						dbgs() << "Execution time actual simulation " << ExecutionTimeActualSimulation << " s\n";
-						
-						tStartPostProcessing = clock();
 
-						Analyzer->finishAnalysisContechSimplified();
-						tEndPostProcessing = clock();
-						CyclesPostProcessing = ((float) tEndPostProcessing - (float) tStartPostProcessing);
-						ExecutionTimePostProcessing = CyclesPostProcessing / CLOCKS_PER_SEC;
-						dbgs() << "Execution time Post processing " << ExecutionTimePostProcessing << " s\n";
+		// Check for conditions of execution. It is doing before visiting the instruction
+		// because lowering some instructions may cause a segmentation fault when
+		// accessing instruction properties.
 
-					} else {
-						tStartCacheWarmed = clock();
+		const InstructionDescriptor &Descriptor = *DI.Descriptor;
+		bool isTargetFunction = Descriptor.IsTargetFunction;
+		bool isDebug = Descriptor.IsDebug;
+		bool isCalledFromTarget = (FunctionCallStack > 0);
 
-						Analyzer->rep = 1;
-						Analyzer->ReuseStack.clear();
-						Analyzer->RemoveUnusedSpilledCacheLinesFromReuseTree();
-						Analyzer->resetInstructionValueMap();
-						
-					}
+		LastMemoryAccess.Kind = MemoryAccessEvent::None;
+		LoweredInstruction = false;
 
-				} else {
-					Analyzer->FunctionCallStack--;
+		if (!isDebug) {
+   	      	// DEBUG(dbgs() << "About to interpret: " << I);
+ 			DI.Handler(*this, DI, SF);
+		}
 
-				}
+		// An intrinsic replaced by its lowering has been erased. The instructions
+		// of the lowering are interpreted (and analyzed) next.
+		if (LoweredInstruction)
+		  continue;
+
+		// Loads and stores set the address seen by the analyzer, which keeps it
+		// for the instructions that do not access memory.
+		bool isMemoryAccess = (LastMemoryAccess.Kind == MemoryAccessEvent::Load ||
+		                       LastMemoryAccess.Kind == MemoryAccessEvent::Store);
+
+		if (isTargetFunction || isCalledFromTarget) {
+
+  			if (isMemoryAccess)
+  			  Address = LastMemoryAccess.Address;
+
+			// Control has already been transferred, so the current block of the
+			// frame is the successor block of the branch.
+			BasicBlock *NextBB = nullptr;
+			if (I.getOpcode() == Instruction::Switch || I.getOpcode() == Instruction::Br ||
+			    I.getOpcode() == Instruction::IndirectBr)
+			  NextBB = ECStack.back().CurBB;
+
+			// Events after the last one needed by the analyzers are not
+			// recorded, as the analyzers on worker threads report their
+			// completion late.
+			if (TraceWriter && TargetReturns < RequiredTargetReturns) {
+			  uint32_t Id = getStaticInstructionId(StaticInstructionIds, &I);
+			  if (NextBB != nullptr)
+			    TraceWriter->write(Id, I.getOpcode(), TRACE_BRANCH_EDGE,
+			                       getStaticInstructionId(StaticInstructionIds,
+			                                              &NextBB->front()));
+			  else if (isMemoryAccess)
+			    TraceWriter->write(Id, I.getOpcode(), TRACE_MEMORY_ACCESS, Address);
+			  else
+			    TraceWriter->write(Id, I.getOpcode(), 0, 0);
 			}
 
+			AnalysisEvent Event = {&I, &Descriptor, Address, NextBB};
+			bool Finished = true;
+			for (std::unique_ptr<AnalysisWorker> &W : Workers)
+			  Finished &= W->analyze(Event);
+			if (Finished && TraceWriter) {
+			  TraceWriter->close();
+			  TraceWriter.reset();
+			  TraceCaptured = true;
+			}
 
+			if (!isDebug) {
+			  enterFunctionCall(I, FunctionCallStack);
+			  if (exitFunctionCall(I, isTargetFunction, FunctionCallStack))
+			    TargetReturns++;
+			}
 		}
 
 
   }
+
+	// Wait for the analyzers running on worker threads, and complete the
+	// trace once all of them have reported the end of their analysis.
+	if (TargetReturns >= RequiredTargetReturns) {
+	  bool Finished = true;
+	  for (std::unique_ptr<AnalysisWorker> &W : Workers) {
+	    W->finish();
+	    Finished &= W->isCompleted();
+	  }
+	  if (Finished && TraceWriter) {
+	    TraceWriter->close();
+	    TraceWriter.reset();
+	    TraceCaptured = true;
+	  }
+	  Workers.clear();
+	}
 }
@@ -56,6 +56,8 @@ Interpreter::Interpreter(std::unique_ptr<Module> M)
     : ExecutionEngine(std::move(M)) {
 
   memset(&ExitValue.Untyped, 0, sizeof(ExitValue.Untyped));
+  LoweredInstruction = false;
+  IntrinsicsLowered = false;
   // Initialize the "backend"
   initializeExecutionEngine();
   initializeExternalFunctions();
@@ -68,6 +70,20 @@ Interpreter::~Interpreter() {
   delete IL;
 }
 
+// The analyzers share the descriptors of the instructions across threads, so
+// the instructions of the lowering of the intrinsics are created before any
+// function is decoded, instead of when the intrinsics are first executed.
+// Intrinsics that IL cannot lower are kept and handled by visitCallSite.
+void Interpreter::lowerIntrinsics() {
+  if (IntrinsicsLowered)
+    return;
+  IntrinsicsLowered = true;
+  for (std::unique_ptr<Module> &M : Modules)
+    for (Function &F : *M)
+      if (!F.isDeclaration())
+        IL->LowerIntrinsicCalls(F);
+}
+
 void Interpreter::runAtExitHandlers () {
   while (!AtExitHandlers.empty()) {
     callFunction(AtExitHandlers.back(), None);
@@ -93,6 +109,8 @@ GenericValue Interpreter::runFunction(Function *F,
   ArrayRef<GenericValue> ActualArgs =
       ArgValues.slice(0, std::min(ArgValues.size(), ArgCount));
 
+  lowerIntrinsics();
+
   // Set up the function call.
   callFunction(F, ActualArgs);
 
@@ -14,6 +14,7 @@
 #ifndef LLVM_LIB_EXECUTIONENGINE_INTERPRETER_INTERPRETER_H
 #define LLVM_LIB_EXECUTIONENGINE_INTERPRETER_INTERPRETER_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/IR/CallSite.h"
@@ -23,6 +24,11 @@
 #include "llvm/Support/DataTypes.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/raw_ostream.h"
+#include <climits>
+
+// Declared in llvm/Support/DynamicAnalysis.h, outside of the llvm namespace.
+struct InstructionDescriptor;
+
 namespace llvm {
 
 class IntrinsicLowering;
@@ -55,20 +61,120 @@ public:
 
 typedef std::vector<GenericValue> ValuePlaneTy;
 
+// MemoryAccessEvent - Memory accessed by the last interpreted instruction,
+// reported to the dynamic analysis.
+//
+struct MemoryAccessEvent {
+  enum AccessKind { None, Load, Store, Copy, Set };
+  AccessKind Kind;
+  uint64_t Address;       // First byte written (read, for a Load)
+  uint64_t SourceAddress; // First byte read by a Copy
+  uint64_t Size;          // Number of bytes accessed
+  unsigned NElements;     // Number of elements of a vector access
+
+  MemoryAccessEvent()
+      : Kind(None), Address(0), SourceAddress(0), Size(0), NElements(0) {}
+};
+
+class Interpreter;
+struct ExecutionContext;
+struct DecodedInstruction;
+
+// InstructionHandler - Implementation of a decoded instruction: the visit
+// method of its opcode, resolved when the function is decoded, or a
+// specialized implementation for the control flow instructions.
+typedef void (*InstructionHandler)(Interpreter &Interp,
+                                   const DecodedInstruction &DI,
+                                   ExecutionContext &SF);
+
+// Operands of decoded instructions are encoded as in DecodedFunction::Index.
+struct DecodedInstruction {
+  Instruction *I;
+  const InstructionDescriptor *Descriptor; // Static properties of I
+  InstructionHandler Handler;
+  int Condition;         // Condition of a conditional branch or switch
+  unsigned FirstEdge;    // Outgoing CFG edges of a branch or switch
+  unsigned NEdges;
+  unsigned FirstOperand; // Slots of the operands in OperandSlots
+  int Result;            // Slot of the value produced, NoSlot if void
+};
+
+// PHIMove - Incoming value of a PHI node, copied when a CFG edge is taken.
+struct PHIMove {
+  unsigned Dest;
+  int Source;
+};
+
+// DecodedEdge - CFG edge out of a branch or switch. The edges of a switch are
+// the default destination followed by the cases.
+struct DecodedEdge {
+  BasicBlock *Dest;
+  unsigned Target;              // First non-PHI instruction of Dest in Code
+  unsigned FirstMove, NMoves;   // PHI nodes of Dest
+  const ConstantInt *CaseValue; // Value of a switch case, null otherwise
+};
+
+// DecodedFunction - Form of a function executed by the interpreter, computed
+// the first time the function is called.
+//
+// Arguments and instructions that produce a value have a slot in the Values
+// of each frame of the function. Constant operands are evaluated once, on
+// first use, and kept in Constants. Code holds the instructions other than
+// PHI nodes, block after block, with their handler; PHI nodes are executed as
+// the moves of the edge taken by the branch that enters their block.
+//
+struct DecodedFunction {
+  Function &F;
+
+  // Non-negative: slot in the frame. Negative: -1 - index in Constants.
+  DenseMap<const Value *, int> Index;
+  // Index of the operands of the instructions in Code, or NoSlot for the
+  // operands that are not values of the frame or constants (e.g., blocks).
+  static const int NoSlot = INT_MIN;
+  std::vector<int> OperandSlots;
+  unsigned NSlots;
+  std::vector<Constant *> ConstantOperands;
+  std::vector<GenericValue> Constants;
+  std::vector<bool> Materialized;
+
+  std::vector<DecodedInstruction> Code;
+  std::vector<DecodedEdge> Edges;
+  std::vector<PHIMove> Moves;
+  DenseMap<const BasicBlock *, unsigned> BlockStart;
+  DenseMap<const Instruction *, unsigned> Position;
+
+  explicit DecodedFunction(Function &F) : F(F), NSlots(0) {}
+
+  // Number the values of F that do not have a slot or constant yet.
+  void numberValues();
+
+  // Values created after the numbering (e.g., by the lowering of intrinsics)
+  // get a new slot.
+  unsigned getOrAddSlot(const Value *V) {
+    std::pair<DenseMap<const Value *, int>::iterator, bool> It =
+        Index.insert(std::make_pair(V, (int)NSlots));
+    if (It.second)
+      NSlots++;
+    return It.first->second;
+  }
+};
+
 // ExecutionContext struct - This struct represents one stack frame currently
 // executing.
 //
 struct ExecutionContext {
   Function             *CurFunction;// The currently executing function
   BasicBlock           *CurBB;      // The currently executing BB
-  BasicBlock::iterator  CurInst;    // The next instruction to execute
+  unsigned              PC;         // The next instruction to execute in Code
   CallSite             Caller;     // Holds the call that called subframes.
                                    // NULL if main func or debugger invoked fn
-  std::map<Value *, GenericValue> Values; // LLVM values used in this invocation
+  DecodedFunction      *Decoded;   // Decoded form of CurFunction
+  std::vector<GenericValue> Values; // LLVM values used in this invocation
   std::vector<GenericValue>  VarArgs; // Values passed through an ellipsis
   AllocaHolder Allocas;            // Track memory allocated by alloca
 
-  ExecutionContext() : CurFunction(nullptr), CurBB(nullptr), CurInst(nullptr) {}
+  ExecutionContext()
+      : CurFunction(nullptr), CurBB(nullptr), PC(0), Decoded(nullptr) {}
 };
 
 // Interpreter - This class represents the entirety of the interpreter.
@@ -85,6 +191,22 @@ class Interpreter : public ExecutionEngine, public InstVisitor<Interpreter> {
   // registered with the atexit() library function.
   std::vector<Function*> AtExitHandlers;
 
+  // Decoded form of the functions called so far.
+  DenseMap<Function *, std::unique_ptr<DecodedFunction> > DecodedFunctions;
+
+  // Memory accessed by the instruction being interpreted, and whether the
+  // instruction was an intrinsic replaced by its lowering.
+  MemoryAccessEvent LastMemoryAccess;
+  bool LoweredInstruction;
+
+  // Whether the intrinsics of the modules have been lowered before running
+  // them, see lowerIntrinsics.
+  bool IntrinsicsLowered;
+  void lowerIntrinsics();
+
+  void recordMemoryAccess(MemoryAccessEvent::AccessKind Kind, void *Ptr,
+                          Type *Ty);
+
 public:
   explicit Interpreter(std::unique_ptr<Module> M);
   ~Interpreter() override;
@@ -130,9 +252,7 @@ public:
   void visitFCmpInst(FCmpInst &I);
   void visitAllocaInst(AllocaInst &I);
   void visitLoadInst(LoadInst &I);
-  GenericValue * getValueLoadInst(LoadInst * I);
   void visitStoreInst(StoreInst &I);
-    GenericValue * getValueStoreInst(StoreInst * I);
   void visitGetElementPtrInst(GetElementPtrInst &I);
   void visitPHINode(PHINode &PN) { 
     llvm_unreachable("PHI nodes already handled!"); 
@@ -187,8 +307,7 @@ public:
   }
 
 private:  // Helper functions
-  GenericValue executeGEPOperation(Value *Ptr, gep_type_iterator I,
-                                   gep_type_iterator E, ExecutionContext &SF);
+  GenericValue executeGEPOperation(User *GEP, ExecutionContext &SF);
 
   // SwitchToNewBasicBlock - Start execution in a new basic block and run any
   // PHI nodes in the top of the block.  This is used for intraprocedural
@@ -196,36 +315,42 @@ private:  // Helper functions
   //
   void SwitchToNewBasicBlock(BasicBlock *Dest, ExecutionContext &SF);
 
+  // Decode DF.F into DF.Code. Called again after the lowering of an
+  // intrinsic of DF.F, with the instruction where the current frame resumes.
+  void decodeFunction(DecodedFunction &DF);
+  void redecodeFunction(DecodedFunction &DF, Instruction *Resume);
+
+  GenericValue getSlotValue(int Slot, ExecutionContext &SF);
+  void takeEdge(const DecodedEdge &Edge, ExecutionContext &SF);
+
+  static void executeBranch(Interpreter &Interp, const DecodedInstruction &DI,
+                            ExecutionContext &SF);
+  static void executeCondBranch(Interpreter &Interp,
+                                const DecodedInstruction &DI,
+                                ExecutionContext &SF);
+  static void executeSwitch(Interpreter &Interp, const DecodedInstruction &DI,
+                            ExecutionContext &SF);
+
   void *getPointerToFunction(Function *F) override { return (void*)F; }
 
   void initializeExecutionEngine() { }
   void initializeExternalFunctions();
   GenericValue getConstantExprValue(ConstantExpr *CE, ExecutionContext &SF);
   GenericValue getOperandValue(Value *V, ExecutionContext &SF);
-  GenericValue executeTruncInst(Value *SrcVal, Type *DstTy,
-                                ExecutionContext &SF);
-  GenericValue executeSExtInst(Value *SrcVal, Type *DstTy,
+  GenericValue getOperandValue(Instruction &I, unsigned i,
                                ExecutionContext &SF);
-  GenericValue executeZExtInst(Value *SrcVal, Type *DstTy,
-                               ExecutionContext &SF);
-  GenericValue executeFPTruncInst(Value *SrcVal, Type *DstTy,
-                                  ExecutionContext &SF);
-  GenericValue executeFPExtInst(Value *SrcVal, Type *DstTy,
-                                ExecutionContext &SF);
-  GenericValue executeFPToUIInst(Value *SrcVal, Type *DstTy,
-                                 ExecutionContext &SF);
-  GenericValue executeFPToSIInst(Value *SrcVal, Type *DstTy,
-                                 ExecutionContext &SF);
-  GenericValue executeUIToFPInst(Value *SrcVal, Type *DstTy,
-                                 ExecutionContext &SF);
-  GenericValue executeSIToFPInst(Value *SrcVal, Type *DstTy,
-                                 ExecutionContext &SF);
-  GenericValue executePtrToIntInst(Value *SrcVal, Type *DstTy,
-                                   ExecutionContext &SF);
-  GenericValue executeIntToPtrInst(Value *SrcVal, Type *DstTy,
-                                   ExecutionContext &SF);
-  GenericValue executeBitCastInst(Value *SrcVal, Type *DstTy,
-                                  ExecutionContext &SF);
+  GenericValue executeTruncInst(GenericValue Src, Type *SrcTy, Type *DstTy);
+  GenericValue executeSExtInst(GenericValue Src, Type *SrcTy, Type *DstTy);
+  GenericValue executeZExtInst(GenericValue Src, Type *SrcTy, Type *DstTy);
+  GenericValue executeFPTruncInst(GenericValue Src, Type *SrcTy, Type *DstTy);
+  GenericValue executeFPExtInst(GenericValue Src, Type *SrcTy, Type *DstTy);
+  GenericValue executeFPToUIInst(GenericValue Src, Type *SrcTy, Type *DstTy);
+  GenericValue executeFPToSIInst(GenericValue Src, Type *SrcTy, Type *DstTy);
+  GenericValue executeUIToFPInst(GenericValue Src, Type *SrcTy, Type *DstTy);
+  GenericValue executeSIToFPInst(GenericValue Src, Type *SrcTy, Type *DstTy);
+  GenericValue executePtrToIntInst(GenericValue Src, Type *SrcTy, Type *DstTy);
+  GenericValue executeIntToPtrInst(GenericValue Src, Type *SrcTy, Type *DstTy);
+  GenericValue executeBitCastInst(GenericValue Src, Type *SrcTy, Type *DstTy);
   GenericValue executeCastOperation(Instruction::CastOps opcode, Value *SrcVal, 
                                     Type *Ty, ExecutionContext &SF);
   void popStackAndReturnValueToCaller(Type *RetTy, GenericValue Result);
@@ -16,6 +16,9 @@
 #include "llvm/Support/CFG.h"
 #endif
 
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/ThreadPool.h"
+
 //===----------------------------------------------------------------------===//
 //                        Constructor of the analyzer
 //===----------------------------------------------------------------------===//
@@ -47,6 +50,7 @@ DynamicAnalysis::DynamicAnalysis(string TargetFunction,
                                  bool ConstraintPortsx86,
                                  bool ConstraintPortsARM,
                                  bool ConstraintAGUs,
+                                 unsigned DispatchPorts,
                                  int rep,
                                  bool InOrderExecution,
                                  bool ReportOnlyPerformance,
@@ -57,6 +61,7 @@ DynamicAnalysis::DynamicAnalysis(string TargetFunction,
                                  bool FloatPrecision,
                                  bool VectorCode,
                                  unsigned VectorWidth)
+    : InstructionDescriptors(TargetFunction)
 {
   // First, initialize local variable that define the number of execution units
   // and nodes in the high-level microarchitecture model.
@@ -135,6 +140,8 @@ DynamicAnalysis::DynamicAnalysis(string TargetFunction,
   
   // Initialize local variables with command-line arguments
   this->TargetFunction = TargetFunction;
+  SharedInstructionDescriptors = NULL;
+  SharedThreadPool = NULL;
   if (Microarchitecture.compare("") == 0 && (ExecutionUnitsThroughput.empty() ||
                                              ExecutionUnitsLatency.empty() ||
                                              ExecutionUnitsParallelIssue.empty()))
@@ -284,10 +291,99 @@ DynamicAnalysis::DynamicAnalysis(string TargetFunction,
     
   }else{
     // ================================================================//
-    //				Haswell uarch, not implemented
+    //				Haswell uarch
     // ================================================================//
     if(Microarchitecture.compare("HW") == 0){
-      report_fatal_error("Microarchitecture Haswell not implemented");
+      // Haswell also has port 6 (integer and branch operations) and port 7
+      // (store addresses). No node is mapped to them: there are no integer or
+      // branch nodes, and store addresses are modeled by the AGUs. They are
+      // only declared with -dispatch-ports=8.
+      if(FloatPrecision == 0)
+        this->MemoryWordSize = 4; // Memory word size in bytes
+      this->CacheLineSize = 64/ this->MemoryWordSize ; // In number of memory words
+      this->RegisterFileSize = 16;
+      this->L1CacheSize = 32768 / 64;
+      this->L2CacheSize = 262144 / 64;
+      this->LLCCacheSize = 20971520 / 64;
+      this->AddressGenerationUnits = 3;
+      this->ReservationStationSize = 60;
+      this->InstructionFetchBandwidth = 4;
+      this->ReorderBufferSize = 192;
+      this->LoadBufferSize = 72;
+      this->StoreBufferSize = 42;
+      this->LineFillBufferSize = 10;
+      this->WarmCache = WarmCache;
+      this->x86MemoryModel = true;
+      this->ARMMemoryModel = false;
+      this->SpatialPrefetcher = false;
+      this->ConstraintPorts = true;
+      this->ConstraintPortsx86 = true;
+      this->ConstraintPortsARM = false;
+      this->ConstraintAGUs = true;
+      this->InOrderExecution = false;
+      
+      // Same order as for Sandy Bridge (see above)
+      if(VectorCode){
+        ShareThroughputAmongPorts[L1_LOAD_CHANNEL] = true;
+        this->ExecutionUnitsLatency = {3, 3,/* FP32_ADDER, FP64_ADDER, */
+          5, 5,/* FP32_MULTIPLIER, FP64_MULTIPLIER,*/
+          5, 5, /* FP32_FMADDER, FP64_FMADDER, */
+          35, 35, /* FP32_DIVIDER, FP64_DIVIDER,*/
+          1, 1, /* FP32_SHUFFLE_UNIT,FP64_SHUFFLE_UNIT, */
+          1, 1, /* FP32_BLEND_UNIT, FP64_BLEND_UNIT,*/
+          1, 1, /* FP32_BOOL_UNIT, FP64_BOOL_UNIT,*/
+          0, /* REGISTER_CHANNEL*/
+          4, 4, /* L1_LOAD_CHANNEL, L1_STORE_CHANNEL,*/
+          12, 34, 100}; /* L2_CHANNEL, L3_CHANNEL, MEM_CHANNEL*/
+        this->ExecutionUnitsThroughput= {4, 4,
+          4, 4,
+          4, 4,
+          0.1428, 0.1428,
+          4, 4,
+          4, 4,
+          4, 4,
+          -1,
+          32, 32,
+          64, 32, 8};
+      }else{
+        this->ExecutionUnitsLatency= {3, 3, /* FP32_ADDER, FP64_ADDER, */
+          5, 5, /* FP32_MULTIPLIER, FP64_MULTIPLIER,*/
+          5, 5, /* FP32_FMADDER, FP64_FMADDER, */
+          20, 20, /* FP32_DIVIDER, FP64_DIVIDER,*/
+          1, 1, /* FP32_SHUFFLE_UNIT,FP64_SHUFFLE_UNIT,*/
+          1, 1, /* FP32_BLEND_UNIT, FP64_BLEND_UNIT,*/
+          1, 1, /* FP32_BOOL_UNIT, FP64_BOOL_UNIT,*/
+          0, /* REGISTER_CHANNEL*/
+          4, 4,  /* L1_LOAD_CHANNEL, L1_STORE_CHANNEL,*/
+          12, 34, 100}; /* L2_CHANNEL, L3_CHANNEL, MEM_CHANNEL*/
+        this->ExecutionUnitsThroughput= {1, 1,
+          1, 1,
+          1, 1,
+          0.0714, 0.0714,
+          4, 4,
+          4, 4,
+          4, 4,
+          -1,
+          8, 8,
+          64, 32,8};
+      }
+      this->ExecutionUnitsParallelIssue = {1, 1,
+        2, 2,
+        2, 2,
+        1, 1,
+        1, 1,
+        3, 3,
+        3, 3,
+        -1,
+        2, 1,
+        1, 1, 1};
+      
+      AccessGranularities[REGISTER_LOAD_CHANNEL] = 8;
+      AccessGranularities[L1_LOAD_CHANNEL] = 8;
+      AccessGranularities[L1_STORE_CHANNEL] = 8;
+      AccessGranularities[L2_LOAD_CHANNEL] = 64;
+      AccessGranularities[L3_LOAD_CHANNEL] = 64;
+      AccessGranularities[MEM_LOAD_CHANNEL] = 64;
     }else{
       // ================================================================//
       //					ARM uach
@@ -527,7 +623,69 @@ DynamicAnalysis::DynamicAnalysis(string TargetFunction,
   for (unsigned i = 0; i < NArithmeticNodes + NMovNodes + NMemNodes; i++)
     DispatchPort.push_back(emptyVector);
   
-  if (Microarchitecture.compare("SB") == 0 || ConstraintPortsx86 == true) {
+  if (Microarchitecture.compare("HW") == 0) {
+    /*
+     Port mapping in Haswell
+     Port 0 -> FP_MUL, FP_FMA, FP_DIV, FP_BLEND, FP_BOOL
+     Port 1 -> FP_ADD, FP_MUL, FP_FMA, FP_BLEND, FP_BOOL
+     Port 2 -> LOAD (L1, L2, L3 and MEM)
+     Port 3 -> LOAD (L1, L2, L3 and MEM)
+     Port 4 -> STORE_CHANNEL (L1, L2, L3 and MEM)
+     Port 5 -> FP_SHUFFLE, FP_BLEND, FP_BOOL
+     Ports 6 and 7 have no nodes (see above)
+     */
+    
+    emptyVector.push_back(PORT_1);
+    DispatchPort[FP32_ADD_NODE] = emptyVector;
+    DispatchPort[FP64_ADD_NODE] = emptyVector;
+    
+    emptyVector.clear();
+    emptyVector.push_back(PORT_0);
+    emptyVector.push_back(PORT_1);
+    DispatchPort[FP32_MUL_NODE] = emptyVector;
+    DispatchPort[FP64_MUL_NODE] = emptyVector;
+    DispatchPort[FP32_FMA_NODE] = emptyVector;
+    DispatchPort[FP64_FMA_NODE] = emptyVector;
+    
+    emptyVector.clear();
+    emptyVector.push_back(PORT_0);
+    DispatchPort[FP32_DIV_NODE] = emptyVector;
+    DispatchPort[FP64_DIV_NODE] = emptyVector;
+    
+    emptyVector.clear();
+    emptyVector.push_back(PORT_5);
+    DispatchPort[FP32_SHUFFLE_NODE] = emptyVector;
+    DispatchPort[FP64_SHUFFLE_NODE] = emptyVector;
+    
+    emptyVector.clear();
+    emptyVector.push_back(PORT_0);
+    emptyVector.push_back(PORT_1);
+    emptyVector.push_back(PORT_5);
+    DispatchPort[FP32_BOOL_NODE] = emptyVector;
+    DispatchPort[FP64_BOOL_NODE] = emptyVector;
+    DispatchPort[FP32_BLEND_NODE] = emptyVector;
+    DispatchPort[FP64_BLEND_NODE] = emptyVector;
+    
+    // Registers don't have any associated dispatch port
+    emptyVector.clear();
+    DispatchPort[REGISTER_LOAD_NODE] = emptyVector;
+    DispatchPort[REGISTER_STORE_NODE] = emptyVector;
+    
+    emptyVector.clear();
+    emptyVector.push_back(PORT_4);
+    DispatchPort[L1_STORE_NODE] = emptyVector;
+    DispatchPort[L2_STORE_NODE] = emptyVector;
+    DispatchPort[L3_STORE_NODE] = emptyVector;
+    DispatchPort[MEM_STORE_NODE] = emptyVector;
+    
+    emptyVector.clear();
+    emptyVector.push_back(PORT_2);
+    emptyVector.push_back(PORT_3);
+    DispatchPort[L1_LOAD_NODE] = emptyVector;
+    DispatchPort[L2_LOAD_NODE] = emptyVector;
+    DispatchPort[L3_LOAD_NODE] = emptyVector;
+    DispatchPort[MEM_LOAD_NODE] = emptyVector;
+  }else if (Microarchitecture.compare("SB") == 0 || ConstraintPortsx86 == true) {
     /*
      Port mapping in Sandy Bridge
      Port 0 -> FP_MUL, FP_DIV, FP_BLEND
@@ -604,7 +762,6 @@ DynamicAnalysis::DynamicAnalysis(string TargetFunction,
     
     if(ConstraintPortsx86){
       unsigned initialPortsSize = 0;
-      unsigned bitVectorResourcesSize = 0;
       for (unsigned i = 0; i < NArithmeticNodes + NMovNodes; i++){
         if (this->ExecutionUnitsParallelIssue[ExecutionUnit[i]] != INF){
           // If there are more ops/cycle than ports associated with that op.
@@ -616,10 +773,6 @@ DynamicAnalysis::DynamicAnalysis(string TargetFunction,
                  j++){
               NPorts++;
               NTotalResources++;
-              bitVectorResourcesSize =
-              FullOccupancyCyclesTree[0].tbv_map[0].BitVector.size();
-              FullOccupancyCyclesTree[0].tbv_map[0].BitVector.
-              resize(bitVectorResourcesSize+1,0);
               DispatchPort[i].push_back(PORT_0 + NPorts -1 );
               ShareThroughputAmongPorts.push_back(false);
             }
@@ -648,10 +801,6 @@ DynamicAnalysis::DynamicAnalysis(string TargetFunction,
                  j++){
               NPorts++;
               NTotalResources++;
-              bitVectorResourcesSize =
-              FullOccupancyCyclesTree[0].tbv_map[0].BitVector.size();
-              FullOccupancyCyclesTree[0].tbv_map[0].BitVector.
-              resize(bitVectorResourcesSize+1,0);
               ShareThroughputAmongPorts.push_back(false);
               if (i == L1_LOAD_NODE || i == L2_LOAD_NODE || i == L3_LOAD_NODE
                   || i == MEM_LOAD_NODE ){
@@ -715,7 +864,6 @@ DynamicAnalysis::DynamicAnalysis(string TargetFunction,
     }else{
       if (ConstraintPorts){
         // Initial number of ports
-        unsigned bitVectorResourcesSize  = 0;
         for (unsigned i = 0; i <  NArithmeticNodes + NMovNodes + NMemNodes; i++) {
           emptyVector.clear();
           if(this->ExecutionUnitsParallelIssue[ExecutionUnit[i]] != INF){
@@ -725,10 +873,6 @@ DynamicAnalysis::DynamicAnalysis(string TargetFunction,
               emptyVector.push_back(PORT_0+NPorts);
               NPorts++;
               NTotalResources++;
-              bitVectorResourcesSize =
-              FullOccupancyCyclesTree[0].tbv_map[0].BitVector.size();
-              FullOccupancyCyclesTree[0].tbv_map[0].BitVector.
-              resize(bitVectorResourcesSize+1,0);
               ShareThroughputAmongPorts.push_back(false);
             }
           }else{
@@ -750,6 +894,31 @@ DynamicAnalysis::DynamicAnalysis(string TargetFunction,
     }
   }
   
+  // Ports declared beyond the mapped ones (e.g., ports 6 and 7 of Haswell)
+  // have no node dispatched to them, but are reported with the others.
+  if (DispatchPorts != 0) {
+    if (DispatchPorts < NPorts)
+      report_fatal_error("The number of dispatch ports (" +
+                         Twine(DispatchPorts) + ") is smaller than the " +
+                         Twine(NPorts) + " ports nodes are mapped to");
+    for (; NPorts < DispatchPorts; NPorts++) {
+      NTotalResources++;
+      ShareThroughputAmongPorts.push_back(false);
+    }
+  }
+  
+  // Dispatch ports are kept in 64-bit masks, both for nodes and for the
+  // instructions issued in a cycle.
+  if (NPorts > 64)
+    report_fatal_error("At most 64 dispatch ports are supported");
+  
+  for (unsigned i = 0; i < NArithmeticNodes + NMovNodes + NMemNodes; i++) {
+    uint64_t Ports = 0;
+    for (unsigned j = 0; j < DispatchPort[i].size(); j++)
+      Ports |= (uint64_t)1 << (DispatchPort[i][j] - PORT_0);
+    DispatchPortMask.push_back(Ports);
+  }
+  
   // Dispatch ports are associated with nodes
   for (unsigned i = 0; i < NArithmeticNodes + NMovNodes + NMemNodes; i++) {
     if (this->ConstraintPorts &&
@@ -1053,9 +1222,13 @@ DynamicAnalysis::DynamicAnalysis(string TargetFunction,
   NRegisterSpillsStores = 0;
 
   GlobalAddrForArtificialMemOps = roundNextMultiple(ULONG_MAX-64, 64);
+  NextDeadPointerToMemoryInstancesCollection =
+  MinDeadPointerToMemoryInstancesBatch;
 
+#ifdef SPLAY_REUSE_TREE
   ReuseTree = NULL;
   PrefetchReuseTree = NULL;
+#endif
   PrefetchReuseTreeSize = 0;
   LastIssueCycleFinal = 0;
 
@@ -1079,10 +1252,6 @@ DynamicAnalysis::DynamicAnalysis(string TargetFunction,
   MaxLatencyResources = 0;
   
   
-#ifndef STACK_DEQUE
-  ReuseStack = *(new LinkedList<PointerToMemoryInstance>());
-#endif
-  
   // For resources with throughput and latency, i.e., resources for which we
   // insert cycles
   for (unsigned i = 0;
@@ -1111,18 +1280,22 @@ DynamicAnalysis::DynamicAnalysis(string TargetFunction,
     BuffersOccupancy.push_back(0);
 
 #ifdef EFF_TBV
-  for (int i = 0; i< MAX_RESOURCE_VALUE; i++)
+  for (unsigned i = 0; i< NTotalResources; i++)
     FullOccupancyCyclesTree.push_back(TBV_node());
 #else
   FullOccupancyCyclesTree.push_back(*(new TBV()));
 #endif
+  RetiredCycles = 0;
+  RetiredLevels.resize(NTotalResources);
+  MemoryAddressSweepFootprint = 0;
   
   for (unsigned i = 0;
        i < NExecutionUnits + NPorts + NAGUs + NLoadAGUs + NStoreAGUs + NBuffers;
        i++)
-  AvailableCyclesTree.push_back(NULL);
+  AvailableCycles.push_back(OccupancyTable());
   
-  IssuePorts = vector < unsigned >();
+  IssuePorts = 0;
+  NIssuePorts = 0;
 
   if ( NTotalResources != (NExecutionUnits + NPorts + NAGUs + NLoadAGUs +
                           NStoreAGUs + NBuffers)){
@@ -1138,9 +1311,9 @@ DynamicAnalysis::DynamicAnalysis(string TargetFunction,
   }
   
   
-  CGSFCache.resize(NTotalResources);
-  CISFCache.resize(NTotalResources);
-  CLSFCache.resize(NTotalResources);
+  CGSFSpans.resize(NTotalResources);
+  CISFSpans.resize(NTotalResources);
+  CLSFSpans.resize(NTotalResources);
 
   // ================================================================//
   //		Some initizatializations for prefetcher
@@ -1468,8 +1641,9 @@ DynamicAnalysis::getNodeName(unsigned Node)
 
 // Copy from Instruction.cpp-getOpcodeName()
 // Opcode numbers defined in /include/llvm/IR/Instruction.def
-int
-DynamicAnalysis::getInstructionType(Instruction & I)
+// FloatPrecision is set when the type implies the floating-point precision.
+static int
+getStaticInstructionType(Instruction & I, int & FloatPrecision)
 {
   IntegerType *IntegerTy;
   Type *Ty;
@@ -1641,6 +1815,22 @@ DynamicAnalysis::getInstructionType(Instruction & I)
 }
 
 
+int
+DynamicAnalysis::getInstructionType(Instruction & I)
+{
+  return getInstructionType(getInstructionDescriptor(I));
+}
+
+
+int
+DynamicAnalysis::getInstructionType(const InstructionDescriptor & Descriptor)
+{
+  if (Descriptor.FloatPrecision >= 0)
+    FloatPrecision = Descriptor.FloatPrecision;
+  return Descriptor.Type;
+}
+
+
 // TODO: Have a class for all the intrinsics, with members that are the
 // different microops, the last repetition, etc.
 // and use it. Hence, adding a new intrinsic is automatic
@@ -1686,10 +1876,11 @@ DynamicAnalysis::getLastNonMemRepetitionIntrinsic(string functionName)
 }
 
 
-void
-DynamicAnalysis::getOperandsPositionsIntrinsic(string functionName,
-                                               vector<int64_t> & positions,
-                                               unsigned valueRep)
+// Returns false if the operands positions of the intrinsic are not known.
+static bool
+lookupOperandsPositionsIntrinsic(StringRef functionName,
+                                 vector<int64_t> & positions,
+                                 unsigned valueRep)
 {
   if (functionName.find("exp") != string::npos) {
     positions.push_back(0);
@@ -1725,66 +1916,221 @@ DynamicAnalysis::getOperandsPositionsIntrinsic(string functionName,
     else
       positions.push_back(2);
   }else{
+    return false;
+  }
+  return true;
+}
+
+
+void
+DynamicAnalysis::getOperandsPositionsIntrinsic(string functionName,
+                                               vector<int64_t> & positions,
+                                               unsigned valueRep)
+{
+  if (!lookupOperandsPositionsIntrinsic(functionName, positions, valueRep))
     report_fatal_error("Operands positions information not available for \
                        intrinsic "+functionName);
-  }
 }
 
 
-int64_t
-DynamicAnalysis::getStoreOperandPositionIntrinsic(string functionName)
+void
+DynamicAnalysis::getOperandsPositionsIntrinsic(Instruction & I,
+                                               const InstructionDescriptor & Descriptor,
+                                               vector<int64_t> & positions,
+                                               unsigned valueRep)
+{
+  if (!Descriptor.HasOperandsPositions)
+    report_fatal_error("Operands positions information not available for \
+                       intrinsic "+cast<CallInst>(I).getCalledFunction()->getName());
+  const vector<int64_t> &Positions = Descriptor.OperandsPositions[valueRep > 1];
+  positions.insert(positions.end(), Positions.begin(), Positions.end());
+}
+
+
+// Returns false if the intrinsic is not a known store.
+static bool
+lookupStoreOperandPositionIntrinsic(StringRef functionName, int64_t & position)
 {
   if (functionName.find("llvm.x86.avx.maskstore.pd.256") != string::npos) {
-    return -1;
+    position = -1;
   }else if (functionName.find( "llvm.x86.avx.storeu.pd.256") != string::npos) {
-    return 1;
+    position = 1;
   }else{
+    return false;
+  }
+  return true;
+}
+
+
+int64_t
+DynamicAnalysis::getStoreOperandPositionIntrinsic(string functionName)
+{
+  int64_t position = 0;
+  if (!lookupStoreOperandPositionIntrinsic(functionName, position))
     report_fatal_error("Operands positions information not available for \
                        intrinsic/call to function "+functionName);
-  }
+  return position;
 }
 
 
-uint64_t
-DynamicAnalysis::getInstructionValueIssueCycle(Value * v)
+int64_t
+DynamicAnalysis::getStoreOperandPositionIntrinsic(Instruction & I,
+                                                  const InstructionDescriptor & Descriptor)
 {
-  uint64_t InstructionIssueCycle = 0;
-  map < Value *, uint64_t >::iterator IssueCycleMapIt;
-  
-  IssueCycleMapIt = InstructionValueIssueCycleMap.find (v);
-  if (IssueCycleMapIt != InstructionValueIssueCycleMap.end()) {
-    InstructionIssueCycle = IssueCycleMapIt->second;
-    // Reset the value of issue cyle after reading it so that
-    // when the next time this instruction is executed, it it not poluted
-    // with a previous value. This problems arises when two instances of the
-    // same instruction are represented by the same value.
-    //  InstructionValueIssueCycleMap.erase(IssueCycleMapIt);
-    IssueCycleMapIt->second = 0;
+  if (!Descriptor.HasStoreOperandPosition)
+    report_fatal_error("Operands positions information not available for \
+                       intrinsic/call to function "+
+                       cast<CallInst>(I).getCalledFunction()->getName());
+  return Descriptor.StoreOperandPosition;
+}
+
+
+//===----------------------------------------------------------------------===//
+//                  Static properties of the instructions
+//===----------------------------------------------------------------------===//
+
+void
+InstructionDescriptorTable::addFunction(Function & F)
+{
+  bool IsTargetFunction = F.getName().find(TargetFunction) != string::npos;
+  
+  for (BasicBlock &BB : F) {
+    for (Instruction &I : BB) {
+      if (lookup(I) != NULL)
+        continue;
+      
+      InstructionDescriptor Descriptor;
+      Descriptor.Number = NextNumber++;
+      
+      Descriptor.Opcode = I.getOpcode();
+      int Precision = -1;
+      Descriptor.Type = getStaticInstructionType(I, Precision);
+      Descriptor.FloatPrecision = Precision;
+      Descriptor.IsTargetFunction = IsTargetFunction;
+      Descriptor.IsDebug = (I.getOpcode() == Instruction::Call &&
+                            I.getOperand(I.getNumOperands() - 1)->getName().find(
+                                "llvm.dbg") != string::npos);
+      
+      // Vector width of the operand that determines the width of the
+      // instruction (the pointer operand for loads and stores).
+      Descriptor.NElementsVector = 0;
+      if (I.getNumOperands() > 0) {
+        int OperandPosition = (I.getOpcode() == Instruction::Store) ? 1 : 0;
+        Type *Ty = I.getOperand (OperandPosition)->getType ();
+        if (PointerType * PT = dyn_cast < PointerType > (Ty)) {
+          if (PT->getElementType ()->getTypeID () == Type::VectorTyID)
+            Descriptor.NElementsVector = PT->getElementType ()->getVectorNumElements ();
+        }
+        if (Ty->getTypeID () == Type::VectorTyID)
+          Descriptor.NElementsVector = Ty->getVectorNumElements ();
+      }
+      
+      Descriptor.HasStoreOperandPosition = false;
+      Descriptor.StoreOperandPosition = 0;
+      Descriptor.HasOperandsPositions = false;
+      if (CallInst *CI = dyn_cast<CallInst> (&I)) {
+        if (Function *f = CI->getCalledFunction()) {
+          Descriptor.HasStoreOperandPosition =
+              lookupStoreOperandPositionIntrinsic(f->getName(),
+                                                  Descriptor.StoreOperandPosition);
+          Descriptor.HasOperandsPositions =
+              lookupOperandsPositionsIntrinsic(f->getName(),
+                                               Descriptor.OperandsPositions[0], 1) &&
+              lookupOperandsPositionsIntrinsic(f->getName(),
+                                               Descriptor.OperandsPositions[1], 2);
+        }
+      }
+      
+      Index[&I] = Descriptors.size();
+      Descriptors.push_back(Descriptor);
+    }
   }
-  else
-    InstructionIssueCycle = 0;	// First usage
   
+  // The users of an instruction are in its function, so all of them are
+  // described now. Lowering intrinsics may have changed them.
+  for (BasicBlock &BB : F) {
+    for (Instruction &I : BB) {
+      InstructionDescriptor &Descriptor = Descriptors[Index[&I]];
+      Descriptor.Users.clear();
+      for (User *U : I.users())
+        Descriptor.Users.push_back(make_pair(lookup(*cast<Instruction>(U))->Number,
+                                             isa<PHINode>(U)));
+    }
+  }
+}
+
+
+void
+InstructionDescriptorTable::addModule(Module & M)
+{
+  for (Function &F : M)
+    addFunction(F);
+}
+
+
+const InstructionDescriptor &
+DynamicAnalysis::getInstructionDescriptor(Instruction & I)
+{
+  const InstructionDescriptor *Descriptor = NULL;
+  // The shared table may be read by other analyzers at the same time, and the
+  // function of I may be modified by the thread that built it, so it must
+  // already describe I.
+  if (SharedInstructionDescriptors != NULL) {
+    Descriptor = SharedInstructionDescriptors->lookup(I);
+    if (Descriptor == NULL)
+      report_fatal_error("Instruction missing from the shared descriptors");
+    return *Descriptor;
+  }
+  Descriptor = InstructionDescriptors.lookup(I);
+  if (Descriptor == NULL) {
+    InstructionDescriptors.addFunction(*I.getParent()->getParent());
+    Descriptor = InstructionDescriptors.lookup(I);
+  }
+  return *Descriptor;
+}
+
+
+uint64_t
+DynamicAnalysis::getInstructionValueIssueCycle(unsigned Number)
+{
+  if (Number >= InstructionValueIssueCycles.size())
+    return 0;	// First usage
+  uint64_t InstructionIssueCycle = InstructionValueIssueCycles[Number];
+  // Reset the value of issue cyle after reading it so that
+  // when the next time this instruction is executed, it it not poluted
+  // with a previous value. This problems arises when two instances of the
+  // same instruction are represented by the same value.
+  InstructionValueIssueCycles[Number] = 0;
   return InstructionIssueCycle;
 }
 
 
+void
+DynamicAnalysis::insertInstructionValueIssueCycle(unsigned Number,
+                                                  uint64_t InstructionIssueCycle,
+                                                  bool IsPHINode)
+{
+  if (Number >= InstructionValueIssueCycles.size())
+    InstructionValueIssueCycles.resize(max<size_t>(Number + 1,
+                                                   2 * InstructionValueIssueCycles.size()));
+  uint64_t &IssueCycle = InstructionValueIssueCycles[Number];
+  if (IsPHINode == true)
+    IssueCycle = InstructionIssueCycle;
+  else
+    IssueCycle = max(IssueCycle, InstructionIssueCycle);
+}
+
+
+// Issue cycles are only read back for instructions, so other values (e.g.,
+// arguments) are ignored.
 void
 DynamicAnalysis::insertInstructionValueIssueCycle(Value * v,
                                                   uint64_t InstructionIssueCycle,
                                                   bool IsPHINode)
 {
-  map < Value *, uint64_t >::iterator IssueCycleMapIt;
-  IssueCycleMapIt = InstructionValueIssueCycleMap.find(v);
-  
-  if (IssueCycleMapIt != InstructionValueIssueCycleMap.end()) {
-    if (IsPHINode == true)
-    IssueCycleMapIt->second = InstructionIssueCycle;
-    else{
-      IssueCycleMapIt->second = max(IssueCycleMapIt->second,
-                                    InstructionIssueCycle);
-    }
-  }else//Insert an entry for the instrucion.
-  InstructionValueIssueCycleMap[v] = InstructionIssueCycle;
+  if (Instruction *I = dyn_cast<Instruction>(v))
+    insertInstructionValueIssueCycle(getInstructionDescriptor(*I).Number,
+                                     InstructionIssueCycle, IsPHINode);
 }
 
 
@@ -2018,95 +2364,45 @@ DynamicAnalysis::getMemoryInstructionType(int ReuseDistance,
 
 CacheLineInfo DynamicAnalysis::getCacheLineInfo(uint64_t v)
 {
-  CacheLineInfo Info;
-  uint64_t CacheLineIssueCycle = 0;
-  uint64_t CacheLineLastAccess = 0;
-  map < uint64_t, CacheLineInfo >::iterator IssueCycleMapIt;
-  IssueCycleMapIt = CacheLineIssueCycleMap.find(v);
-  
-  if (IssueCycleMapIt != CacheLineIssueCycleMap.end()) {
-    CacheLineIssueCycle = IssueCycleMapIt->second.IssueCycle;
-    CacheLineLastAccess = IssueCycleMapIt->second.LastAccess;
-  }else{
-    CacheLineIssueCycle = 0;	// First usage
-    CacheLineLastAccess = 0;
-  }
-  Info.LastAccess = CacheLineLastAccess;
-  Info.IssueCycle = CacheLineIssueCycle;
-  
-  return (Info);
+  // Lines never accessed read as {0, 0}, the values of a first usage.
+  return CacheLineIssueCycleMap.lookup(v);
 }
 
 
 uint64_t
 DynamicAnalysis::getCacheLineLastAccess(uint64_t v)
 {
-  uint64_t InstructionLastAccess = 0;
-  map < uint64_t, CacheLineInfo >::iterator IssueCycleMapIt;
-  
-  IssueCycleMapIt = CacheLineIssueCycleMap.find (v);
-  if (IssueCycleMapIt != CacheLineIssueCycleMap.end())
-  InstructionLastAccess = IssueCycleMapIt->second.LastAccess;
-  
-  return InstructionLastAccess;
+  return CacheLineIssueCycleMap.lookup(v).LastAccess;
 }
 
 
 uint64_t
 DynamicAnalysis::getMemoryAddressIssueCycle(uint64_t v)
 {
-  uint64_t IssueCycle = 0;
-  map < uint64_t, uint64_t >::iterator IssueCycleMapIt;
-  IssueCycleMapIt = MemoryAddressIssueCycleMap.find(v);
-  
-  if (IssueCycleMapIt != MemoryAddressIssueCycleMap.end())
-    IssueCycle = IssueCycleMapIt->second;
-  
-  return IssueCycle;
+  return MemoryAddressIssueCycleMap.lookup(v);
 }
 
   
 void
 DynamicAnalysis::insertCacheLineInfo(uint64_t v, CacheLineInfo Info)
 {
-  map < uint64_t, CacheLineInfo >::iterator IssueCycleMapIt;
-  IssueCycleMapIt = CacheLineIssueCycleMap.find(v);
-  
-  if (IssueCycleMapIt != CacheLineIssueCycleMap.end()) {
-    IssueCycleMapIt->second.IssueCycle = max(IssueCycleMapIt->second.IssueCycle,
-                                             Info.IssueCycle);
-    IssueCycleMapIt->second.LastAccess = Info.LastAccess;
-  }
-  else {			//Insert an entry for the instrucion.
-    CacheLineIssueCycleMap[v].IssueCycle = Info.IssueCycle;
-    CacheLineIssueCycleMap[v].LastAccess = Info.LastAccess;
-  }
+  CacheLineInfo &Entry = CacheLineIssueCycleMap[v];
+  Entry.IssueCycle = max(Entry.IssueCycle, Info.IssueCycle);
+  Entry.LastAccess = Info.LastAccess;
 }
 
 
 void
 DynamicAnalysis::insertCacheLineLastAccess(uint64_t v, uint64_t LastAccess)
 {
-  map < uint64_t, CacheLineInfo >::iterator IssueCycleMapIt;
-  IssueCycleMapIt = CacheLineIssueCycleMap.find(v);
-  
-  if (IssueCycleMapIt != CacheLineIssueCycleMap.end())
-    IssueCycleMapIt->second.LastAccess = LastAccess;
-  else				//Insert an entry for the instrucion.
-    CacheLineIssueCycleMap[v].LastAccess = LastAccess;
+  CacheLineIssueCycleMap[v].LastAccess = LastAccess;
 }
 
 
 void
 DynamicAnalysis::insertMemoryAddressIssueCycle(uint64_t v, uint64_t Cycle)
 {
-  map < uint64_t, uint64_t >::iterator IssueCycleMapIt;
-  IssueCycleMapIt = MemoryAddressIssueCycleMap.find(v);
-  
-  if (IssueCycleMapIt != MemoryAddressIssueCycleMap.end())
-    IssueCycleMapIt->second = Cycle;
-  else				//Insert an entry for the instrucion.
-    MemoryAddressIssueCycleMap[v] = Cycle;
+  MemoryAddressIssueCycleMap[v] = Cycle;
 }
 
   
@@ -2133,6 +2429,32 @@ uint64_t DynamicAnalysis::getTreeChunk(uint64_t i)
 }
 #endif
 
+// Returns the ports among Ports (bit p is port PORT_0 + p) that are full in
+// Cycle. Ports have unit throughput and parallel issue, so a port is available
+// in a cycle if and only if the cycle is not full.
+uint64_t
+DynamicAnalysis::getFullPorts(uint64_t Cycle, uint64_t Ports)
+{
+  uint64_t FullPorts = 0;
+#ifdef EFF_TBV
+  for (; Ports != 0; Ports &= Ports - 1) {
+    unsigned Resource = PORT_0 + countTrailingZeros(Ports);
+    getTreeChunk(Cycle, Resource);
+    if (FullOccupancyCyclesTree[Resource].get_node(Cycle))
+      FullPorts |= Ports & -Ports;
+  }
+#else
+  TBV & Chunk = FullOccupancyCyclesTree[getTreeChunk(Cycle)];
+  if (Chunk.empty())
+    return 0;
+  for (; Ports != 0; Ports &= Ports - 1)
+    if (Chunk.get_node(Cycle, PORT_0 + countTrailingZeros(Ports)))
+      FullPorts |= Ports & -Ports;
+#endif
+  return FullPorts;
+}
+
+
 unsigned
 DynamicAnalysis::findNextAvailableIssueCyclePortAndThroughtput(unsigned InstructionIssueCycle,
                                                                unsigned ExtendedInstructionType,
@@ -2141,7 +2463,6 @@ DynamicAnalysis::findNextAvailableIssueCyclePortAndThroughtput(unsigned Instruct
   unsigned ExecutionResource = ExecutionUnit[ExtendedInstructionType];
   unsigned InstructionIssueCycleThroughputAvailable = InstructionIssueCycle;
   
-  uint64_t InstructionIssueCycleFirstTimeAvailable = 0;
   uint64_t InstructionIssueCyclePortAvailable = InstructionIssueCycle;
   uint64_t Port = 0;
   
@@ -2171,55 +2492,29 @@ DynamicAnalysis::findNextAvailableIssueCyclePortAndThroughtput(unsigned Instruct
     // Check that the port is available
     // Get the ports with which this node is assocaited
     if (ConstraintPorts) {
-      bool FirstPortAvailableFound = false;
-      if(DispatchPort[ExtendedInstructionType].size()== 0 )
+      uint64_t NodePorts = DispatchPortMask[ExtendedInstructionType];
+      if (NodePorts == 0)
         FoundInPort = true;
-      for (unsigned i = 0; i < DispatchPort[ExtendedInstructionType].size(); i++){
-        // IssuePorts contains ports that have issued instructions in
-        // "issuecyclegranularity" cycles before or after current
-        // cycle. IssuePorts is filled in ThereIsAvailableBandwidth,
-        // which is called from FindNextAvailableIssueCycle
-        bool PortAlreadyDispatch = false;
-        for (unsigned j = 0; j< IssuePorts.size();j++){
-          if (DispatchPort[ExtendedInstructionType][i] == IssuePorts[j]){
-            PortAlreadyDispatch = true;
-            break;
-          }
-        }
-        
-        if (IssuePorts.size() == 0 || ( PortAlreadyDispatch== false)) {
-          // Checking availability in port
+      // IssuePorts contains ports that have issued instructions in
+      // "issuecyclegranularity" cycles before or after current
+      // cycle. IssuePorts is filled in ThereIsAvailableBandwidth,
+      // which is called from FindNextAvailableIssueCycle
+      uint64_t CandidatePorts = NodePorts & ~IssuePorts;
+      uint64_t FreePorts = CandidatePorts &
+        ~getFullPorts(InstructionIssueCycleThroughputAvailable, CandidatePorts);
+      if (FreePorts != 0) {
+        // The lowest free port, as ports are tried in increasing order.
+        FoundInPort = true;
+        Port = countTrailingZeros(FreePorts);
+        InstructionIssueCyclePortAvailable = InstructionIssueCycleThroughputAvailable;
+      }else if (CandidatePorts != 0) {
+        // Move to the first cycle in which one of the ports is available
+        InstructionIssueCyclePortAvailable = UINT64_MAX;
+        for (uint64_t Ports = CandidatePorts; Ports != 0; Ports &= Ports - 1)
           InstructionIssueCyclePortAvailable =
-          findNextAvailableIssueCycle(InstructionIssueCycleThroughputAvailable,
-                                      DispatchPort[ExtendedInstructionType][i]);
- 
-          if (InstructionIssueCyclePortAvailable !=
-              InstructionIssueCycleThroughputAvailable) {
-            
-            if(FirstPortAvailableFound == false){ // First time
-              FirstPortAvailableFound = true;
-              InstructionIssueCycleFirstTimeAvailable = InstructionIssueCyclePortAvailable;
-            }else {
-              InstructionIssueCyclePortAvailable =
-              min (InstructionIssueCyclePortAvailable,
-                   InstructionIssueCycleFirstTimeAvailable);
-              if (InstructionIssueCyclePortAvailable ==
-                  InstructionIssueCycleFirstTimeAvailable) {
-                Port = i;
-                if (InstructionIssueCyclePortAvailable ==
-                    InstructionIssueCycleThroughputAvailable) {
-                  FoundInPort = true;
-                  break;
-                }
-              }
-            }
-          }else {
-            // If Node is NULL, it is available for sure.
-            FoundInPort = true;
-            Port = i;
-            break;
-          }
-        }
+          min (InstructionIssueCyclePortAvailable,
+               (uint64_t)findNextAvailableIssueCycle(InstructionIssueCycleThroughputAvailable,
+                                                     PORT_0 + countTrailingZeros(Ports)));
       }
     } // End of if(ConstraintPorts)
   }// End of while
@@ -2227,7 +2522,7 @@ DynamicAnalysis::findNextAvailableIssueCyclePortAndThroughtput(unsigned Instruct
   //Insert issue cycle in Port and in resource
   if(ConstraintPorts && DispatchPort[ExtendedInstructionType].size() != 0)
     insertNextAvailableIssueCycle(InstructionIssueCyclePortAvailable,
-                                  DispatchPort[ExtendedInstructionType][Port]);
+                                  PORT_0 + Port);
   
   // Insert in resource
   if (DispatchPort[ExtendedInstructionType].size() != 0)
@@ -2236,7 +2531,7 @@ DynamicAnalysis::findNextAvailableIssueCyclePortAndThroughtput(unsigned Instruct
                                   getNElementsAccess(ExecutionResource,
                                                      AccessWidths[ExecutionResource],
                                                      NElementsVector),
-                                DispatchPort[ExtendedInstructionType][Port]);
+                                PORT_0 + Port);
   else
     insertNextAvailableIssueCycle(InstructionIssueCyclePortAvailable,
                                   ExecutionResource,
@@ -2463,10 +2758,11 @@ DynamicAnalysis::thereIsAvailableBandwidth(unsigned NextAvailableCycle,
   unsigned AccessWidth;
   unsigned IssueCycleGranularity = 0;
   
-  Tree < uint64_t > *Node;
+  OccupancyEntry *Entry;
 
   // Reset IssuePorts
-  IssuePorts = vector < unsigned >();
+  IssuePorts = 0;
+  NIssuePorts = 0;
   
   if (TargetLevel == true && FoundInFullOccupancyCyclesTree == false) {
     AccessWidth = AccessWidths[ExecutionResource];
@@ -2479,35 +2775,25 @@ DynamicAnalysis::thereIsAvailableBandwidth(unsigned NextAvailableCycle,
     
     //There is enough bandwidth if:
     // 1. The comp/load/store width fits within the level, or the level is empty.
-    if (AvailableCyclesTree[ExecutionResource] != NULL) {
-      Node = AvailableCyclesTree[ExecutionResource];
-      if (Node != NULL && Node->key >= NextAvailableCycle) {
-        AvailableCyclesTree[ExecutionResource] =
-        splay((uint64_t)NextAvailableCycle, AvailableCyclesTree[ExecutionResource]);
-        Node = AvailableCyclesTree[ExecutionResource];
-        if (Node->key == NextAvailableCycle){
-          // Get if the level would potentially (the last argument set to true)
-          // get full after inserting the current op.
-          // (not get full, but actually that instruction width does not fit or
-          // there is not wnough issue bandwidth)
-          EnoughBandwidth = !getLevelFull(ExecutionResource,
-                                          AccessWidth, NElementsVector,
-                                          Node->issueOccupancy,
-                                          Node->widthOccupancy, true);
-        }
-      }
-      // Else, if Node->key < NextAvailableCycle, that means that the last
-      // available  cycle is smaller than the potential cycle, so it is available
-      // for sure.
+    Entry = AvailableCycles[ExecutionResource].find(NextAvailableCycle);
+    if (Entry != NULL) {
+      // Get if the level would potentially (the last argument set to true)
+      // get full after inserting the current op.
+      // (not get full, but actually that instruction width does not fit or
+      // there is not wnough issue bandwidth)
+      EnoughBandwidth = !getLevelFull(ExecutionResource,
+                                      AccessWidth, NElementsVector,
+                                      Entry->issueOccupancy,
+                                      Entry->widthOccupancy, true);
     }
-    // Else, if ExecutionUnitsThroughput[ExecutionResource] >= 1, the level is
-    // either full (which is not because otherwise this would not being executed),
-    // or is available, but still need to check previous and later cycles.
+    // Else, the level is either full (which is not because otherwise this
+    // would not being executed), or is empty, but still need to check previous
+    // and later cycles.
     
     // 2. If IssueCycleGranularity > 1, we have to make sure that there were no
     // instructions executed with the same IssueCycleGranularity in previous
     // cycles. We have to do this because we don't include latency cycles in
-    // AvailableCyclesTree.
+    // AvailableCycles.
     
     if (EnoughBandwidth == true) {
       int64_t StartingCycle = 0;
@@ -2540,19 +2826,16 @@ DynamicAnalysis::thereIsAvailableBandwidth(unsigned NextAvailableCycle,
         }
 #endif
         else {
-          AvailableCyclesTree[ExecutionResource] =
-          splay(i, AvailableCyclesTree[ExecutionResource]);
-          Node = AvailableCyclesTree[ExecutionResource];
-          if (Node != NULL && Node->key == i) {
-            if (Node->issuePorts.size() > 0) {
-              for (unsigned port = 0; port < Node->issuePorts.size(); port++) {
-                IssuePorts.push_back(Node->issuePorts[port]);
-                if (ExecutionUnitsParallelIssue[ExecutionResource] != INF &&
-                    IssuePorts.size() ==
-                    (unsigned)ExecutionUnitsParallelIssue[ExecutionResource]){
-                  EnoughBandwidth = false;
-
-                }
+          Entry = AvailableCycles[ExecutionResource].find(i);
+          if (Entry != NULL) {
+            for (uint64_t Ports = Entry->issuePorts; Ports != 0;
+                 Ports &= Ports - 1) {
+              IssuePorts |= Ports & -Ports;
+              NIssuePorts++;
+              if (ExecutionUnitsParallelIssue[ExecutionResource] != INF &&
+                  NIssuePorts ==
+                  (unsigned)ExecutionUnitsParallelIssue[ExecutionResource]){
+                EnoughBandwidth = false;
               }
             }
           }
@@ -2585,18 +2868,16 @@ DynamicAnalysis::thereIsAvailableBandwidth(unsigned NextAvailableCycle,
         }
 #endif
         else {
-          AvailableCyclesTree[ExecutionResource] =
-          splay(i, AvailableCyclesTree[ExecutionResource]);
-          Node = AvailableCyclesTree[ExecutionResource];
-          if (Node != NULL && Node->key == i) {
-            if (Node->issuePorts.size() > 0) {
-              for (unsigned port = 0; port < Node->issuePorts.size(); port++) {
-                IssuePorts.push_back(Node->issuePorts[port]);
-                if (ExecutionUnitsParallelIssue[ExecutionResource] != INF &&
-                    IssuePorts.size() ==
-                    (unsigned)ExecutionUnitsParallelIssue[ExecutionResource]){
-                  EnoughBandwidth = false;
-                }
+          Entry = AvailableCycles[ExecutionResource].find(i);
+          if (Entry != NULL) {
+            for (uint64_t Ports = Entry->issuePorts; Ports != 0;
+                 Ports &= Ports - 1) {
+              IssuePorts |= Ports & -Ports;
+              NIssuePorts++;
+              if (ExecutionUnitsParallelIssue[ExecutionResource] != INF &&
+                  NIssuePorts ==
+                  (unsigned)ExecutionUnitsParallelIssue[ExecutionResource]){
+                EnoughBandwidth = false;
               }
             }
           }
@@ -2619,55 +2900,20 @@ DynamicAnalysis::
                                                              bool & EnoughBandwidth)
 {
   unsigned NextAvailableCycle = NextCycle;
-  unsigned OriginalCycle;
-  Tree < uint64_t > *Node = AvailableCyclesTree[ExecutionResource];
-  Tree < uint64_t > *LastNodeVisited = NULL;
+  uint64_t AvailableCycle;
   
   if(ExecutionUnitsThroughput[ExecutionResource] == 0)
     report_fatal_error("Throughput value not valid for resource " +
                      getResourceName(ExecutionResource));
   
   NextAvailableCycle++;
-  OriginalCycle = NextAvailableCycle;
-  
-  // If we loop over the first while because there is not enough bandwidth.
-  // Node might be NULL because this loop has already been executed.
-  Node = AvailableCyclesTree[ExecutionResource];
-  
-  while (Node) {
-    if (Node->key > NextAvailableCycle) {
-      if (NextAvailableCycle == OriginalCycle) {	// first iteration
-        NextAvailableCycle = Node->key;
-        LastNodeVisited = Node;
-      }
-      // Search for a smaller one
-      Node = Node->left;
-    }else if (Node->key < NextAvailableCycle) {
-      if (Node->key == OriginalCycle) {
-        NextAvailableCycle = OriginalCycle;
-        LastNodeVisited = Node;
-        break;
-      }else if (Node->key > OriginalCycle) {
-        //Search for a even smaller one
-        NextAvailableCycle = Node->key;
-        LastNodeVisited = Node;
-        // Search for a smaller one
-        Node = Node->left;
-      } else {//Node->key < OriginalCycle
-        // Search for a larger one, but do not store last node visited...
-        Node = Node->right;
-      }
-    } else {			//Node->key = NextAvailableCycle
-      NextAvailableCycle = Node->key;
-      LastNodeVisited = Node;
-      break;
-    }
-  }
   
-  //LastNodeVisited contains the next available cycle. But we still need to check
-  //that it is available for lower and upper levels.
-  if (LastNodeVisited != NULL && LastNodeVisited->key >= OriginalCycle)
-    NextAvailableCycle = LastNodeVisited->key;
+  // The next available cycle is the first cycle in AvailableCycles from the
+  // next cycle on. We still need to check that it is available for lower and
+  // upper levels.
+  if (AvailableCycles[ExecutionResource].findNext(NextAvailableCycle,
+                                                  AvailableCycle))
+    NextAvailableCycle = AvailableCycle;
 
   FoundInFullOccupancyCyclesTree = false;
   EnoughBandwidth = false;
@@ -2761,30 +3007,33 @@ DynamicAnalysis::findNextAvailableIssueCycle(unsigned OriginalCycle,
         }
       }else {
         if (FoundInFullOccupancyCyclesTree == true) {
+#ifdef EFF_TBV
           while (FoundInFullOccupancyCyclesTree) {
             //Check if it is in full
-#ifdef EFF_TBV
             if(FullOccupancyCyclesTree[ExecutionResource].get_node(NextAvailableCycle)){
-#else
-              if (FullOccupancyCyclesTree[TreeChunk].get_node(NextAvailableCycle, ExecutionResource)) {
-#endif
-                // Try next cycle
-                NextAvailableCycle++;
-#ifdef EFF_TBV
-                getTreeChunk(NextAvailableCycle, ExecutionResource);
-#else
-                TreeChunk = getTreeChunk(NextAvailableCycle);
-#endif
-                FoundInFullOccupancyCyclesTree = true;
-#ifdef EFF_TBV
-              }
-#else
+              // Try next cycle
+              NextAvailableCycle++;
+              getTreeChunk(NextAvailableCycle, ExecutionResource);
+              FoundInFullOccupancyCyclesTree = true;
             }
-#endif
             else {
               FoundInFullOccupancyCyclesTree = false;
             }
           }
+#else
+          // Skip the run of full cycles a word at a time, moving to the next
+          // chunk while the current one is full up to its end.
+          uint64_t NextInChunk =
+          FullOccupancyCyclesTree[TreeChunk].find_next_unset(NextAvailableCycle,
+                                                             ExecutionResource);
+          while (NextInChunk == SplitTreeRange) {
+            TreeChunk = getTreeChunk((uint64_t)(TreeChunk + 1) * SplitTreeRange);
+            NextInChunk =
+            FullOccupancyCyclesTree[TreeChunk].find_next_unset(0, ExecutionResource);
+          }
+          NextAvailableCycle = (uint64_t)TreeChunk * SplitTreeRange + NextInChunk;
+          FoundInFullOccupancyCyclesTree = false;
+#endif
         }
       }
 #ifdef EFF_TBV
@@ -2824,7 +3073,6 @@ DynamicAnalysis::insertNextAvailableIssueCycle(uint64_t NextAvailableCycle,
                                                unsigned NElementsVector,
                                                int IssuePort, bool isPrefetch)
 {
-  Tree < uint64_t > *Node = AvailableCyclesTree[ExecutionResource];
   unsigned NodeIssueOccupancy = 0;
   unsigned NodeWidthOccupancy = 0;
   unsigned NodeOccupancyPrefetch = 0;
@@ -2862,28 +3110,27 @@ DynamicAnalysis::insertNextAvailableIssueCycle(uint64_t NextAvailableCycle,
   InstructionsLastIssueCycle[ExecutionResource] =
  max(InstructionsLastIssueCycle[ExecutionResource], NextAvailableCycle);
   
-  AvailableCyclesTree[ExecutionResource] =
-  insert_node(NextAvailableCycle, AvailableCyclesTree[ExecutionResource]);
+  OccupancyEntry &Entry =
+  AvailableCycles[ExecutionResource].insert(NextAvailableCycle);
 #ifdef SOURCE_CODE_ANALYSIS
-  AvailableCyclesTree[ExecutionResource]->
-  SourceCodeLinesOperationPair.push_back(std::make_pair (SourceCodeLine, ExecutionResource));
+  Entry.SourceCodeLinesOperationPair.push_back(std::make_pair (SourceCodeLine,
+                                                               ExecutionResource));
 #endif
   
   if (IssuePort >= PORT_0)
-    AvailableCyclesTree[ExecutionResource]->issuePorts.push_back(IssuePort);
-  Node = AvailableCyclesTree[ExecutionResource];
+    Entry.issuePorts |= (uint64_t)1 << (IssuePort - PORT_0);
 
   if (isPrefetch)
-    Node->occupancyPrefetch++;
+    Entry.occupancyPrefetch++;
   else
-    Node->issueOccupancy++;
+    Entry.issueOccupancy++;
   
-  Node->widthOccupancy += getNodeWidthOccupancy(ExecutionResource, AccessWidth,
+  Entry.widthOccupancy += getNodeWidthOccupancy(ExecutionResource, AccessWidth,
                                                 NElementsVector);
-  /* Copy these values because later on the Node is not the same anymore */
-  NodeIssueOccupancy = Node->issueOccupancy;
-  NodeWidthOccupancy = Node->widthOccupancy;
-  NodeOccupancyPrefetch = Node->occupancyPrefetch;
+  /* Copy these values because later on the Entry is not valid anymore */
+  NodeIssueOccupancy = Entry.issueOccupancy;
+  NodeWidthOccupancy = Entry.widthOccupancy;
+  NodeOccupancyPrefetch = Entry.occupancyPrefetch;
   MaxOccupancy[ExecutionResource] =
   max(MaxOccupancy[ExecutionResource], NodeIssueOccupancy + NodeOccupancyPrefetch);
 
@@ -2900,7 +3147,7 @@ DynamicAnalysis::insertNextAvailableIssueCycle(uint64_t NextAvailableCycle,
   if (LevelGotFull) {
     LevelGotFull = true;
     // Check whether next cycle is in full. because if it is, it should not be
-    // inserted into AvailableCyclesTree.
+    // inserted into AvailableCycles.
     // Next cycle is not NexAvailableCycle+1, is NextAvailableCycle + 1/Throughput
     // Here is where the distinction betweeen execution resource and instruction
     // type is important.
@@ -2908,8 +3155,7 @@ DynamicAnalysis::insertNextAvailableIssueCycle(uint64_t NextAvailableCycle,
                                                    AccessWidth,
                                                    NElementsVector);
     
-    AvailableCyclesTree[ExecutionResource] =
-    delete_node(NextAvailableCycle, AvailableCyclesTree[ExecutionResource]);
+    AvailableCycles[ExecutionResource].erase(NextAvailableCycle);
     
     // Insert node in FullOccupancy
 #ifdef EFF_TBV
@@ -2938,9 +3184,7 @@ DynamicAnalysis::insertNextAvailableIssueCycle(uint64_t NextAvailableCycle,
       if ( !FullOccupancyCyclesTree[TreeChunk].get_node((NextAvailableCycle + NextCycle),
                                                         ExecutionResource)) {
 #endif
-        AvailableCyclesTree[ExecutionResource] =
-        insert_node(NextAvailableCycle + NextCycle,
-                     AvailableCyclesTree[ExecutionResource]);
+        AvailableCycles[ExecutionResource].insert(NextAvailableCycle + NextCycle);
         // In this case, although we are inserting a node into AvailableCycles,
         // we don't insert the source code line associated to the cycle because
         // it does not mean that an instruction has actually been
@@ -2959,6 +3203,126 @@ DynamicAnalysis::insertNextAvailableIssueCycle(uint64_t NextAvailableCycle,
 }
 
 
+#ifndef EFF_TBV
+// Appends to Levels the runs of set bits of Words, where bit i stands for
+// cycle Base + i.
+static void appendLevelRuns(const vector<uint64_t> & Words, uint64_t Base,
+                            SpanIntervals & Levels)
+{
+  bool InRun = false;
+  uint64_t Begin = 0;
+  for (size_t w = 0; w < Words.size(); w++) {
+    for (unsigned Bit = 0; Bit < 64;) {
+      // Look for the next bit that ends or starts a run.
+      uint64_t Rest = (InRun ? ~Words[w] : Words[w]) >> Bit;
+      if (Rest == 0)
+        break;
+      Bit += countTrailingZeros(Rest);
+      if (InRun)
+        Levels.append(Begin, Base + w * 64 + Bit);
+      else
+        Begin = Base + w * 64 + Bit;
+      InRun = !InRun;
+    }
+  }
+  if (InRun)
+    Levels.append(Begin, Base + Words.size() * 64);
+}
+
+
+// Instructions are never issued before InstructionFetchCycle, so the
+// scheduling state of earlier cycles is only read again by the span analysis
+// at the end of the execution. Record the intervals of non-empty levels of
+// those cycles and release the chunks of FullOccupancyCyclesTree and the
+// entries of AvailableCycles that hold them.
+void DynamicAnalysis::retireCycles(uint64_t Cycle)
+{
+  uint64_t NewRetiredCycles = (Cycle / SplitTreeRange) * SplitTreeRange;
+  if (NewRetiredCycles <= RetiredCycles)
+    return;
+  
+  // Levels of one resource in one chunk, one bit per cycle.
+  vector<uint64_t> Levels(SplitTreeRange / 64);
+  for (uint64_t TreeChunk = RetiredCycles / SplitTreeRange;
+       TreeChunk < NewRetiredCycles / SplitTreeRange; TreeChunk++) {
+    uint64_t ChunkBegin = TreeChunk * SplitTreeRange;
+    TBV * Chunk = NULL;
+    if (TreeChunk < FullOccupancyCyclesTree.size() &&
+        !FullOccupancyCyclesTree[TreeChunk].empty())
+      Chunk = &FullOccupancyCyclesTree[TreeChunk];
+    for (unsigned j = 0; j < NTotalResources; j++) {
+      if (Chunk != NULL && Chunk->has_plane(j))
+        Levels = Chunk->Planes[j];
+      else
+        std::fill(Levels.begin(), Levels.end(), 0);
+      if (j < AvailableCycles.size()) {
+        uint64_t Cycle = ChunkBegin;
+        while (AvailableCycles[j].findNext(Cycle, Cycle) &&
+               Cycle < ChunkBegin + SplitTreeRange) {
+          if (j <= NExecutionUnits &&
+              AvailableCycles[j].find(Cycle)->issueOccupancy != 0)
+            Levels[(Cycle - ChunkBegin) / 64] |= (uint64_t)1 << (Cycle % 64);
+          // getLastIssueCycle reads the entry of the last issue cycle.
+          if (Cycle != InstructionsLastIssueCycle[j])
+            AvailableCycles[j].erase(Cycle);
+          Cycle++;
+        }
+      }
+      appendLevelRuns(Levels, ChunkBegin, RetiredLevels[j]);
+    }
+    if (Chunk != NULL)
+      Chunk->release();
+  }
+  
+  // Addresses last accessed before the retired cycles only ever lose against
+  // the fetch cycle when computing issue cycles, so resetting them only
+  // reclaims memory. Sweep the map when it has doubled since the last sweep,
+  // which keeps the cost of the sweeps linear in the number of accesses.
+  if (MemoryAddressIssueCycleMap.footprint() >=
+      2 * MemoryAddressSweepFootprint) {
+    MemoryAddressIssueCycleMap.resetIf(
+        [NewRetiredCycles](uint64_t Cycle) { return Cycle < NewRetiredCycles; });
+    MemoryAddressSweepFootprint = MemoryAddressIssueCycleMap.footprint();
+  }
+  
+  RetiredCycles = NewRetiredCycles;
+}
+#endif
+
+
+// Marks the cycles [From, To) as full for the stall resource
+// ResourceType. Stalls can last hundreds of cycles, so the bits are set a
+// word at a time.
+void DynamicAnalysis::insertStallCycles(unsigned ResourceType, uint64_t From,
+                                        uint64_t To)
+{
+  if (From >= To)
+    return;
+  
+#ifdef EFF_TBV
+  for (uint64_t i = From; i < To; i++) {
+    getTreeChunk(i, ResourceType);
+    FullOccupancyCyclesTree[ResourceType].insert_node(i);
+  }
+#else
+  for (uint64_t i = From; i < To;) {
+    uint64_t TreeChunk = getTreeChunk(i);
+    uint64_t ChunkEnd = min(To, (TreeChunk + 1) * SplitTreeRange);
+    FullOccupancyCyclesTree[TreeChunk].insert_range(i, ChunkEnd, ResourceType);
+#ifdef SOURCE_CODE_ANALYSIS
+    for (uint64_t j = i; j < ChunkEnd; j++)
+      FullOccupancyCyclesTree[TreeChunk].insert_source_code_line(j,
+                                                                 SourceCodeLine,
+                                                                 ResourceType);
+#endif
+    i = ChunkEnd;
+  }
+#endif
+  
+  InstructionsCountExtended[ResourceType] += To - From;
+  InstructionsLastIssueCycle[ResourceType] = To - 1;
+}
+
 void DynamicAnalysis::increaseInstructionFetchCycle(bool EmptyBuffers)
 {
 #ifndef EFF_TBV
@@ -3018,23 +3382,8 @@ void DynamicAnalysis::increaseInstructionFetchCycle(bool EmptyBuffers)
       report_fatal_error("CHECK InstructionFetchCycle == \
                          CurrentInstructionFetchCycle");
     
-    for (uint64_t i = CurrentInstructionFetchCycle+1; i < InstructionFetchCycle; i++) {
-#ifdef EFF_TBV
-      getTreeChunk(i,RS_STALL );
-      FullOccupancyCyclesTree[RS_STALL].insert_node( i);
-#else
-      TreeChunk = getTreeChunk(i);
-      FullOccupancyCyclesTree[TreeChunk].insert_node(i, RS_STALL);
-#endif
-      
-#ifdef SOURCE_CODE_ANALYSIS
-      FullOccupancyCyclesTree[TreeChunk].insert_source_code_line(i,
-                                                                 SourceCodeLine,
-                                                                 RS_STALL);
-#endif
-      InstructionsCountExtended[RS_STALL]++;
-      InstructionsLastIssueCycle[RS_STALL] = i;
-    }
+    insertStallCycles(RS_STALL, CurrentInstructionFetchCycle + 1,
+                      InstructionFetchCycle);
   }
   
   if (ReorderBufferCompletionCycles.size() == ReorderBufferSize &&
@@ -3050,25 +3399,8 @@ void DynamicAnalysis::increaseInstructionFetchCycle(bool EmptyBuffers)
       FirstNonEmptyLevel[ROB_STALL];
     }
     
-    for (uint64_t i = CurrentInstructionFetchCycle+1 ;
-         i < InstructionFetchCycle; i++) {
-      // Get the node, if any, corresponding to this issue cycle.
-#ifdef EFF_TBV
-      getTreeChunk(i,ROB_STALL);
-      FullOccupancyCyclesTree[ROB_STALL].insert_node(i);
-#else
-      TreeChunk = getTreeChunk(i);
-      FullOccupancyCyclesTree[TreeChunk].insert_node(i, ROB_STALL);
-#endif
-      
-#ifdef SOURCE_CODE_ANALYSIS
-      FullOccupancyCyclesTree[TreeChunk].insert_source_code_line (i,
-                                                                  SourceCodeLine,
-                                                                  ROB_STALL);
-#endif
-      InstructionsCountExtended[ROB_STALL]++;
-      InstructionsLastIssueCycle[ROB_STALL] = i;
-    }
+    insertStallCycles(ROB_STALL, CurrentInstructionFetchCycle + 1,
+                      InstructionFetchCycle);
   }
   
   if (OOOBufferFull == true) {
@@ -3212,6 +3544,18 @@ void DynamicAnalysis::increaseInstructionFetchCycle(bool EmptyBuffers)
       InstructionsCountExtended[SB_STALL]++;
     }
   }
+  
+  // Instructions are issued from the fetch cycle on, so move the window of the
+  // occupancy tables along with it.
+  for (unsigned j = 0; j < AvailableCycles.size(); j++)
+    AvailableCycles[j].advance(InstructionFetchCycle);
+  
+#if !defined(EFF_TBV) && !defined(SOURCE_CODE_ANALYSIS)
+  // Keep one chunk of slack behind the fetch cycle, which covers the look-back
+  // of the issue granularity in thereIsAvailableBandwidth.
+  if (InstructionFetchCycle >= RetiredCycles + 2 * SplitTreeRange)
+    retireCycles(InstructionFetchCycle - SplitTreeRange);
+#endif
 }
 
 
@@ -3325,15 +3669,29 @@ DynamicAnalysis::ReuseDistance(uint64_t Last, uint64_t Current, uint64_t address
     if (Distance >= 0)
       Distance = roundNextPowerOfTwo (Distance);
 #endif
+#ifdef SPLAY_REUSE_TREE
     // Get a pointer to the resulting tree
     if (FromPrefetchReuseTree == false) {
-      ReuseTree = insert_node(Current, ReuseTree, address);
+      ReuseTree = insert_node(Current, ReuseTree, address, &ReuseTreeNodes);
     }else {
-      PrefetchReuseTree = insert_node(Current, PrefetchReuseTree, address);
+      PrefetchReuseTree = insert_node(Current, PrefetchReuseTree, address,
+                                      &ReuseTreeNodes);
       PrefetchReuseTreeSize++;
     }
   }else
-    ReuseTree = insert_node(address, ReuseTree, address);
+    ReuseTree = insert_node(address, ReuseTree, address, &ReuseTreeNodes);
+#else
+    if (FromPrefetchReuseTree == false)
+      ReuseTree.insert(Current, address);
+    else if (PrefetchReuseTree.insert(Current, address))
+      PrefetchReuseTreeSize++;
+  }else{
+    // Keys must not decrease, so the cache lines are kept by last access
+    // instead of by address. The tree only gives the data set size then.
+    reuseTreeSearchDelete(Last, address, false);
+    ReuseTree.insert(Current, address);
+  }
+#endif
 
   return Distance;
 }
@@ -3347,55 +3705,39 @@ int
 DynamicAnalysis::reuseTreeSearchDelete(uint64_t Original, uint64_t address,
                                         bool FromPrefetchReuseTree)
 {
-  Tree < uint64_t > *Node = NULL;
-  int Distance = 0;
+#ifndef SPLAY_REUSE_TREE
+  FenwickReuseTree &Timestamps = FromPrefetchReuseTree ? PrefetchReuseTree
+                                                       : ReuseTree;
+  if (Original == 0 || Timestamps.empty())	// Did not find any node smaller
+    return -1;
+  int Distance = Timestamps.reuseDistance(Original);
+  uint64_t HostAddress;
+  if (Timestamps.lookup(Original, HostAddress) && HostAddress == address) {
+    Timestamps.erase(Original);
+    if (FromPrefetchReuseTree == true)
+      PrefetchReuseTreeSize--;
+  }
+  return Distance;
+#else
+  Tree < uint64_t > *Root = FromPrefetchReuseTree ? PrefetchReuseTree
+                                                   : ReuseTree;
+  if (Original == 0 || Root == NULL)	// Did not find any node smaller
+    return -1;
 
-  if (FromPrefetchReuseTree == false)
-    Node = ReuseTree;
-  else
-    Node = PrefetchReuseTree;
-  
-  //Once we find it, calculate the distance without deleting the node.
-  if (Original == 0 || Node == NULL) {	// Did not find any node smaller
-    Distance = -1;
-  }else {
-    while (true) {
-      // This is the mechanism used in the original algorithm to delete the host
-      // node,  decrementing the last_record attribute of the host node, and
-      // Node->size = Node->size-1;
-      if (Original < Node->key) {
-        if (Node->right != NULL)
-        Distance = Distance + Node->right->size;
-        if (Node->left == NULL)
-        break;
-        
-        Distance = Distance + 1 /*Node->last_record */ ;
-        Node = Node->left;
-      }else {
-        if (Original > Node->key) {
-          if (Node->right == NULL)
-          break;
-          Node = Node->right;
-        }else {			// Last = Node->key, i.e., Node is the host node
-          if (Node->right != NULL)
-          Distance = Distance + Node->right->size;
-          //increase by one so that we can calculate directly the hit rate
-          // for a cache size multiple of powers of two.
-          Distance = Distance + 1;
-          if (Node->address == address && FromPrefetchReuseTree == false)
-            ReuseTree = delete_node(Original, ReuseTree);
-          else {
-            if (Node->address == address && FromPrefetchReuseTree == true) {
-              PrefetchReuseTree = delete_node(Original, PrefetchReuseTree);
-              PrefetchReuseTreeSize--;
-            }
-          }
-          break;
-        }
-      }
+  // The host node is deleted only if it still holds the same line.
+  Tree < uint64_t > *Host;
+  int Distance = reuse_distance(Original, Root, &Host);
+  if (Host != NULL && Host->address == address) {
+    if (FromPrefetchReuseTree == false)
+      ReuseTree = delete_node(Original, ReuseTree, &ReuseTreeNodes);
+    else {
+      PrefetchReuseTree = delete_node(Original, PrefetchReuseTree,
+                                      &ReuseTreeNodes);
+      PrefetchReuseTreeSize--;
     }
   }
   return Distance;
+#endif
 }
 
   
@@ -3489,25 +3831,21 @@ DynamicAnalysis::printILPDistribuion(unsigned span)
 uint64_t
 DynamicAnalysis::getLastIssueCycle(unsigned ExecutionResource, bool WithPrefetch)
 {
-  Tree < uint64_t > *NodeAvailable = NULL;
+  OccupancyEntry *EntryAvailable = NULL;
   bool isPrefetchType = false;
   unsigned IssueCycleGranularity = IssueCycleGranularities[ExecutionResource];
   uint64_t LastCycle = InstructionsLastIssueCycle[ExecutionResource];
   
   if (ExecutionResource <= NExecutionUnits) {
-    AvailableCyclesTree[ExecutionResource] =
-    splay(LastCycle, AvailableCyclesTree[ExecutionResource]);
-    NodeAvailable = AvailableCyclesTree[ExecutionResource];
+    EntryAvailable = AvailableCycles[ExecutionResource].find(LastCycle);
     
     if (isPrefetchType) {
 #ifdef EFF_TBV
-      if ((NodeAvailable != NULL && NodeAvailable->key == LastCycle &&
-           NodeAvailable->occupancyPrefetch == 0) ||
+      if ((EntryAvailable != NULL && EntryAvailable->occupancyPrefetch == 0) ||
           (FullOccupancyCyclesTree[ExecutionResource].get_node_nb (LastCycle))) {
 #else
         int TreeChunk = LastCycle / SplitTreeRange;
-        if ((NodeAvailable != NULL && NodeAvailable->key == LastCycle &&
-             NodeAvailable->occupancyPrefetch == 0) ||
+        if ((EntryAvailable != NULL && EntryAvailable->occupancyPrefetch == 0) ||
             (FullOccupancyCyclesTree[TreeChunk].get_node_nb(LastCycle,
                                                             ExecutionResource))){
 #endif
@@ -3519,8 +3857,7 @@ DynamicAnalysis::getLastIssueCycle(unsigned ExecutionResource, bool WithPrefetch
       }
 #endif
     }else {
-      if (NodeAvailable != NULL && NodeAvailable->key == LastCycle &&
-          NodeAvailable->issueOccupancy == 0) {
+      if (EntryAvailable != NULL && EntryAvailable->issueOccupancy == 0) {
         LastCycle = LastCycle - IssueCycleGranularity;
       }
     }
@@ -3551,23 +3888,47 @@ DynamicAnalysis::calculateIssueSpanFinal(vector < int >&ResourcesVector,
   }
   LastCycle += MaxLatencyResources;		// to be safe
   
-  // Prepare a cache of values
-  if (NResources == 1) {
-    CISFCache[ResourcesVector[0]].resize(LastCycle, false);
-  }else {
-    dynamic_bitset <> BitMesh (LastCycle);
+  if (NResources != 1) {
+    vector<const SpanIntervals *> Sets;
     for (int j = 0; j < NResources; j++) {
+      ResourceType = ResourcesVector[j];
       // Should probably recurse and calculate this value just in case
-      if (CISFCache[ResourcesVector[j]].size() == 0) {
+      if (CISFSpans[ResourceType].empty() &&
+          InstructionsCountExtended[ResourceType] != 0) {
         vector < int >tv;
-        tv.push_back(ResourcesVector[j]);
+        tv.push_back(ResourceType);
         calculateIssueSpanFinal (tv);
       }
-      BitMesh |= CISFCache[ResourcesVector[j]];
+      Sets.push_back(&CISFSpans[ResourceType]);
     }
-    return BitMesh.count ();
+    return SpanIntervals::countUnion(Sets);
   }
   
+#if !defined(EFF_TBV) && !defined(SOURCE_CODE_ANALYSIS)
+  ResourceType = ResourcesVector[0];
+  if (InstructionsCountExtended[ResourceType] > 0 &&
+      LastIssueCycleVector[ResourceType] < RetiredCycles) {
+    AccessWidth = AccessWidths[ResourceType];
+    if (ExecutionUnitsThroughput[ResourceType] == INF)
+      TmpLatency = 1;
+    else if (onlyScalar)
+      TmpLatency = getIssueCycleGranularity(ResourceType, AccessWidth, 1);
+    else
+      TmpLatency = getIssueCycleGranularity(ResourceType, AccessWidth,
+                                            getNElementsAccess(ResourceType,
+                                                               AccessWidth,
+                                                               VectorWidth));
+    if (TmpLatency > 0) {
+      CISFSpans[ResourceType] = spanFromRetiredLevels(ResourceType, TmpLatency,
+                                                      LastCycle);
+      return CISFSpans[ResourceType].count();
+    }
+  }
+#endif
+  
+  SpanIntervals & Spans = CISFSpans[ResourcesVector[0]];
+  Spans.clear();
+  
   //Determine first non-empty level and LastCycle
   for (int j = 0; j < NResources; j++) {
     ResourceType = ResourcesVector[j];
@@ -3604,11 +3965,8 @@ DynamicAnalysis::calculateIssueSpanFinal(vector < int >&ResourcesVector,
   }
   
   unsigned DominantLevel = First;
-  if (NResources == 1 && MaxLatency > 0) {
-    //unsigned nBits = 0;
-    for (unsigned q = 0; q < MaxLatency; q++)
-      CISFCache[ResourcesVector[0]][First + q] = 1;
-  }
+  if (NResources == 1 && MaxLatency > 0)
+    Spans.cover(First, First + MaxLatency);
   
   if (EmptyLevel == false) {
     Span += MaxLatency;
@@ -3654,14 +4012,11 @@ DynamicAnalysis::calculateIssueSpanFinal(vector < int >&ResourcesVector,
         }
       }
       
-      if (NResources == 1 && MaxLatencyLevel > 0) {
-        for (unsigned q = 0; q < MaxLatencyLevel; q++) {
-          CISFCache[ResourcesVector[0]][i + q] = 1;
-        }
-      }
+      if (NResources == 1 && MaxLatencyLevel > 0)
+        Spans.cover(i, i + MaxLatencyLevel);
     }
   }
-  assert (CISFCache[ResourcesVector[0]].count () == Span);
+  assert (Spans.count () == Span);
   return Span;
 }
 
@@ -3701,6 +4056,9 @@ uint64_t DynamicAnalysis::calculateSpanFinal(int ResourceType)
 bool
 DynamicAnalysis::isEmptyLevelFinal(unsigned ExecutionResource, uint64_t Level)
 {
+  if (Level < RetiredCycles)
+    return !RetiredLevels[ExecutionResource].contains(Level);
+  
   if (ExecutionResource <= NExecutionUnits) {
     if (ACTFinal.get_node_ACT (Level, ExecutionResource))
       return false;
@@ -3715,47 +4073,64 @@ DynamicAnalysis::isEmptyLevelFinal(unsigned ExecutionResource, uint64_t Level)
 }
 
 
+#ifndef EFF_TBV
+// Span of a single resource computed from the intervals of non-empty levels
+// recorded by retireCycles. Every non-empty level i between the first and
+// the last issue cycle of the resource covers [i, i + Latency), clipped to
+// LastCycle.
+SpanIntervals
+DynamicAnalysis::spanFromRetiredLevels(unsigned ResourceType, unsigned Latency,
+                                       uint64_t LastCycle)
+{
+  uint64_t First = FirstNonEmptyLevel[ResourceType];
+  uint64_t Last = LastIssueCycleVector[ResourceType];
+  
+  SpanIntervals Span;
+  // The first level always counts, as in the cycle by cycle computation.
+  Span.cover(First, min(First + Latency, LastCycle));
+  for (SpanIntervals::const_iterator it = RetiredLevels[ResourceType].begin(),
+       End = RetiredLevels[ResourceType].end(); it != End; ++it) {
+    if (it->End <= First)
+      continue;
+    if (it->Begin > Last)
+      break;
+    // A run of levels covers up to Latency cycles after its last level.
+    uint64_t RunBegin = max(it->Begin, First);
+    uint64_t RunEnd = min(it->End, Last + 1) - 1 + Latency;
+    Span.cover(RunBegin, min(RunEnd, LastCycle));
+  }
+  return Span;
+}
+#endif
+
+
 unsigned
 DynamicAnalysis::calculateLatencyOnlySpanFinal(unsigned i)
 {
-  CLSFCache[i].resize(LastIssueCycleFinal + MaxLatencyResources);
-  CLSFCache[i] |= CGSFCache[i];
-  CLSFCache[i] ^= CISFCache[i];
-  return CLSFCache[i].count();
+  CLSFSpans[i] = SpanIntervals::symmetricDifference(CGSFSpans[i], CISFSpans[i]);
+  return CLSFSpans[i].count();
 }
 
 
 unsigned
 DynamicAnalysis::getGroupSpanFinal(vector < int >&ResourcesVector)
 {
-  dynamic_bitset <> BitMesh (LastIssueCycleFinal + MaxLatencyResources);
-  for (size_t j = 0; j < ResourcesVector.size(); j++) {
-    // Should probably recurse and calculate this value just in case
-    if (CGSFCache[ResourcesVector[j]].size() != 0)
-      BitMesh |= CGSFCache[ResourcesVector[j]];
-  }
-  return BitMesh.count ();
+  vector<const SpanIntervals *> Sets;
+  for (size_t j = 0; j < ResourcesVector.size(); j++)
+    Sets.push_back(&CGSFSpans[ResourcesVector[j]]);
+  return SpanIntervals::countUnion(Sets);
 }
 
 
 unsigned
 DynamicAnalysis::getGroupOverlapCyclesFinal(vector < int >&ResourcesVector)
 {
-  dynamic_bitset <> BitMesh (LastIssueCycleFinal + MaxLatencyResources);
-  for (size_t j = 0; j < ResourcesVector.size(); j++) {
-    // Should probably recurse and calculate this value just in case
-    if (CGSFCache[ResourcesVector[j]].size() != 0 &&
-        CGSFCache[ResourcesVector[j]].count () != 0) {
-      if (BitMesh.count() == 0)
-        BitMesh ^= CGSFCache[ResourcesVector[j]];
-      else {
-        BitMesh &= CGSFCache[ResourcesVector[j]];
-        if(BitMesh.count() == 0)
-        return 0;
-      }
-    }
-  }
-  return BitMesh.count ();
+  // Resources that never had anything scheduled do not restrict the overlap.
+  vector<const SpanIntervals *> Sets;
+  for (size_t j = 0; j < ResourcesVector.size(); j++)
+    if (!CGSFSpans[ResourcesVector[j]].empty())
+      Sets.push_back(&CGSFSpans[ResourcesVector[j]]);
+  return SpanIntervals::countIntersection(Sets);
 }
 
 
@@ -3764,18 +4139,12 @@ DynamicAnalysis::getGroupOverlapCyclesFinal(vector < int >&ResourcesVector)
 unsigned
 DynamicAnalysis::getOneToAllOverlapCyclesFinal(vector < int >&ResourcesVector)
 {
-  dynamic_bitset <> BitMesh (LastIssueCycleFinal + MaxLatencyResources);
-  
-  for (size_t j = 1; j < ResourcesVector.size(); j++) {
-    if (CGSFCache[ResourcesVector[j]].size() != 0 &&
-        CGSFCache[ResourcesVector[j]].count () != 0)
-    BitMesh |= CGSFCache[ResourcesVector[j]];
-  }
+  vector<const SpanIntervals *> Sets;
+  for (size_t j = 1; j < ResourcesVector.size(); j++)
+    Sets.push_back(&CGSFSpans[ResourcesVector[j]]);
   //We assume the first resoruce is the target resource, that is, the resource we
   // want to calculate the overlap with all others
-  BitMesh &= CGSFCache[ResourcesVector[0]];
-  
-  return BitMesh.count ();
+  return SpanIntervals::countUnion(Sets, &CGSFSpans[ResourcesVector[0]]);
 }
 
 
@@ -3785,19 +4154,23 @@ unsigned
 DynamicAnalysis::getOneToAllOverlapCyclesFinal (vector < int >&ResourcesVector,
                                                 bool Issue)
 {
-  dynamic_bitset <> BitMesh (LastIssueCycleFinal + MaxLatencyResources);
-  
-  for (size_t j = 1; j < ResourcesVector.size(); j++) {
-    if (CGSFCache[ResourcesVector[j]].size() != 0 &&
-        CGSFCache[ResourcesVector[j]].count () != 0)
-    BitMesh |= CGSFCache[ResourcesVector[j]];
-  }
+  vector<const SpanIntervals *> Sets;
+  for (size_t j = 1; j < ResourcesVector.size(); j++)
+    Sets.push_back(&CGSFSpans[ResourcesVector[j]]);
   if (Issue == true)
-    BitMesh &= CISFCache[ResourcesVector[0]];
-  else
-    BitMesh &= CLSFCache[ResourcesVector[0]];
-  
-  return BitMesh.count ();
+    return SpanIntervals::countUnion(Sets, &CISFSpans[ResourcesVector[0]]);
+  return SpanIntervals::countUnion(Sets, &CLSFSpans[ResourcesVector[0]]);
+}
+
+
+// Issue span of Resource together with the span of Stall.
+unsigned
+DynamicAnalysis::getIssueStallSpanFinal(unsigned Resource, unsigned Stall)
+{
+  vector<const SpanIntervals *> Sets;
+  Sets.push_back(&CISFSpans[Resource]);
+  Sets.push_back(&CGSFSpans[Stall]);
+  return SpanIntervals::countUnion(Sets);
 }
 
 
@@ -3823,23 +4196,49 @@ DynamicAnalysis::calculateGroupSpanFinal(vector < int >&ResourcesVector)
   }
   LastCycle += MaxLatencyResources;		// to be safe
   
-  // Prepare a cache of values
-  if (NResources == 1) {
-    CGSFCache[ResourcesVector[0]].resize(LastCycle, false);
-  }else{
-    dynamic_bitset <> BitMesh (LastCycle);
-    
+  if (NResources != 1) {
+    vector<const SpanIntervals *> Sets;
     for (int j = 0; j < NResources; j++) {
+      ResourceType = ResourcesVector[j];
       // Should probably recurse and calculate this value just in case
-      if (CGSFCache[ResourcesVector[j]].size() == 0) {
+      if (CGSFSpans[ResourceType].empty() &&
+          InstructionsCountExtended[ResourceType] != 0) {
         vector < int >tv;
-        tv.push_back(ResourcesVector[j]);
+        tv.push_back(ResourceType);
         calculateGroupSpanFinal(tv);
       }
-      BitMesh |= CGSFCache[ResourcesVector[j]];
+      Sets.push_back(&CGSFSpans[ResourceType]);
+    }
+    return SpanIntervals::countUnion(Sets);
+  }
+  
+#if !defined(EFF_TBV) && !defined(SOURCE_CODE_ANALYSIS)
+  ResourceType = ResourcesVector[0];
+  if (InstructionsCountExtended[ResourceType] > 0 &&
+      LastIssueCycleVector[ResourceType] < RetiredCycles) {
+    AccessWidth = AccessWidths[ResourceType];
+    if (ExecutionUnitsThroughput[ResourceType] == INF)
+      MaxLatency = ExecutionUnitsLatency[ResourceType];
+    else
+      MaxLatency =
+      max(ExecutionUnitsLatency[ResourceType],
+          (unsigned)ceil(AccessWidth/ExecutionUnitsThroughput[ResourceType]));
+    if (MaxLatency > 0) {
+      SpanIntervals & Spans = CGSFSpans[ResourceType];
+      Spans = spanFromRetiredLevels(ResourceType, MaxLatency, LastCycle);
+      // A gap starts at the end of every interval of the span.
+      uint64_t Last = LastIssueCycleVector[ResourceType];
+      for (SpanIntervals::const_iterator it = Spans.begin(); it != Spans.end();
+           ++it)
+        if (it->End > FirstNonEmptyLevel[ResourceType] && it->End <= Last)
+          SpanGaps[ResourceType]++;
+      return Spans.count();
     }
-    return BitMesh.count ();
   }
+#endif
+  
+  SpanIntervals & Spans = CGSFSpans[ResourcesVector[0]];
+  Spans.clear();
   
   LastCycle = 0;
   
@@ -3891,14 +4290,9 @@ DynamicAnalysis::calculateGroupSpanFinal(vector < int >&ResourcesVector)
         getIssueCycleGranularity(ResourceType, AccessWidth,
                                  getNElementsAccess(ResourceType, AccessWidth,
                                                     VectorWidth));
-        if (AvailableCyclesTree[ResourceType] != NULL) {
-          AvailableCyclesTree[ResourceType] =
-          splay(First, AvailableCyclesTree[ResourceType]);
-          if (First == AvailableCyclesTree[ResourceType]->key) {
-            if (AvailableCyclesTree[ResourceType]->issueOccupancy != 0 )
-              IsInAvailableCyclesTree = true;
-          }
-        }
+        OccupancyEntry *Entry = AvailableCycles[ResourceType].find(First);
+        if (Entry != NULL && Entry->issueOccupancy != 0)
+          IsInAvailableCyclesTree = true;
         collectSourceCodeLineStatistics (ResourceType, First, MaxLatency,
                                          MaxLatency - IssueCycleGranularity,
                                          IssueCycleGranularity,
@@ -3911,10 +4305,8 @@ DynamicAnalysis::calculateGroupSpanFinal(vector < int >&ResourcesVector)
     }
   }
   unsigned DominantLevel = First;
-  if (NResources == 1 && MaxLatency > 0) {
-    for (unsigned q = 0; q < MaxLatency; q++)
-      CGSFCache[ResourcesVector[0]][First + q] = 1;
-  }
+  if (NResources == 1 && MaxLatency > 0)
+    Spans.cover(First, First + MaxLatency);
   if (EmptyLevel == false) {
     Span += MaxLatency;
     for (uint64_t i = First + 1; i <= LastCycle; i++) {
@@ -3971,15 +4363,9 @@ DynamicAnalysis::calculateGroupSpanFinal(vector < int >&ResourcesVector)
                                    getNElementsAccess(ResourceType, AccessWidth,
                                                       VectorWidth));
           
-          if (AvailableCyclesTree[ResourceType] != NULL) {
-            AvailableCyclesTree[ResourceType] =
-            splay(i, AvailableCyclesTree[ResourceType]);
-            if (i == AvailableCyclesTree[ResourceType]->key) {
-              if (AvailableCyclesTree[ResourceType]->issueOccupancy != 0) {
-                IsInAvailableCyclesTree = true;
-              }
-            }
-          }
+          OccupancyEntry *Entry = AvailableCycles[ResourceType].find(i);
+          if (Entry != NULL && Entry->issueOccupancy != 0)
+            IsInAvailableCyclesTree = true;
           collectSourceCodeLineStatistics(ResourceType, i, MaxLatencyLevel,
                                           SpanIncrease, IssueCycleGranularity,
                                           IsInAvailableCyclesTree);
@@ -3993,15 +4379,12 @@ DynamicAnalysis::calculateGroupSpanFinal(vector < int >&ResourcesVector)
           }
         }
       }
-      if (NResources == 1 && MaxLatencyLevel > 0) {
-        for (unsigned q = 0; q < MaxLatencyLevel; q++) {
-          CGSFCache[ResourcesVector[0]][i + q] = 1;
-        }
-      }
+      if (NResources == 1 && MaxLatencyLevel > 0)
+        Spans.cover(i, i + MaxLatencyLevel);
     }
   }
   // Delta should be 0
-  unsigned delta = Span - CGSFCache[ResourcesVector[0]].count ();
+  unsigned delta = Span - Spans.count ();
   if (delta != 0)
     report_fatal_error("Error calculating span\n");
   
@@ -4009,60 +4392,23 @@ DynamicAnalysis::calculateGroupSpanFinal(vector < int >&ResourcesVector)
 }
 
 
-// Tree is unbalanced, switch from recursive to iterative method
-void
-DynamicAnalysis::computeAvailableTreeFinalHelper(uint p, Tree < uint64_t > *t,
-                                                 uint d)
-{
-  uint64_t lastKey = 0;
-  while (true) {
-    if (t->left != NULL) {
-      t->left->prev = t;
-      t = t->left;
-      continue;
-    }
-    // insert element
-    if (t->key >= lastKey) {
-      ACTNode *n = new ACTNode;
-      n->key = t->key;
-      n->issueOccupancy = t->issueOccupancy;
-      n->widthOccupancy = t->widthOccupancy;
-      n->occupancyPrefetch = t->occupancyPrefetch;
-      n->address = t->address;
-      ACTFinal.push_back(n, p);
-      lastKey = t->key;
-    }
-    if (t->right != NULL) {
-      t->right->prev = t;
-      t = t->right;
-      continue;
-    }
-    if (t->prev != NULL) {
-      Tree < uint64_t > *old = t;
-      t = t->prev;
-      if (t->left == old)
-        t->left = NULL;
-      if (t->right == old)
-        t->right = NULL;
-      delete old;
-      continue;
-    }else
-      break;
-  }
-}
-
-
 void
 DynamicAnalysis::computeAvailableTreeFinal()
 {
-  uint p = 0;
-  for (auto it = AvailableCyclesTree.begin(),
-       et = AvailableCyclesTree.end(); it != et; ++it) {
-    if ((*it) != NULL) {
-      computeAvailableTreeFinalHelper(p, *it, 0);
-      *it = NULL;
+  ACTNode n;
+  for (unsigned p = 0; p < AvailableCycles.size(); p++) {
+    uint64_t Cycle = 0;
+    while (AvailableCycles[p].findNext(Cycle, Cycle)) {
+      OccupancyEntry *Entry = AvailableCycles[p].find(Cycle);
+      n.key = Cycle;
+      n.issueOccupancy = Entry->issueOccupancy;
+      n.widthOccupancy = Entry->widthOccupancy;
+      n.occupancyPrefetch = Entry->occupancyPrefetch;
+      n.address = 0;
+      ACTFinal.push_back(n, p);
+      Cycle++;
     }
-    p++;
+    AvailableCycles[p].clear();
   }
 }
 
@@ -4145,13 +4491,12 @@ DynamicAnalysis::collectSourceCodeLineStatistics(uint64_t ResourceType,
     }
   }
   
-  if (IsInAvailableCyclesTree == true &&
-      AvailableCyclesTree[ResourceType] != NULL &&
-      AvailableCyclesTree[ResourceType]->key == Cycle) {
+  OccupancyEntry *Entry = AvailableCycles[ResourceType].find(Cycle);
+  if (IsInAvailableCyclesTree == true && Entry != NULL) {
     
     // For every line in the source code
-    for (auto it = AvailableCyclesTree[ResourceType]->SourceCodeLinesOperationPair.begin();
-         it != AvailableCyclesTree[ResourceType]->SourceCodeLinesOperationPair.end(); ++it) {
+    for (auto it = Entry->SourceCodeLinesOperationPair.begin();
+         it != Entry->SourceCodeLinesOperationPair.end(); ++it) {
       Line = (*it).first;
       
       Resource = ResourceType;
@@ -4314,26 +4659,14 @@ DynamicAnalysis::getPositionSourceCodeLineInfoVector (uint64_t Resource)
 uint64_t
 DynamicAnalysis::getMinIssueCycleReservationStation()
 {
-  vector < uint64_t >::iterator it;
-  uint64_t  MinIssueCycle = ReservationStationIssueCycles.front ();
-  for (it = ReservationStationIssueCycles.begin();
-       it != ReservationStationIssueCycles.end(); ++it)
-    MinIssueCycle = min (MinIssueCycle, *it);
-  
-  return MinIssueCycle;
+  return ReservationStationIssueCycles.min();
 }
 
 
 uint64_t
 DynamicAnalysis::getMinCompletionCycleLoadBuffer()
 {
-  vector < uint64_t >::iterator it;
-  uint64_t  MinCompletionCycle = LoadBufferCompletionCycles.front();
-  for (it = LoadBufferCompletionCycles.begin();
-       it != LoadBufferCompletionCycles.end(); ++it) {
-    MinCompletionCycle = min (MinCompletionCycle, *it);
-  }
-  return MinCompletionCycle;
+  return LoadBufferCompletionCycles.min();
 }
 
 
@@ -4346,38 +4679,20 @@ DynamicAnalysis::getMinCompletionCycleLoadBufferTree()
   
 uint64_t DynamicAnalysis::getMinCompletionCycleStoreBuffer()
 {
-  vector < uint64_t >::iterator it;
-  
-  uint64_t  MinCompletionCycle = StoreBufferCompletionCycles.front();
-  for (it = StoreBufferCompletionCycles.begin();
-       it != StoreBufferCompletionCycles.end(); ++it) {
-    MinCompletionCycle = min (MinCompletionCycle, *it);
-  }
-  return MinCompletionCycle;
+  return StoreBufferCompletionCycles.min();
 }
   
 
 uint64_t DynamicAnalysis::getMinCompletionCycleLineFillBuffer()
 {
-  vector < uint64_t >::iterator it;
-  
-  uint64_t MinCompletionCycle = LineFillBufferCompletionCycles.front();
-  for (it = LineFillBufferCompletionCycles.begin();
-       it != LineFillBufferCompletionCycles.end(); ++it) {
-    MinCompletionCycle = min (MinCompletionCycle, *it);
-  }
-  return MinCompletionCycle;
+  return LineFillBufferCompletionCycles.min();
 }
 
   
 void
 DynamicAnalysis::removeFromReservationStation(uint64_t Cycle)
 {
-  LessThanOrEqualValuePred Predicate = { Cycle };
-  ReservationStationIssueCycles.
-  erase (std::remove_if (ReservationStationIssueCycles.begin(),
-                         ReservationStationIssueCycles.end(), Predicate),
-         ReservationStationIssueCycles.end());
+  ReservationStationIssueCycles.expire(Cycle);
 }
 
 
@@ -4393,11 +4708,7 @@ DynamicAnalysis::removeFromReorderBuffer(uint64_t Cycle)
 void
 DynamicAnalysis::removeFromLoadBuffer(uint64_t Cycle)
 {
-  LessThanOrEqualValuePred Predicate = { Cycle };
-  LoadBufferCompletionCycles.
-  erase (std::remove_if (LoadBufferCompletionCycles.begin(),
-                         LoadBufferCompletionCycles.end(), Predicate),
-         LoadBufferCompletionCycles.end());
+  LoadBufferCompletionCycles.expire(Cycle);
 }
 
   
@@ -4414,7 +4725,8 @@ DynamicAnalysis::removeFromLoadBufferTree(uint64_t Cycle)
       LoadBufferCompletionCyclesTree->left = NULL;
       
       LoadBufferCompletionCyclesTree =
-      delete_node(Cycle, LoadBufferCompletionCyclesTree);
+      delete_node(Cycle, LoadBufferCompletionCyclesTree,
+                  &LoadBufferCompletionCyclesNodes);
       if (Cycle >= MinLoadBuffer && LoadBufferCompletionCyclesTree != NULL)
         MinLoadBuffer = min (LoadBufferCompletionCyclesTree);
       if(LoadBufferCompletionCyclesTree==NULL)
@@ -4433,22 +4745,14 @@ DynamicAnalysis::removeFromLoadBufferTree(uint64_t Cycle)
 void
 DynamicAnalysis::removeFromStoreBuffer(uint64_t Cycle)
 {
-  LessThanOrEqualValuePred Predicate = { Cycle };
-  StoreBufferCompletionCycles.
-  erase (std::remove_if (StoreBufferCompletionCycles.begin(),
-                         StoreBufferCompletionCycles.end(), Predicate),
-         StoreBufferCompletionCycles.end());
+  StoreBufferCompletionCycles.expire(Cycle);
 }
 
 
 void
 DynamicAnalysis::removeFromLineFillBuffer(uint64_t Cycle)
 {
-  LessThanOrEqualValuePred Predicate = { Cycle };
-  LineFillBufferCompletionCycles.
-  erase(std::remove_if(LineFillBufferCompletionCycles.begin(),
-                       LineFillBufferCompletionCycles.end(), Predicate),
-        LineFillBufferCompletionCycles.end());
+  LineFillBufferCompletionCycles.expire(Cycle);
 }
 
 
@@ -4485,20 +4789,28 @@ DynamicAnalysis::removeFromDispatchToLineFillBufferQueue(uint64_t Cycle)
 }
 
 
+// Moves the entries of a dispatch queue whose dispatch cycle is the fetch
+// cycle into the corresponding buffer, keeping the order of the rest.
 void
-DynamicAnalysis::dispatchToLoadBuffer(uint64_t Cycle)
+DynamicAnalysis::moveDispatchedToBuffer(vector<InstructionDispatchInfo> &Queue,
+                                        TimedBuffer<uint64_t> &Buffer)
 {
-  vector < InstructionDispatchInfo >::iterator it =
-  DispatchToLoadBufferQueue.begin();
-  for (; it != DispatchToLoadBufferQueue.end();) {
-    if ((*it).IssueCycle == InstructionFetchCycle) {
-      //Erase returns the next valid iterator => insert in LoadBuffer before it
-      // is removed
-      LoadBufferCompletionCycles.push_back((*it).CompletionCycle);
-      it = DispatchToLoadBufferQueue.erase (it);
-    }else
-      ++it;
+  vector < InstructionDispatchInfo >::iterator Out = Queue.begin();
+  for (vector < InstructionDispatchInfo >::iterator it = Queue.begin();
+       it != Queue.end(); ++it) {
+    if ((*it).IssueCycle == InstructionFetchCycle)
+      Buffer.insert((*it).CompletionCycle);
+    else
+      *Out++ = *it;
   }
+  Queue.erase(Out, Queue.end());
+}
+
+
+void
+DynamicAnalysis::dispatchToLoadBuffer(uint64_t Cycle)
+{
+  moveDispatchedToBuffer(DispatchToLoadBufferQueue, LoadBufferCompletionCycles);
 }
 
 
@@ -4531,7 +4843,8 @@ DynamicAnalysis::inOrder(uint64_t i, ComplexTree < uint64_t > *n)
           else
             MinLoadBuffer = min (MinLoadBuffer, n->key);
           LoadBufferCompletionCyclesTree =
-          insert_node(n->key, LoadBufferCompletionCyclesTree);
+          insert_node(n->key, LoadBufferCompletionCyclesTree,
+                      &LoadBufferCompletionCyclesNodes);
         }
         if(n->IssueCycles.size()==1)
           StopChecking = true;
@@ -4554,7 +4867,7 @@ DynamicAnalysis::dispatchToLoadBufferTree(uint64_t Cycle)
     DispatchToLoadBufferQueueTree =
     delete_node(DispatchToLoadBufferQueueTreeCyclesToRemove[i].first,
                 DispatchToLoadBufferQueueTreeCyclesToRemove[i].second,
-                DispatchToLoadBufferQueueTree);
+                DispatchToLoadBufferQueueTree, &DispatchToLoadBufferQueueNodes);
     
   }
 }
@@ -4563,31 +4876,14 @@ DynamicAnalysis::dispatchToLoadBufferTree(uint64_t Cycle)
 void
 DynamicAnalysis::dispatchToStoreBuffer(uint64_t Cycle)
 {
-  vector < InstructionDispatchInfo >::iterator it =
-  DispatchToStoreBufferQueue.begin();
-  for (; it != DispatchToStoreBufferQueue.end();) {
-    if ((*it).IssueCycle == InstructionFetchCycle) {
-      StoreBufferCompletionCycles.push_back((*it).CompletionCycle);
-      it = DispatchToStoreBufferQueue.erase (it);
-    }else
-      ++it;
-  }
+  moveDispatchedToBuffer(DispatchToStoreBufferQueue, StoreBufferCompletionCycles);
 }
 
 
 void
 DynamicAnalysis::dispatchToLineFillBuffer(uint64_t Cycle)
 {
-  vector < InstructionDispatchInfo >::iterator it =
-  DispatchToLineFillBufferQueue.begin();
-  for (; it != DispatchToLineFillBufferQueue.end();) {
-    
-    if ((*it).IssueCycle == InstructionFetchCycle) {
-      LineFillBufferCompletionCycles.push_back((*it).CompletionCycle);
-      it = DispatchToLineFillBufferQueue.erase (it);
-    }else
-      ++it;
-  }
+  moveDispatchedToBuffer(DispatchToLineFillBufferQueue, LineFillBufferCompletionCycles);
 }
 
 
@@ -4609,11 +4905,8 @@ uint64_t DynamicAnalysis::findIssueCycleWhenLineFillBufferIsFull()
           EarliestCompletion = (*it).CompletionCycle;
       }
       return EarliestCompletion;
-    }else {
-      sort (LineFillBufferCompletionCycles.begin(),
-            LineFillBufferCompletionCycles.end());
-      return LineFillBufferCompletionCycles[BufferSize];
-    }
+    }else
+      return LineFillBufferCompletionCycles.kth(BufferSize);
   }
 }
 
@@ -4634,15 +4927,10 @@ uint64_t DynamicAnalysis::findIssueCycleWhenLoadBufferIsFull()
          it != DispatchToLoadBufferQueue.end(); ++it) {
       EarliestDispatchCycle =max(EarliestDispatchCycle, (*it).IssueCycle);
     }
-    //Traverse LB and count how many elements are there *smaller than or equal*
+    // Count how many elements of the LB are *smaller than or equal*
     // EarliestDispathCycle
-    unsigned  counter = 0;
-    for (vector < uint64_t >::iterator it = LoadBufferCompletionCycles.begin();
-         it != LoadBufferCompletionCycles.end();
-         ++it) {
-      if ((*it) <= EarliestDispatchCycle)
-        counter++;
-    }
+    unsigned counter =
+    LoadBufferCompletionCycles.countNotAfter(EarliestDispatchCycle);
     uint64_t IssueCycle = 0;
     // This means that in LB, there are more loads that terminate before or in
     // my dispatch cycle -> IssueCycle is Earliest
@@ -4661,12 +4949,7 @@ uint64_t DynamicAnalysis::findIssueCycleWhenLoadBufferIsFull()
           if ((*it).CompletionCycle > EarliestDispatchCycle)
           CompletedAfterCounter++;
         }
-        for (vector < uint64_t >::iterator it = LoadBufferCompletionCycles.begin();
-             it != LoadBufferCompletionCycles.end();
-             ++it) {
-          if ((*it) > EarliestDispatchCycle)
-          CompletedAfterCounter++;
-        }
+        CompletedAfterCounter += LoadBufferCompletionCycles.size() - counter;
         if(CompletedAfterCounter < LoadBufferSize){
           IssueCycle = EarliestDispatchCycle;
         }else{
@@ -4690,12 +4973,9 @@ uint64_t DynamicAnalysis::findIssueCycleWhenLoadBufferIsFull()
           // the min completion cycle always. If the max completion cycle
           // is smaller than the EarliestDispatchCycle, then it is not necessary
           // to iterate over the LB.
-          for (vector < uint64_t >::iterator it = LoadBufferCompletionCycles.begin();
-               it != LoadBufferCompletionCycles.end();
-               ++it) {
-            if ((*it) > EarliestDispatchCycle)
-              IssueCycle = min (IssueCycle, *it);
-          }
+          if (counter < LoadBufferCompletionCycles.size())
+            IssueCycle = min (IssueCycle,
+                              LoadBufferCompletionCycles.kth(counter));
         }
       }else
         report_fatal_error("Error in Dispatch to Load Buffer Queue");
@@ -4848,10 +5128,8 @@ uint64_t DynamicAnalysis::findIssueCycleWhenStoreBufferIsFull()
           EarliestCompletion = (*it).CompletionCycle;
       }
       return EarliestCompletion;
-    }else {
-      sort (StoreBufferCompletionCycles.begin(), StoreBufferCompletionCycles.end());
-      return StoreBufferCompletionCycles[BufferSize];
-    }
+    }else
+      return StoreBufferCompletionCycles.kth(BufferSize);
   }
 }
 
@@ -4868,13 +5146,14 @@ uint64_t DynamicAnalysis::findIssueCycleWhenStoreBufferIsFull()
 // already contains the right value because they are uses of a previous definition.
 
 void
-DynamicAnalysis::analyzeInstruction (Instruction & I, unsigned OpCode,
+DynamicAnalysis::analyzeInstruction (Instruction & I,
+                                     const InstructionDescriptor & Descriptor,
+                                     unsigned OpCode,
                                      uint64_t addr, unsigned Line,
                                      bool forceAnalyze, unsigned VectorWidth,
                                      unsigned valueRep, bool lastValue,
                                      bool firstValue, bool isSpill)
 {
-  int k = 0;
   int Distance = -1;
   int RegisterStackDistance = -1;
   int NextCacheLineExtendedInstructionType;
@@ -4920,10 +5199,13 @@ DynamicAnalysis::analyzeInstruction (Instruction & I, unsigned OpCode,
   unsigned Port = 0;
   
   // Reset IssuePorts
-  IssuePorts = vector < unsigned >();
+  IssuePorts = 0;
+  NIssuePorts = 0;
   
   vector < uint64_t > emptyVector;
   
+  unsigned InstructionNumber = Descriptor.Number;
+  
   PointerToMemory instructionPTM;
   InstructionValue instValue;
   int64_t valueInstance;
@@ -4944,7 +5226,7 @@ DynamicAnalysis::analyzeInstruction (Instruction & I, unsigned OpCode,
                          OpCode == Instruction::FAdd)){
       InstructionType = 0;
     }else
-    InstructionType = getInstructionType (I);
+    InstructionType = getInstructionType (Descriptor);
   }
   
   unsigned ExtendedInstructionType = InstructionType;
@@ -4996,7 +5278,8 @@ DynamicAnalysis::analyzeInstruction (Instruction & I, unsigned OpCode,
       // =======================================================================
       // Create PointerToMemoryInstance
       // =======================================================================
-      instructionPTMI = {instructionPTM, valueRep, valueInstance};
+      instructionPTMI = {getPointerToMemoryIndex(instructionPTM),
+        valueRep, valueInstance};
 #endif
       
       switch (OpCode) {
@@ -5037,7 +5320,8 @@ DynamicAnalysis::analyzeInstruction (Instruction & I, unsigned OpCode,
       
           // Insert into the global vector of pointers to memory and return a
           // pointer to the pointer to memory in the global vector.
-          associatedPTMI = {associatedPTM, 0, valueInstance};
+          associatedPTMI = {getPointerToMemoryIndex(associatedPTM),
+            0, valueInstance};
           bool insertUse = insertUsesOfPointerToMemory(&I, associatedPTMI);
           if (insertUse)
             increaseInstructionValueInstance({&I, valueRep});
@@ -5046,7 +5330,8 @@ DynamicAnalysis::analyzeInstruction (Instruction & I, unsigned OpCode,
   
         case Instruction::BitCast:{
           associatedPTM = {I.getOperand(0), NULL, NULL, NULL, NULL, NULL};
-          associatedPTMI = {associatedPTM, 0, valueInstance};
+          associatedPTMI = {getPointerToMemoryIndex(associatedPTM),
+            0, valueInstance};
           bool insertUse = insertUsesOfPointerToMemory(&I, associatedPTMI);
           if(insertUse)
           increaseInstructionValueInstance({&I, valueRep});
@@ -5055,7 +5340,8 @@ DynamicAnalysis::analyzeInstruction (Instruction & I, unsigned OpCode,
         
         case Instruction::Alloca:{
           associatedPTM = {&I, NULL, NULL, NULL, NULL, NULL};
-          associatedPTMI = {associatedPTM, 0, valueInstance};
+          associatedPTMI = {getPointerToMemoryIndex(associatedPTM),
+            0, valueInstance};
           bool insertUse = insertUsesOfPointerToMemory(&I, associatedPTMI);
           printPointerToMemoryInstance(associatedPTMI);
           if(insertUse)
@@ -5070,13 +5356,10 @@ DynamicAnalysis::analyzeInstruction (Instruction & I, unsigned OpCode,
           // 1.  Get Memory Address (passed as a reference) and PointerToMemory
           //====================================================================
           if(isSpill){
-            bm_type::right_iterator address_iter =
-            PointerToMemoryInstanceAddressBiMap.right.find(MemoryAddress);
-            if (address_iter == PointerToMemoryInstanceAddressBiMap.right.end())
+            if (!PointerToMemoryInstanceAddresses.findInstance(MemoryAddress,
+                                                             associatedPTMI))
               report_fatal_error("Any spill load should have an associated \
                                  pointer to memory and address.");
-            else
-              associatedPTMI = address_iter->second;
           }else{
             associatedPTMI = managePointerToMemory(instructionPTMI, I, valueRep,
                                                    valueInstance, MemoryAddress,
@@ -5139,13 +5422,10 @@ DynamicAnalysis::analyzeInstruction (Instruction & I, unsigned OpCode,
           // 1.  Get Memory Address and PointerToMemory
           //====================================================================
           if(isSpill){
-            bm_type::right_iterator address_iter =
-            PointerToMemoryInstanceAddressBiMap.right.find(MemoryAddress);
-            if (address_iter == PointerToMemoryInstanceAddressBiMap.right.end())
+            if (!PointerToMemoryInstanceAddresses.findInstance(MemoryAddress,
+                                                             associatedPTMI))
               report_fatal_error("Any spill store should have an associated\
                                  pointer to memory and address.");
-            else
-              associatedPTMI = address_iter->second;
           }else{
             associatedPTMI = managePointerToMemory(instructionPTMI, I, valueRep,
                                                    valueInstance, MemoryAddress,
@@ -5163,8 +5443,7 @@ DynamicAnalysis::analyzeInstruction (Instruction & I, unsigned OpCode,
               if (dyn_cast < StoreInst > (&I)) {
                 operandPosition = 0;
               }else if (CallInst *CI = dyn_cast<CallInst> (&I)){
-                Function * f = CI->getCalledFunction();
-                operandPosition = getStoreOperandPositionIntrinsic(f->getName());
+                operandPosition = getStoreOperandPositionIntrinsic(*CI, Descriptor);
               }else{
                 report_fatal_error("Store operation not found\n");
               }
@@ -5235,9 +5514,8 @@ DynamicAnalysis::analyzeInstruction (Instruction & I, unsigned OpCode,
                 // If a forceAnalyze instruction, and not a load/store.
                 // Check if the operands of the first rep are in the stack.
                 if (CallInst *CI = dyn_cast<CallInst> (&I)){
-                  Function * f = CI->getCalledFunction();
                   vector<int64_t> positions;
-                  getOperandsPositionsIntrinsic(f->getName(), positions, valueRep);
+                  getOperandsPositionsIntrinsic(*CI, Descriptor, positions, valueRep);
                   unsigned NOperands = positions.size();
                   if(NOperands > 0){
                     for (unsigned i = 0; i < NOperands; i++)
@@ -5292,7 +5570,8 @@ DynamicAnalysis::analyzeInstruction (Instruction & I, unsigned OpCode,
     instValue = {&I, valueRep};
     valueInstance = getInstructionValueInstance(instValue);
     instructionPTM = {&I, NULL, NULL, NULL, NULL, NULL};
-    instructionPTMI = {instructionPTM, valueRep, valueInstance};
+    instructionPTMI = {getPointerToMemoryIndex(instructionPTM),
+      valueRep, valueInstance};
     if(OpCode ==Instruction::GetElementPtr || OpCode ==Instruction::BitCast ||
        OpCode == Instruction::Alloca){
       increaseInstructionValueInstance(instValue);
@@ -5320,6 +5599,11 @@ DynamicAnalysis::analyzeInstruction (Instruction & I, unsigned OpCode,
             IsVectorInstruction = true;
           }else
             IsVectorInstruction = false;
+        }else if (OpCode == I.getOpcode()){
+          if (Descriptor.NElementsVector > 0) {
+            IsVectorInstruction = true;
+            NElementsVector = Descriptor.NElementsVector;
+          }
         }else{
           if (NumOperands > 0) {
             int OperandPosition = (OpCode == Instruction::Store) ? 1 : 0;
@@ -5377,10 +5661,11 @@ DynamicAnalysis::analyzeInstruction (Instruction & I, unsigned OpCode,
       case Instruction::Switch:
       {
         InstructionIssueCycle =max(max (InstructionFetchCycle, BasicBlockBarrier),
-                                   getInstructionValueIssueCycle (&I));
+                                   getInstructionValueIssueCycle(
+                                     InstructionNumber));
         //Iterate over the uses of the generated value
-        for (User * U:I.users ())
-          insertInstructionValueIssueCycle(U, InstructionIssueCycle + 1  );
+        for (const pair<unsigned, bool> &U : Descriptor.Users)
+          insertInstructionValueIssueCycle(U.first, InstructionIssueCycle + 1);
       }
       
       break;
@@ -5390,7 +5675,8 @@ DynamicAnalysis::analyzeInstruction (Instruction & I, unsigned OpCode,
         if(incomingValues==0)
           report_fatal_error("PHI node with no incoming predecessors");
         InstructionIssueCycle =max(max (InstructionFetchCycle, BasicBlockBarrier),
-                                   getInstructionValueIssueCycle (&I));
+                                   getInstructionValueIssueCycle(
+                                     InstructionNumber));
         for (unsigned i = 0; i < incomingValues; i++){
           BasicBlock * incomingBlock  = PN->getIncomingBlock(i);
           if(incomingBlock == PrevBB && dyn_cast<Constant> (PN->getIncomingValue(i))){
@@ -5425,7 +5711,8 @@ DynamicAnalysis::analyzeInstruction (Instruction & I, unsigned OpCode,
           ArgVals.push_back(V);
         }
         InstructionIssueCycle =max(max (InstructionFetchCycle, BasicBlockBarrier),
-                                   getInstructionValueIssueCycle (&I));
+                                   getInstructionValueIssueCycle(
+                                     InstructionNumber));
         break;
       
       //-------------------- Memory Dependences -------------------------------//
@@ -5438,12 +5725,9 @@ DynamicAnalysis::analyzeInstruction (Instruction & I, unsigned OpCode,
           // 1.  Get Memory Address and PointerToMemory
           //====================================================================
           if(isSpill){
-            bm_type::right_iterator address_iter =
-            PointerToMemoryInstanceAddressBiMap.right.find(MemoryAddress);
-            if (address_iter == PointerToMemoryInstanceAddressBiMap.right.end())
+            if (!PointerToMemoryInstanceAddresses.findInstance(MemoryAddress,
+                                                             instructionPTMI))
               report_fatal_error("Any load spill should have an associated address.");
-            else
-              instructionPTMI = address_iter->second;
             associatedPTMI = instructionPTMI;
           }else{
             PointerToMemoryInstanceMapIterator it  =
@@ -5456,14 +5740,10 @@ DynamicAnalysis::analyzeInstruction (Instruction & I, unsigned OpCode,
             }else
               associatedPTMI = it->second;
             
-            bm_type::left_iterator associatedPTMIAddress_iter =
-            PointerToMemoryInstanceAddressBiMap.left.find(associatedPTMI);
-            if(associatedPTMIAddress_iter ==
-               PointerToMemoryInstanceAddressBiMap.left.end())
+            if (!PointerToMemoryInstanceAddresses.findAddress(associatedPTMI,
+                                                            MemoryAddress))
               report_fatal_error("In analysis run every instructionPTMI should \
                                  have an associated memory address");
-            else
-              MemoryAddress = associatedPTMIAddress_iter->second;
           }
           if(RegisterFileSize > 0){
             // =================================================================
@@ -5792,13 +6072,11 @@ DynamicAnalysis::analyzeInstruction (Instruction & I, unsigned OpCode,
           // 1.  Get Memory Address and PointerToMemory
           //====================================================================
           if(isSpill){
-            bm_type::right_iterator address_iter =
-            PointerToMemoryInstanceAddressBiMap.right.find(MemoryAddress);
-            if (address_iter == PointerToMemoryInstanceAddressBiMap.right.end()){
+            if (!PointerToMemoryInstanceAddresses.findInstance(MemoryAddress,
+                                                             instructionPTMI)){
               report_fatal_error("Any store spill should have an associated\
                                  address.");
-            }else
-              instructionPTMI = address_iter->second;
+            }
             associatedPTMI = instructionPTMI;
           }else{
             PointerToMemoryInstanceMapIterator it  =
@@ -5809,14 +6087,10 @@ DynamicAnalysis::analyzeInstruction (Instruction & I, unsigned OpCode,
             else
               associatedPTMI = it->second;
             
-            bm_type::left_iterator associatedPTMIAddress_iter =
-            PointerToMemoryInstanceAddressBiMap.left.find(associatedPTMI);
-            if (associatedPTMIAddress_iter ==
-               PointerToMemoryInstanceAddressBiMap.left.end())
+            if (!PointerToMemoryInstanceAddresses.findAddress(associatedPTMI,
+                                                            MemoryAddress))
               report_fatal_error("In analysis run every instructionPTMI should\
                                  have an associated memory address");
-            else
-              MemoryAddress = associatedPTMIAddress_iter->second;
           }
 
           if(RegisterFileSize > 0){
@@ -5830,8 +6104,7 @@ DynamicAnalysis::analyzeInstruction (Instruction & I, unsigned OpCode,
               if (dyn_cast < StoreInst > (&I))
                 operandPosition = 0;
               else if (CallInst *CI = dyn_cast<CallInst> (&I)){
-                Function * f = CI->getCalledFunction();
-                operandPosition = getStoreOperandPositionIntrinsic(f->getName());
+                operandPosition = getStoreOperandPositionIntrinsic(*CI, Descriptor);
               }else
                 report_fatal_error("Store operation not found\n");
               
@@ -6007,7 +6280,8 @@ DynamicAnalysis::analyzeInstruction (Instruction & I, unsigned OpCode,
           // 12.  Minimum instruction issue cycle based on data dependencies
           //====================================================================
           if(!isSpill)
-            InstructionIssueDataDeps = getInstructionValueIssueCycle (&I);
+            InstructionIssueDataDeps =
+              getInstructionValueIssueCycle(InstructionNumber);
           else
             InstructionIssueDataDeps = InstructionIssueFetchCycle;
           
@@ -6145,7 +6419,7 @@ DynamicAnalysis::analyzeInstruction (Instruction & I, unsigned OpCode,
       // of info about how iterate through functions, bbs, etc.
       F = I.getParent ()->getParent ();
       InstructionIssueCycle = max(max (InstructionFetchCycle, BasicBlockBarrier),
-                                 getInstructionValueIssueCycle (&I));
+                                 getInstructionValueIssueCycle(InstructionNumber));
 
       for (User * U:F->users ()) {
         for (User * UI:U->users ())
@@ -6178,13 +6452,13 @@ DynamicAnalysis::analyzeInstruction (Instruction & I, unsigned OpCode,
               // If a forceAnalyze instruction, and not a load/store.
               // Check if the operands of the first rep are in the stack.
               if (CallInst *CI = dyn_cast<CallInst> (&I)){
-                Function * f = CI->getCalledFunction();
-                getOperandsPositionsIntrinsic(f->getName(), positions, valueRep);
+                getOperandsPositionsIntrinsic(*CI, Descriptor, positions, valueRep);
               }
             }
             unsigned NOperands = positions.size();
             PointerToMemoryInstance emptyPTMI =
-            {{NULL,NULL,NULL,NULL, NULL, NULL},0,-1};
+            {getPointerToMemoryIndex({NULL, NULL, NULL, NULL, NULL, NULL}),
+              0, -1};
             // Here we don't have to check if NOperands is 0, because if it is
             // zero the for loop is never executed.
             for (unsigned i = 0; i < NOperands; i++){
@@ -6254,7 +6528,8 @@ DynamicAnalysis::analyzeInstruction (Instruction & I, unsigned OpCode,
         // =====================================================================
         // 7.  Issue cycle based on fetch cycle and data dependencies
         //======================================================================
-        OriginalInstructionIssueCycle = getInstructionValueIssueCycle (&I);
+        OriginalInstructionIssueCycle =
+          getInstructionValueIssueCycle(InstructionNumber);
         if(InOrderExecution)
           InstructionIssueInOrderExecution = LastInstructionIssueCycle;
         InstructionIssueCycle = max(max(max(InstructionFetchCycle,
@@ -6393,6 +6668,7 @@ DynamicAnalysis::analyzeInstruction (Instruction & I, unsigned OpCode,
       //Iterate over the uses of the generated value (except for GetElementPtr)
       if (OpCode != Instruction::GetElementPtr && !isSpill ) {
 #if LLVM_VERSION_MAJOR<4
+        int k = 0;
 #ifdef PRINT_DEPENDENCIES
         if (valueInstance < 0)
           dbgs()<<  &I << ".0" << " ";
@@ -6476,50 +6752,22 @@ DynamicAnalysis::analyzeInstruction (Instruction & I, unsigned OpCode,
        dbgs() <<"\n";
 #endif
 #else
-        for (User * U:I.users ()) {
-          if (dyn_cast < PHINode > (U))
-            insertInstructionValueIssueCycle(U,
-                                             NewInstructionIssueCycle + Latency,
-                                             true);
-          else
-            insertInstructionValueIssueCycle(U, NewInstructionIssueCycle + Latency);
-          
-          if (dyn_cast < CallInst > (U)) {
-            CS = CallSite (U);
-            F = CS.getCalledFunction ();
-            // Loop over the arguments of the called function
-            NumArgs = CS.arg_size();
-            ArgVals.reserve (NumArgs);
-            for (CallSite::arg_iterator j = CS.arg_begin(), e = CS.arg_end();
-                 j != e; ++j) {
-              Value *V = *j;
-              ArgVals.push_back(V);
-            }
-            // Make sure it is an LLVM-well-defined funciton
-            if (static_cast < Function * >(F)) {
-              for (Function::arg_iterator AI = F->arg_begin(), E = F->arg_end();
-                   AI != E; ++AI, ++k) {
-                if (ArgVals[k] == &I) {
-                  for (Value::use_iterator vi = (*AI).use_begin(),
-                       vie = (*AI).use_end(); vi != vie; ++vi) {
-                    insertInstructionValueIssueCycle(*vi,
-                                                     NewInstructionIssueCycle + Latency);
-                  }
-                }
-              }
-            }
-          }
-        }
+        for (const pair<unsigned, bool> &U : Descriptor.Users)
+          insertInstructionValueIssueCycle(U.first,
+                                           NewInstructionIssueCycle + Latency,
+                                           U.second);
 #endif
       }
       
       if (forceAnalyze == true && !isSpill) {
         if (OpCode == Instruction::Store)
-          insertInstructionValueIssueCycle(&I, NewInstructionIssueCycle);
+          insertInstructionValueIssueCycle(InstructionNumber,
+                                           NewInstructionIssueCycle);
         else {
           // If it is not a store, we force uses only if it is not lastValue.
           if(!lastValue){
-            insertInstructionValueIssueCycle(&I, NewInstructionIssueCycle + Latency);
+            insertInstructionValueIssueCycle(InstructionNumber,
+                                             NewInstructionIssueCycle + Latency);
           }
         }
       }
@@ -6586,7 +6834,7 @@ DynamicAnalysis::analyzeInstruction (Instruction & I, unsigned OpCode,
               if(InstructionIssueLoadBufferAvailable != CycleInsertReservationStation)
                 report_fatal_error("InstructionIssueLoadBufferAvailable != \
                                    CycleInsertReservationStation");
-              ReservationStationIssueCycles.push_back(CycleInsertReservationStation);
+              ReservationStationIssueCycles.insert(CycleInsertReservationStation);
               
               //Put in the DispatchToLoadBufferQueue
               if(SmallBuffers){
@@ -6604,7 +6852,8 @@ DynamicAnalysis::analyzeInstruction (Instruction & I, unsigned OpCode,
                 DispatchToLoadBufferQueueTree =
                 insert_node(NewInstructionIssueCycle + Latency,
                             MaxDispatchToLoadBufferQueueTree,
-                            DispatchToLoadBufferQueueTree);
+                            DispatchToLoadBufferQueueTree,
+                            &DispatchToLoadBufferQueueNodes);
               }
               
 #ifdef SOURCE_CODE_ANALYSIS
@@ -6638,7 +6887,7 @@ DynamicAnalysis::analyzeInstruction (Instruction & I, unsigned OpCode,
                   }
 #endif
                 }else	// There is space on both
-                  LineFillBufferCompletionCycles.push_back(NewInstructionIssueCycle +
+                  LineFillBufferCompletionCycles.insert(NewInstructionIssueCycle +
                                                            Latency);
               }
             }else{
@@ -6655,7 +6904,7 @@ DynamicAnalysis::analyzeInstruction (Instruction & I, unsigned OpCode,
                 //Insert into LB
                 if(SmallBuffers)
                   LoadBufferCompletionCycles.
-                push_back(NewInstructionIssueCycle+Latency);
+                insert(NewInstructionIssueCycle+Latency);
                 else{
                   if (node_size(LoadBufferCompletionCyclesTree) == 0) {
                     MinLoadBuffer = NewInstructionIssueCycle + Latency;
@@ -6665,7 +6914,8 @@ DynamicAnalysis::analyzeInstruction (Instruction & I, unsigned OpCode,
                   }
                   LoadBufferCompletionCyclesTree =
                   insert_node(NewInstructionIssueCycle + Latency,
-                              LoadBufferCompletionCyclesTree);
+                              LoadBufferCompletionCyclesTree,
+                              &LoadBufferCompletionCyclesNodes);
                 }
                 if (ExtendedInstructionType >= L2_LOAD_NODE &&
                     LineFillBufferSize != 0) {
@@ -6676,7 +6926,7 @@ DynamicAnalysis::analyzeInstruction (Instruction & I, unsigned OpCode,
                     DispathInfo.CompletionCycle = NewInstructionIssueCycle + Latency;
                     DispatchToLineFillBufferQueue.push_back(DispathInfo);
                   }else {		// There is space on both
-                    LineFillBufferCompletionCycles.push_back(NewInstructionIssueCycle +
+                    LineFillBufferCompletionCycles.insert(NewInstructionIssueCycle +
                                                              Latency);
                   }
                 }
@@ -6685,7 +6935,7 @@ DynamicAnalysis::analyzeInstruction (Instruction & I, unsigned OpCode,
                 if (ReservationStationSize > 0) {
                   CycleInsertReservationStation = NewInstructionIssueCycle;
                   ReservationStationIssueCycles.
-                  push_back(CycleInsertReservationStation);
+                  insert(CycleInsertReservationStation);
                 }
               }
             }
@@ -6694,7 +6944,7 @@ DynamicAnalysis::analyzeInstruction (Instruction & I, unsigned OpCode,
               if (StoreBufferCompletionCycles.size() == StoreBufferSize &&
                   StoreBufferSize > 0) {
                 CycleInsertReservationStation = findIssueCycleWhenStoreBufferIsFull ();
-                ReservationStationIssueCycles.push_back(CycleInsertReservationStation);
+                ReservationStationIssueCycles.insert(CycleInsertReservationStation);
                 InstructionDispatchInfo DispathInfo;
                 DispathInfo.IssueCycle = findIssueCycleWhenStoreBufferIsFull ();
                 DispathInfo.CompletionCycle = NewInstructionIssueCycle + Latency;
@@ -6714,12 +6964,12 @@ DynamicAnalysis::analyzeInstruction (Instruction & I, unsigned OpCode,
                 if (StoreBufferCompletionCycles.size() != StoreBufferSize &&
                     StoreBufferSize > 0) {
                   StoreBufferCompletionCycles.
-                  push_back(NewInstructionIssueCycle + Latency);
+                  insert(NewInstructionIssueCycle + Latency);
                 }else {
                   if (ReservationStationSize > 0) {
                     CycleInsertReservationStation = NewInstructionIssueCycle;
                     ReservationStationIssueCycles.
-                    push_back(CycleInsertReservationStation);
+                    insert(CycleInsertReservationStation);
                   }
                 }
               }
@@ -6727,7 +6977,7 @@ DynamicAnalysis::analyzeInstruction (Instruction & I, unsigned OpCode,
               // Not load nor store -> Insert into RS if its size is > -1
               if (ReservationStationSize > 0) {
                 CycleInsertReservationStation = NewInstructionIssueCycle;
-                ReservationStationIssueCycles.push_back(CycleInsertReservationStation);
+                ReservationStationIssueCycles.insert(CycleInsertReservationStation);
               }
             }
           }
@@ -6906,6 +7156,15 @@ DynamicAnalysis::finishAnalysisContechSimplified ()
     }
   }
   
+#if !defined(EFF_TBV) && !defined(SOURCE_CODE_ANALYSIS)
+  // Retire all the remaining cycles, so that the spans of single resources
+  // are computed from RetiredLevels instead of level by level.
+  uint64_t MaxLastIssueCycle = 0;
+  for (unsigned i = 0; i < LastIssueCycleVector.size(); i++)
+    MaxLastIssueCycle = max(MaxLastIssueCycle, LastIssueCycleVector[i]);
+  retireCycles(MaxLastIssueCycle + SplitTreeRange);
+#endif
+  
   computeAvailableTreeFinal ();
   
   for (unsigned i = 0; i < NTotalResources; i++) {
@@ -6991,7 +7250,11 @@ DynamicAnalysis::finishAnalysisContechSimplified ()
        ++ReuseDistanceMapIt)
    dbgs() << ReuseDistanceMapIt->first << " " << ReuseDistanceMapIt->second << "\n";
   
+#ifdef SPLAY_REUSE_TREE
  dbgs() << "DATA_SET_SIZE\t" << node_size(ReuseTree) << "\n";
+#else
+ dbgs() << "DATA_SET_SIZE\t" << ReuseTree.size() << "\n";
+#endif
   
   //==================== Print resource statistics ===========================//
   printHeaderStat ("Statistics");
@@ -7130,6 +7393,138 @@ DynamicAnalysis::finishAnalysisContechSimplified ()
   }
   dbgs() << TotalStallSpan << "\n";
   
+  //===================== Span matrices (computed in parallel) ===============//
+  // Every entry that needs the span of a group of resources is one task. The
+  // sections below only print the matrices.
+  {
+    std::unique_ptr<ThreadPool> LocalPool;
+    ThreadPool *Pool = SharedThreadPool;
+    if (Pool == NULL) {
+      LocalPool.reset(new ThreadPool());
+      Pool = LocalPool.get();
+    }
+    // The pool may be running the tasks of other analyzers, so only the tasks
+    // of this one are waited for.
+    vector< std::shared_future<void> > Tasks;
+    for (unsigned i = 0; i < NExecutionUnits; i++) {
+      for (uint j = RS_STALL; j <= LFB_STALL; j++) {
+        uint64_t & Entry = ResourcesStallSpanVector[i][j - RS_STALL];
+        if (InstructionsCountExtended[i] != 0 &&
+            InstructionsCountExtended[j] != 0) {
+          Tasks.push_back(Pool->async([this, &Entry, i, j] {
+            vector < int >tv;
+            tv.push_back(i);
+            tv.push_back(j);
+            Entry = getGroupSpanFinal(tv);
+          }));
+        }
+        else {
+          if (InstructionsCountExtended[i] == 0) {
+            Entry = InstructionsCountExtended[j];
+          }else {
+            if (InstructionsCountExtended[j] == 0) {
+              Entry = ResourcesSpan[i];
+            }
+          }
+        }
+      }
+    }
+    
+#ifdef PRINT_OVERLAPS
+    for (unsigned i = 0; i < NExecutionUnits; i++) {
+      for (uint j = RS_STALL; j <= LFB_STALL; j++) {
+        uint64_t & Entry = ResourcesIssueStallSpanVector[i][j - RS_STALL];
+        if (InstructionsCountExtended[i] != 0 &&
+            InstructionsCountExtended[j] != 0 &&
+            ExecutionUnitsLatency[i]!= 0 && ExecutionUnitsLatency[j]!=0) {
+          Tasks.push_back(Pool->async([this, &Entry, i, j] {
+            Entry = getIssueStallSpanFinal(i, j);
+          }));
+        }
+        else {
+          if (InstructionsCountExtended[i] == 0 || ExecutionUnitsLatency[i]==0) {
+            Entry = InstructionsCountExtended[j];
+          }
+          else {
+            if (InstructionsCountExtended[j] == 0 || ExecutionUnitsLatency[j]==0)
+              Entry = IssueSpan[i];
+          }
+        }
+      }
+    }
+    
+    for (unsigned j = 0; j < NExecutionUnits; j++) {
+      for (unsigned i = 0; i < j; i++) {
+        uint64_t & Entry = ResourcesResourcesNoStallSpanVector[j][i];
+        if (InstructionsCountExtended[i] != 0 &&
+            InstructionsCountExtended[j] != 0 &&
+            ExecutionUnitsLatency[i]!= 0 && ExecutionUnitsLatency[j]!=0) {
+          Tasks.push_back(Pool->async([this, &Entry, i, j] {
+            vector < int >tv;
+            tv.push_back(j);
+            tv.push_back(i);
+            Entry = getGroupSpanFinal(tv);
+          }));
+        }
+        else {
+          if (InstructionsCountExtended[i] == 0 || ExecutionUnitsLatency[i]==0)
+            Entry = ResourcesSpan[j];
+          else if (InstructionsCountExtended[j] == 0 ||
+                   ExecutionUnitsLatency[j]==0) {
+            Entry = ResourcesSpan[i];
+          }else
+            report_fatal_error("This should not be executed\n");
+        }
+      }
+    }
+    
+    for (unsigned j = 0; j < NExecutionUnits; j++) {
+      for (unsigned i = 0; i < j; i++) {
+        uint64_t & Entry = ResourcesResourcesSpanVector[j][i];
+        if (InstructionsCountExtended[i] != 0 &&
+            InstructionsCountExtended[j] != 0 && ResourcesSpan[j] != 0
+            && ResourcesSpan[i] != 0) {
+          Tasks.push_back(Pool->async([this, &Entry, i, j] {
+            vector < int >tv;
+            tv.push_back(j);
+            tv.push_back(i);
+            for (unsigned k = RS_STALL; k <= LFB_STALL; k++) {
+              tv.push_back(k);
+            }
+            Entry = getGroupSpanFinal(tv);
+          }));
+        }else {
+          if (InstructionsCountExtended[i] == 0 || ResourcesSpan[i] == 0) {
+            Entry = TotalStallSpan;
+          }else if (InstructionsCountExtended[j] == 0 || ResourcesSpan[j] == 0)
+            Entry = ResourcesTotalStallSpanVector[i];
+        }
+      }
+    }
+    
+    for (unsigned j = RS_STALL; j <= LFB_STALL; j++) {
+      for (unsigned i = RS_STALL; i < j; i++) {
+        uint64_t & Entry = StallStallSpanVector[j - RS_STALL][i - RS_STALL];
+        if (InstructionsCountExtended[j] != 0 && InstructionsCountExtended[i] != 0) {
+          Tasks.push_back(Pool->async([this, &Entry, i, j] {
+            vector < int >tv;
+            tv.push_back(j);
+            tv.push_back(i);
+            Entry = getGroupSpanFinal(tv);
+          }));
+        }else {
+          if (InstructionsCountExtended[i] == 0) {
+            Entry = ResourcesSpan[j];
+          }else if (InstructionsCountExtended[j] == 0)
+            Entry = ResourcesSpan[i];
+        }
+      }
+    }
+#endif
+    for (std::shared_future<void> &Task : Tasks)
+      Task.wait();
+  }
+  
   //======================= Print port Occupancy =============================//
   if(ConstraintPorts){
     printHeaderStat ("Port occupancy");
@@ -7154,26 +7549,8 @@ DynamicAnalysis::finishAnalysisContechSimplified ()
          ((i < (NArithmeticExecutionUnits + NMovExecutionUnits)) &&
           ((i%2 == 0 && !FloatPrecision) || (i %2 != 0 && FloatPrecision)))){
        dbgs() << getResourceName(i) << "\t\t";
-        for (uint j = RS_STALL; j <= LFB_STALL; j++) {
-          vector < int >tv;
-          if (InstructionsCountExtended[i] != 0 &&
-              InstructionsCountExtended[j] != 0) {
-            tv.push_back(i);
-            tv.push_back(j);
-            ResourcesStallSpanVector[i][j - RS_STALL] = getGroupSpanFinal(tv);
-          }
-          else {
-            if (InstructionsCountExtended[i] == 0) {
-              ResourcesStallSpanVector[i][j - RS_STALL] =
-              InstructionsCountExtended[j];
-            }else {
-              if (InstructionsCountExtended[j] == 0) {
-                ResourcesStallSpanVector[i][j - RS_STALL] = ResourcesSpan[i];
-              }
-            }
-          }
+        for (uint j = RS_STALL; j <= LFB_STALL; j++)
          dbgs() << ResourcesStallSpanVector[i][j - RS_STALL] << "\t";
-        }
        dbgs() << "\n";
       }
     }
@@ -7232,27 +7609,8 @@ DynamicAnalysis::finishAnalysisContechSimplified ()
          ((i < (NArithmeticExecutionUnits + NMovExecutionUnits)) &&
           ((i%2 == 0 && !FloatPrecision) || (i %2 != 0 && FloatPrecision)))){
        dbgs() << getResourceName(i) << "\t\t";
-        for (uint j = RS_STALL; j <= LFB_STALL; j++) {
-          dynamic_bitset <> BitMesh (LastIssueCycleFinal + MaxLatencyResources);
-          if (InstructionsCountExtended[i] != 0 &&
-              InstructionsCountExtended[j] != 0 &&
-              ExecutionUnitsLatency[i]!= 0 && ExecutionUnitsLatency[j]!=0) {
-            BitMesh |= CISFCache[i];
-            BitMesh |= CGSFCache[j];
-            ResourcesIssueStallSpanVector[i][j - RS_STALL] = BitMesh.count ();
-          }
-          else {
-            if (InstructionsCountExtended[i] == 0 || ExecutionUnitsLatency[i]==0) {
-              ResourcesIssueStallSpanVector[i][j - RS_STALL] =
-              InstructionsCountExtended[j];;
-            }
-            else {
-              if (InstructionsCountExtended[j] == 0 || ExecutionUnitsLatency[j]==0)
-                ResourcesIssueStallSpanVector[i][j - RS_STALL] = IssueSpan[i];
-            }
-          }
+        for (uint j = RS_STALL; j <= LFB_STALL; j++)
          dbgs() << ResourcesIssueStallSpanVector[i][j - RS_STALL] << "\t";
-        }
        dbgs() << "\n";
       }
     }
@@ -7322,24 +7680,6 @@ DynamicAnalysis::finishAnalysisContechSimplified ()
           if( i >= (NArithmeticExecutionUnits + NMovExecutionUnits) ||
              ((i < (NArithmeticExecutionUnits + NMovExecutionUnits)) &&
               ((i%2 == 0 && !FloatPrecision) || (i %2 != 0 && FloatPrecision)))){
-            
-            vector < int >tv;
-            if (InstructionsCountExtended[i] != 0 &&
-                InstructionsCountExtended[j] != 0 &&
-                ExecutionUnitsLatency[i]!= 0 && ExecutionUnitsLatency[j]!=0) {
-              tv.push_back(j);
-              tv.push_back(i);
-              ResourcesResourcesNoStallSpanVector[j][i] = getGroupSpanFinal(tv);
-            }
-            else {
-              if (InstructionsCountExtended[i] == 0 || ExecutionUnitsLatency[i]==0)
-                ResourcesResourcesNoStallSpanVector[j][i] = ResourcesSpan[j];
-              else if (InstructionsCountExtended[j] == 0 ||
-                       ExecutionUnitsLatency[j]==0) {
-                ResourcesResourcesNoStallSpanVector[j][i] = ResourcesSpan[i];
-              }else
-                report_fatal_error("This should not be executed\n");
-            }
            dbgs() << ResourcesResourcesNoStallSpanVector[j][i] << "\t";
           }
         } // End of for loop for every other resource
@@ -7411,22 +7751,6 @@ DynamicAnalysis::finishAnalysisContechSimplified ()
           if( i >= (NArithmeticExecutionUnits + NMovExecutionUnits) ||
              ((i < (NArithmeticExecutionUnits + NMovExecutionUnits))
               && ((i%2 == 0 && !FloatPrecision) || (i %2 != 0 && FloatPrecision)))){
-            if (InstructionsCountExtended[i] != 0 &&
-                InstructionsCountExtended[j] != 0 && ResourcesSpan[j] != 0
-                && ResourcesSpan[i] != 0) {
-              vector < int >tv;
-              tv.push_back(j);
-              tv.push_back(i);
-              for (unsigned k = RS_STALL; k <= LFB_STALL; k++) {
-                tv.push_back(k);
-              }
-              ResourcesResourcesSpanVector[j][i] = getGroupSpanFinal(tv);
-            }else {
-              if (InstructionsCountExtended[i] == 0 || ResourcesSpan[i] == 0) {
-                ResourcesResourcesSpanVector[j][i] = TotalStallSpan;
-              }else if (InstructionsCountExtended[j] == 0 || ResourcesSpan[j] == 0)
-                ResourcesResourcesSpanVector[j][i] = ResourcesTotalStallSpanVector[i];
-            }
            dbgs() << ResourcesResourcesSpanVector[j][i] << "\t";
           }
         }
@@ -7488,20 +7812,8 @@ DynamicAnalysis::finishAnalysisContechSimplified ()
   {
     for (unsigned j = RS_STALL; j <= LFB_STALL; j++) {
      dbgs() << getResourceName(j) << "\t\t";
-      for (unsigned i = RS_STALL; i < j; i++) {
-        if (InstructionsCountExtended[j] != 0 && InstructionsCountExtended[i] != 0) {
-          vector < int >tv;
-          tv.push_back(j);
-          tv.push_back(i);
-          StallStallSpanVector[j - RS_STALL][i - RS_STALL] = getGroupSpanFinal(tv);
-        }else {
-          if (InstructionsCountExtended[i] == 0) {
-            StallStallSpanVector[j - RS_STALL][i - RS_STALL] = ResourcesSpan[j];
-          }else if (InstructionsCountExtended[j] == 0)
-            StallStallSpanVector[j - RS_STALL][i - RS_STALL] = ResourcesSpan[i];
-        }
+      for (unsigned i = RS_STALL; i < j; i++)
        dbgs() << StallStallSpanVector[j - RS_STALL][i - RS_STALL] << "\t";
-      }
      dbgs() << "\n";
     }
   }
@@ -7686,58 +7998,90 @@ DynamicAnalysis::finishAnalysisContechSimplified ()
     ResourcesOnlyIssueOverlapCycles (NExecutionUnits,
                                      vector < uint64_t > (NExecutionUnits+NBuffers));
     
+    // The resources active in a cycle only change at the boundaries of their
+    // spans, so count whole segments between consecutive boundaries.
+    vector < bool > Active (NExecutionUnits+NBuffers);
+    vector < uint64_t > Boundaries;
+    Boundaries.push_back(0);
+    Boundaries.push_back(TotalSpan);
+    for (unsigned j = 0; j< NExecutionUnits+NBuffers; j++){
+      Active[j] = InstructionsCountExtended[j]!= 0 &&
+      ExecutionUnitsLatency[j]!= 0;
+      if (!Active[j])
+        continue;
+      const SpanIntervals * Sets[] = { &CGSFSpans[j], &CISFSpans[j], &CLSFSpans[j] };
+      for (unsigned s = 0; s < (j < NExecutionUnits ? 3u : 1u); s++) {
+        for (SpanIntervals::const_iterator it = Sets[s]->begin();
+             it != Sets[s]->end(); ++it) {
+          if (it->Begin < TotalSpan)
+            Boundaries.push_back(it->Begin);
+          if (it->End < TotalSpan)
+            Boundaries.push_back(it->End);
+        }
+      }
+    }
+    sort (Boundaries.begin(), Boundaries.end());
+    Boundaries.erase(unique(Boundaries.begin(), Boundaries.end()),
+                     Boundaries.end());
+    
+    vector < SpanIntervals::Cursor > InSpan, InIssueSpan, InLatencyOnlySpan;
+    for (unsigned j = 0; j< NExecutionUnits+NBuffers; j++){
+      InSpan.push_back(SpanIntervals::Cursor(CGSFSpans[j]));
+      InIssueSpan.push_back(SpanIntervals::Cursor(CISFSpans[j]));
+      InLatencyOnlySpan.push_back(SpanIntervals::Cursor(CLSFSpans[j]));
+    }
+    
     bool L1ResourceFound = false;
-    for (unsigned i = 0; i < TotalSpan; i++){
+    vector < bool > ResourceInCycle (NExecutionUnits+NBuffers);
+    for (size_t b = 0; b + 1 < Boundaries.size(); b++){
+      uint64_t i = Boundaries[b];
+      uint64_t Cycles = Boundaries[b + 1] - i;
       vector < unsigned > resourcesInCycle;
       L1ResourceFound = false;
       for (unsigned j = 0; j< NExecutionUnits+NBuffers; j++){
-        if (InstructionsCountExtended[j]!= 0 && ExecutionUnitsLatency[j]!= 0
-            && CGSFCache[j][i]==1 )
+        ResourceInCycle[j] = Active[j] && InSpan[j].contains(i);
+        if (ResourceInCycle[j])
         resourcesInCycle.push_back(j);
       }
       
       for (unsigned j = 0; j< resourcesInCycle.size(); j++){
-        ResourcesOverlapCycles[resourcesInCycle[j]][resourcesInCycle.size()]++;
+        ResourcesOverlapCycles[resourcesInCycle[j]][resourcesInCycle.size()] += Cycles;
         if ((resourcesInCycle[j]==L1_LOAD_CHANNEL ||
              resourcesInCycle[j] == L1_STORE_CHANNEL)){
           if(L1ResourceFound==false){
             L1ResourceFound = true;
-            ResourcesOverlapCycles.back()[resourcesInCycle.size()]++;
+            ResourcesOverlapCycles.back()[resourcesInCycle.size()] += Cycles;
           }else{
-            ResourcesOverlapCycles.back()[resourcesInCycle.size()]--;
-            ResourcesOverlapCycles.back()[resourcesInCycle.size()-1]++;
+            ResourcesOverlapCycles.back()[resourcesInCycle.size()] -= Cycles;
+            ResourcesOverlapCycles.back()[resourcesInCycle.size()-1] += Cycles;
           }
         }
       }
       
       for (unsigned j = 0; j< NExecutionUnits; j++){
         resourcesInCycle.clear();
-        if (InstructionsCountExtended[j]!= 0 && ExecutionUnitsLatency[j]!= 0 &&
-            CISFCache[j][i]==1 ){
+        if (Active[j] && InIssueSpan[j].contains(i)){
           resourcesInCycle.push_back(j);
           for (unsigned k = 0; k< NExecutionUnits; k++){
-            if ( k != j && InstructionsCountExtended[k]!= 0 &&
-                ExecutionUnitsLatency[k]!= 0 && CGSFCache[k][i]==1){
+            if ( k != j && ResourceInCycle[k]){
               resourcesInCycle.push_back(k);
             }
           }
         }
-        ResourcesOnlyIssueOverlapCycles[j][resourcesInCycle.size()]++;
+        ResourcesOnlyIssueOverlapCycles[j][resourcesInCycle.size()] += Cycles;
       }
       
       for (unsigned j = 0; j< NExecutionUnits; j++){
         resourcesInCycle.clear();
-        if (InstructionsCountExtended[j]!= 0  &&  ExecutionUnitsLatency[j]!= 0 &&
-            CLSFCache[j][i]==1){
+        if (Active[j] && InLatencyOnlySpan[j].contains(i)){
           resourcesInCycle.push_back(j);
           for (unsigned k = 0; k< NExecutionUnits; k++){
-            if ( k != j && InstructionsCountExtended[k]!= 0  &&
-                ExecutionUnitsLatency[k]!= 0 &&  CGSFCache[k][i]==1){
+            if ( k != j && ResourceInCycle[k]){
               resourcesInCycle.push_back(k);
             }
           }
         }
-        ResourcesOnlyLatencyOverlapCycles[j][resourcesInCycle.size()]++;
+        ResourcesOnlyLatencyOverlapCycles[j][resourcesInCycle.size()] += Cycles;
       }
     }
     
@@ -8304,6 +8648,20 @@ DynamicAnalysis::finishAnalysisContechSimplified ()
    dbgs() << "__________________________________________________________\n";
   }
 #endif
+
+  // Release all the tree nodes at once.
+#ifdef SPLAY_REUSE_TREE
+  ReuseTree = NULL;
+  PrefetchReuseTree = NULL;
+  ReuseTreeNodes.clear();
+#else
+  ReuseTree.clear();
+  PrefetchReuseTree.clear();
+#endif
+  LoadBufferCompletionCyclesTree = NULL;
+  DispatchToLoadBufferQueueTree = NULL;
+  LoadBufferCompletionCyclesNodes.clear();
+  DispatchToLoadBufferQueueNodes.clear();
 }
 
 
@@ -8313,16 +8671,15 @@ DynamicAnalysis::finishAnalysisContechSimplified ()
 //                              Class ACT
 //===----------------------------------------------------------------------===//
 
-void ACT::push_back(ACTNode * n, unsigned BitPosition)
+void ACT::push_back(const ACTNode & n, unsigned BitPosition)
 {
-  uint64_t i = n->key;
+  uint64_t i = n.key;
   uint64_t TreeChunk = i / SplitTreeRange;
   if (TreeChunk >= act_vec.size())
     act_vec.resize(TreeChunk + 1);
-  bool cond = (n->issueOccupancy != 0);	// Add optional prefetch conditional
+  bool cond = (n.issueOccupancy != 0);	// Add optional prefetch conditional
   if (cond)
-    act_vec[TreeChunk].insert_node(n->key, BitPosition);
-  delete n;
+    act_vec[TreeChunk].insert_node(n.key, BitPosition);
 }
 
 
@@ -0,0 +1,87 @@
+//=------------------ lib/Support/DynamicAnalysisTrace.cpp --------------------=//
+//
+//                     The LLVM Compiler Infrastructure
+//
+//===----------------------------------------------------------------------===//
+//
+// Writer and reader of the binary dynamic instruction trace.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/DynamicAnalysisTrace.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FileSystem.h"
+
+#include <cstring>
+
+using namespace llvm;
+
+// Number of records buffered before they are written to the file.
+#define TRACE_BUFFER_RECORDS 65536
+
+DynamicTraceWriter::DynamicTraceWriter(const std::string &Filename,
+                                       uint64_t NStaticInstructions)
+    : NRecords(0), NStaticInstructions(NStaticInstructions) {
+  std::error_code EC;
+  OS.reset(new raw_fd_ostream(Filename, EC, sys::fs::F_None));
+  if (EC)
+    report_fatal_error("Cannot open trace file " + Filename + ": " +
+                       EC.message());
+  // Placeholder header, rewritten by close() once NRecords is known.
+  DynamicTraceHeader Header;
+  memset(&Header, 0, sizeof(Header));
+  OS->write(reinterpret_cast<const char *>(&Header), sizeof(Header));
+  Buffer.reserve(TRACE_BUFFER_RECORDS);
+}
+
+DynamicTraceWriter::~DynamicTraceWriter() { close(); }
+
+void DynamicTraceWriter::flush() {
+  if (Buffer.empty())
+    return;
+  OS->write(reinterpret_cast<const char *>(Buffer.data()),
+            Buffer.size() * sizeof(DynamicTraceRecord));
+  NRecords += Buffer.size();
+  Buffer.clear();
+}
+
+void DynamicTraceWriter::close() {
+  if (!OS)
+    return;
+  flush();
+
+  DynamicTraceHeader Header;
+  memcpy(Header.Magic, DYNAMIC_TRACE_MAGIC, sizeof(Header.Magic));
+  Header.Version = DYNAMIC_TRACE_VERSION;
+  Header.RecordSize = sizeof(DynamicTraceRecord);
+  Header.NRecords = NRecords;
+  Header.NStaticInstructions = NStaticInstructions;
+  OS->seek(0);
+  OS->write(reinterpret_cast<const char *>(&Header), sizeof(Header));
+  OS->close();
+  if (OS->has_error())
+    report_fatal_error("Error writing the dynamic trace");
+  OS.reset();
+}
+
+DynamicTraceReader::DynamicTraceReader(const std::string &Filename) {
+  // Do not require a null terminator so that the file is memory-mapped.
+  ErrorOr<std::unique_ptr<MemoryBuffer>> FileOrErr =
+      MemoryBuffer::getFile(Filename, -1, false);
+  if (std::error_code EC = FileOrErr.getError())
+    report_fatal_error("Cannot open trace file " + Filename + ": " +
+                       EC.message());
+  File = std::move(FileOrErr.get());
+
+  if (File->getBufferSize() < sizeof(DynamicTraceHeader))
+    report_fatal_error("Trace file " + Filename + " is truncated");
+  Header = reinterpret_cast<const DynamicTraceHeader *>(File->getBufferStart());
+  if (memcmp(Header->Magic, DYNAMIC_TRACE_MAGIC, sizeof(Header->Magic)) != 0)
+    report_fatal_error(Filename + " is not a dynamic analysis trace");
+  if (Header->Version != DYNAMIC_TRACE_VERSION ||
+      Header->RecordSize != sizeof(DynamicTraceRecord))
+    report_fatal_error("Unsupported version of trace file " + Filename);
+  if (File->getBufferSize() != sizeof(DynamicTraceHeader) +
+                                   Header->NRecords * sizeof(DynamicTraceRecord))
+    report_fatal_error("Trace file " + Filename + " is truncated");
+}
@@ -0,0 +1,141 @@
+//=------------------ lib/Support/OccupancyTable.cpp --------------------------=//
+//
+//                     The LLVM Compiler Infrastructure
+//
+//===----------------------------------------------------------------------===//
+//
+// Windowed table of available issue cycles used by DynamicAnalysis.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/OccupancyTable.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MathExtras.h"
+
+using namespace llvm;
+
+OccupancyTable::OccupancyTable(unsigned WindowSize)
+    : Size(WindowSize), Mask(WindowSize - 1), Base(0), NPresent(0),
+      Entries(WindowSize), Present(WindowSize / 64, 0) {
+  if (WindowSize < 64 || !isPowerOf2_32(WindowSize))
+    report_fatal_error("Occupancy window must be a power of two >= 64");
+}
+
+OccupancyEntry *OccupancyTable::find(uint64_t Cycle) {
+  if (inWindow(Cycle)) {
+    unsigned Slot = Cycle & Mask;
+    return isPresent(Slot) ? &Entries[Slot] : nullptr;
+  }
+  auto It = Overflow.find(Cycle);
+  return It == Overflow.end() ? nullptr : &It->second;
+}
+
+OccupancyEntry &OccupancyTable::insert(uint64_t Cycle) {
+  if (!inWindow(Cycle))
+    return Overflow[Cycle];
+  unsigned Slot = Cycle & Mask;
+  if (!isPresent(Slot)) {
+    Present[Slot / 64] |= (uint64_t)1 << (Slot % 64);
+    Entries[Slot] = OccupancyEntry();
+    NPresent++;
+  }
+  return Entries[Slot];
+}
+
+void OccupancyTable::erase(uint64_t Cycle) {
+  if (!inWindow(Cycle)) {
+    Overflow.erase(Cycle);
+    return;
+  }
+  unsigned Slot = Cycle & Mask;
+  if (isPresent(Slot)) {
+    Present[Slot / 64] &= ~((uint64_t)1 << (Slot % 64));
+    NPresent--;
+  }
+}
+
+// Returns the first present slot in [From, To), or To if there is none.
+unsigned OccupancyTable::findPresentSlot(unsigned From, unsigned To) const {
+  unsigned Word = From / 64;
+  uint64_t Bits = Present[Word] & (~(uint64_t)0 << (From % 64));
+  while (true) {
+    if (Bits != 0) {
+      unsigned Slot = Word * 64 + countTrailingZeros(Bits);
+      return Slot < To ? Slot : To;
+    }
+    if (++Word * 64 >= To)
+      return To;
+    Bits = Present[Word];
+  }
+}
+
+bool OccupancyTable::findNext(uint64_t Cycle, uint64_t &Next) const {
+  if (Cycle < Base) {
+    auto It = Overflow.lower_bound(Cycle);
+    if (It != Overflow.end() && It->first < Base) {
+      Next = It->first;
+      return true;
+    }
+    Cycle = Base;
+  }
+
+  if (Cycle - Base < Size && NPresent != 0) {
+    // The window may wrap around the end of the array.
+    unsigned Slot = Cycle & Mask;
+    unsigned Remaining = Size - (Cycle - Base);
+    unsigned End = Slot + Remaining < Size ? Slot + Remaining : Size;
+    unsigned Found = findPresentSlot(Slot, End);
+    if (Found < End) {
+      Next = Cycle + (Found - Slot);
+      return true;
+    }
+    if (Slot + Remaining > Size) {
+      End = Slot + Remaining - Size;
+      Found = findPresentSlot(0, End);
+      if (Found < End) {
+        Next = Cycle + (Size - Slot) + Found;
+        return true;
+      }
+    }
+  }
+
+  auto It = Overflow.lower_bound(Cycle > Base + Size ? Cycle : Base + Size);
+  if (It == Overflow.end())
+    return false;
+  Next = It->first;
+  return true;
+}
+
+// Entries that fall behind the window go to the overflow map, and entries of
+// the overflow map that fall into the new window are moved into the array.
+void OccupancyTable::slide(uint64_t NewBase) {
+  if (NewBase <= Base)
+    return;
+
+  for (uint64_t Cycle = Base;
+       NPresent != 0 && Cycle < NewBase && Cycle < Base + Size; Cycle++) {
+    unsigned Slot = Cycle & Mask;
+    if (isPresent(Slot)) {
+      Overflow[Cycle] = Entries[Slot];
+      Present[Slot / 64] &= ~((uint64_t)1 << (Slot % 64));
+      NPresent--;
+    }
+  }
+
+  uint64_t OldEnd = Base + Size;
+  Base = NewBase;
+  for (auto It = Overflow.lower_bound(OldEnd > Base ? OldEnd : Base);
+       It != Overflow.end() && It->first < Base + Size;) {
+    unsigned Slot = It->first & Mask;
+    Entries[Slot] = It->second;
+    Present[Slot / 64] |= (uint64_t)1 << (Slot % 64);
+    NPresent++;
+    It = Overflow.erase(It);
+  }
+}
+
+void OccupancyTable::clear() {
+  Overflow.clear();
+  Present.assign(Present.size(), 0);
+  NPresent = 0;
+}
@@ -0,0 +1,122 @@
+//=------------------- lib/Support/SpanIntervals.cpp --------------------------=//
+//
+//                     The LLVM Compiler Infrastructure
+//
+//===----------------------------------------------------------------------===//
+//
+// Interval sets of cycles used for the span analysis of DynamicAnalysis.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/SpanIntervals.h"
+#include "llvm/Support/ErrorHandling.h"
+
+#include <algorithm>
+#include <utility>
+
+using namespace llvm;
+
+void SpanIntervals::append(uint64_t Begin, uint64_t End) {
+  if (Begin >= End)
+    return;
+  if (!Intervals.empty() && Begin < Intervals.back().End)
+    report_fatal_error("Span intervals must be appended in order");
+  if (!Intervals.empty() && Begin == Intervals.back().End) {
+    Intervals.back().End = End;
+  } else {
+    Interval I = {Begin, End};
+    Intervals.push_back(I);
+  }
+  NCycles += End - Begin;
+}
+
+void SpanIntervals::cover(uint64_t Begin, uint64_t End) {
+  if (Begin >= End)
+    return;
+  if (!Intervals.empty() && Begin < Intervals.back().Begin)
+    report_fatal_error("Span intervals must be covered in order");
+  if (!Intervals.empty() && Begin <= Intervals.back().End) {
+    if (End > Intervals.back().End) {
+      NCycles += End - Intervals.back().End;
+      Intervals.back().End = End;
+    }
+    return;
+  }
+  append(Begin, End);
+}
+
+bool SpanIntervals::contains(uint64_t Cycle) const {
+  // The first interval that ends after Cycle is the only one that can hold it.
+  std::vector<Interval>::const_iterator It = std::upper_bound(
+      Intervals.begin(), Intervals.end(), Cycle,
+      [](uint64_t C, const Interval &I) { return C < I.End; });
+  return It != Intervals.end() && It->Begin <= Cycle;
+}
+
+void SpanIntervals::clear() {
+  std::vector<Interval>().swap(Intervals);
+  NCycles = 0;
+}
+
+// Sweeps over the interval boundaries of all the sets, keeping how many sets
+// cover the current cycle.
+SpanIntervals
+SpanIntervals::combine(const std::vector<const SpanIntervals *> &Sets,
+                       unsigned MinSets, unsigned MaxSets) {
+  // All the boundaries at the same cycle are applied together, so adjacent
+  // intervals of different sets do not split the result.
+  std::vector<std::pair<uint64_t, int>> Events;
+  for (const SpanIntervals *Set : Sets)
+    for (const Interval &I : Set->Intervals) {
+      Events.push_back(std::make_pair(I.Begin, 1));
+      Events.push_back(std::make_pair(I.End, -1));
+    }
+  std::sort(Events.begin(), Events.end());
+
+  SpanIntervals Result;
+  unsigned Cover = 0;
+  uint64_t Start = 0;
+  for (size_t e = 0; e < Events.size();) {
+    uint64_t Cycle = Events[e].first;
+    bool WasIn = Cover >= MinSets && Cover <= MaxSets;
+    for (; e < Events.size() && Events[e].first == Cycle; e++)
+      Cover += Events[e].second;
+    bool IsIn = Cover >= MinSets && Cover <= MaxSets;
+    if (!WasIn && IsIn)
+      Start = Cycle;
+    else if (WasIn && !IsIn)
+      Result.append(Start, Cycle);
+  }
+  return Result;
+}
+
+uint64_t
+SpanIntervals::countUnion(const std::vector<const SpanIntervals *> &Sets,
+                          const SpanIntervals *Mask) {
+  if (Mask == nullptr && Sets.size() == 1)
+    return Sets[0]->count();
+  SpanIntervals Union = combine(Sets, 1, Sets.size());
+  if (Mask == nullptr)
+    return Union.count();
+  std::vector<const SpanIntervals *> Masked;
+  Masked.push_back(&Union);
+  Masked.push_back(Mask);
+  return combine(Masked, 2, 2).count();
+}
+
+uint64_t
+SpanIntervals::countIntersection(const std::vector<const SpanIntervals *> &Sets) {
+  if (Sets.empty())
+    return 0;
+  if (Sets.size() == 1)
+    return Sets[0]->count();
+  return combine(Sets, Sets.size(), Sets.size()).count();
+}
+
+SpanIntervals SpanIntervals::symmetricDifference(const SpanIntervals &A,
+                                                 const SpanIntervals &B) {
+  std::vector<const SpanIntervals *> Sets;
+  Sets.push_back(&A);
+  Sets.push_back(&B);
+  return combine(Sets, 1, 1);
+}
@@ -1,4 +1,3 @@
-
 #define INTERPRETER
 
 #ifdef INTERPRETER
@@ -7,10 +6,20 @@
 #include "DynamicAnalysis.h"
 #endif
 
+#include "llvm/Support/MathExtras.h"
+
+// Number of 64-bit words of the bit plane of a resource in a chunk.
+static const unsigned PlaneWords = SplitTreeRange / 64;
+// Each bit of a FullWords word summarizes one word of the plane, so a summary
+// word covers 64 words of 64 cycles.
+static const unsigned WordsPerSummaryWord = 64;
+static const unsigned BitsPerSummaryWord = 64 * WordsPerSummaryWord;
 
+
+// The planes of a chunk are only allocated when the first cycle of the
+// corresponding resource is inserted.
 TBV::TBV()
 {
-    tbv_map.resize(SplitTreeRange);
     e = true;
 }
 
@@ -30,13 +39,9 @@ bool TBV::empty()
 }
 
 
-bool  TBV::get_size(){
-return tbv_map.size();
-}
-
-void TBV::resize(){
- //tbv_map.resize(new_size);
-tbv_map.push_back(TBV_node());
+bool TBV::has_plane(unsigned bitPosition)
+{
+    return bitPosition < Planes.size() && !Planes[bitPosition].empty();
 }
 
 
@@ -57,21 +62,61 @@ e = true;
 void TBV::insert_node(uint64_t key, unsigned bitPosition)
 {
     key = key % SplitTreeRange;
+    if (bitPosition >= Planes.size()) {
+      Planes.resize(bitPosition + 1);
+      FullWords.resize(bitPosition + 1);
+    }
+    if (Planes[bitPosition].empty()) {
+      Planes[bitPosition].resize(PlaneWords, 0);
+      FullWords[bitPosition].resize(PlaneWords / WordsPerSummaryWord, 0);
+    }
     e = false;
 
-    tbv_map[key].BitVector[bitPosition] = 1;
+    uint64_t & Word = Planes[bitPosition][key / 64];
+    Word |= (uint64_t)1 << (key % 64);
+    if (~Word == 0)
+      FullWords[bitPosition][key / BitsPerSummaryWord] |=
+          (uint64_t)1 << ((key / 64) % WordsPerSummaryWord);
+}
+
+
+// Sets the bits of the cycles [From, To), which must belong to this chunk.
+void TBV::insert_range(uint64_t From, uint64_t To, unsigned bitPosition)
+{
+    if (From >= To) return;
+    insert_node(From, bitPosition);
+    uint64_t Last = (To - 1) % SplitTreeRange;
+    From = From % SplitTreeRange;
+
+    vector<uint64_t> & Plane = Planes[bitPosition];
+    vector<uint64_t> & Full = FullWords[bitPosition];
+    for (uint64_t Word = From / 64; Word <= Last / 64; Word++) {
+      uint64_t Bits = ~(uint64_t)0;
+      if (Word == From / 64)
+        Bits &= ~(uint64_t)0 << (From % 64);
+      if (Word == Last / 64)
+        Bits &= ~(uint64_t)0 >> (63 - Last % 64);
+      Plane[Word] |= Bits;
+      if (~Plane[Word] == 0)
+        Full[Word / WordsPerSummaryWord] |=
+            (uint64_t)1 << (Word % WordsPerSummaryWord);
+    }
 }
 
 
 #ifdef SOURCE_CODE_ANALYSIS
 void TBV::insert_source_code_line(uint64_t key, unsigned SourceCodeLine, unsigned Resource)
 {
-    tbv_map[key % SplitTreeRange].SourceCodeLinesOperationPair.push_back(std::make_pair(SourceCodeLine,Resource));
+    if (SourceCodeLinesOperationPair.empty())
+      SourceCodeLinesOperationPair.resize(SplitTreeRange);
+    SourceCodeLinesOperationPair[key % SplitTreeRange].push_back(std::make_pair(SourceCodeLine,Resource));
 }
 
 vector<pair<unsigned,unsigned>> TBV::get_source_code_lines(uint64_t key){
+  if (SourceCodeLinesOperationPair.empty())
+    return vector<pair<unsigned,unsigned>>();
 
-  return tbv_map[key % SplitTreeRange].SourceCodeLinesOperationPair;
+  return SourceCodeLinesOperationPair[key % SplitTreeRange];
 
 }
 #endif
@@ -79,8 +124,11 @@ vector<pair<unsigned,unsigned>> TBV::get_source_code_lines(uint64_t key){
 
 void TBV::delete_node(uint64_t key, unsigned bitPosition)
 {
+    if (empty() || !has_plane(bitPosition)) return;
     key = key % SplitTreeRange;
-    tbv_map[key].BitVector[bitPosition] = 0;
+    Planes[bitPosition][key / 64] &= ~((uint64_t)1 << (key % 64));
+    FullWords[bitPosition][key / BitsPerSummaryWord] &=
+        ~((uint64_t)1 << ((key / 64) % WordsPerSummaryWord));
 }
 
 
@@ -96,13 +144,72 @@ bool  TBV_node::get_node(uint64_t bitPosition)
 #endif
 
 
+// Free the planes of a chunk whose cycles have been retired. The chunk reads
+// as empty afterwards.
+void TBV::release()
+{
+    vector< vector<uint64_t> >().swap(Planes);
+    vector< vector<uint64_t> >().swap(FullWords);
+#ifdef SOURCE_CODE_ANALYSIS
+    vector< vector<pair<unsigned,unsigned> > >().swap(SourceCodeLinesOperationPair);
+#endif
+    e = true;
+}
+
+
 bool TBV::get_node(uint64_t key, unsigned bitPosition)
 {
-  if (empty()) return false;
-  //key = key & (SplitTreeRange-1);
-	//key = key - SplitTreeRange;
-    return (tbv_map[key % SplitTreeRange].BitVector[bitPosition] == 1);
+  if (empty() || !has_plane(bitPosition)) return false;
+  key = key % SplitTreeRange;
+  return (Planes[bitPosition][key / 64] >> (key % 64)) & 1;
+}
 
+
+// Returns the position within the chunk of the first cycle from key on whose
+// bit is not set, or SplitTreeRange if all of them are set. Words that are
+// all ones are skipped through FullWords.
+uint64_t TBV::find_next_unset(uint64_t key, unsigned bitPosition)
+{
+  key = key % SplitTreeRange;
+  if (empty() || !has_plane(bitPosition)) return key;
+
+  const vector<uint64_t> & Plane = Planes[bitPosition];
+  const vector<uint64_t> & Full = FullWords[bitPosition];
+  uint64_t Word = key / 64;
+  uint64_t Bits = ~Plane[Word] & (~(uint64_t)0 << (key % 64));
+  if (Bits != 0)
+    return Word * 64 + countTrailingZeros(Bits);
+
+  for (Word++; Word < PlaneWords;) {
+    uint64_t Summary = Word / WordsPerSummaryWord;
+    uint64_t NotFull = ~Full[Summary] &
+                       (~(uint64_t)0 << (Word % WordsPerSummaryWord));
+    if (NotFull != 0) {
+      Word = Summary * WordsPerSummaryWord + countTrailingZeros(NotFull);
+      return Word * 64 + countTrailingZeros(~Plane[Word]);
+    }
+    Word = (Summary + 1) * WordsPerSummaryWord;
+  }
+  return SplitTreeRange;
+}
+
+
+// Returns the position within the chunk of the first cycle from key on whose
+// bit is set, or SplitTreeRange if there is none.
+uint64_t TBV::find_next_set(uint64_t key, unsigned bitPosition)
+{
+  key = key % SplitTreeRange;
+  if (empty() || !has_plane(bitPosition)) return SplitTreeRange;
+
+  const vector<uint64_t> & Plane = Planes[bitPosition];
+  uint64_t Word = key / 64;
+  uint64_t Bits = Plane[Word] & (~(uint64_t)0 << (key % 64));
+  while (Bits == 0) {
+    if (++Word == PlaneWords)
+      return SplitTreeRange;
+    Bits = Plane[Word];
+  }
+  return Word * 64 + countTrailingZeros(Bits);
 }
 
 
@@ -121,24 +228,21 @@ bool  TBV_node::get_node_nb(uint64_t bitPosition)
 bool TBV::get_node_nb(uint64_t key, unsigned bitPosition)
 {
     if (empty()) return false;
-    return (tbv_map[key % SplitTreeRange].BitVector[bitPosition] == 0);
+    return !get_node(key, bitPosition);
 }
 #endif
 uint64_t BitScan(vector< TBV> &FullOccupancyCyclesTree, uint64_t key, unsigned bitPosition)
 {
+    uint64_t chunk = key / SplitTreeRange;
     uint64_t kLocal = key % SplitTreeRange;
-    uint64_t chunk = kLocal / SplitTreeRange;
-    
+
     while (chunk < FullOccupancyCyclesTree.size())
     {
-        while (kLocal < SplitTreeRange)
-        {
-            if (FullOccupancyCyclesTree[chunk].get_node(kLocal, bitPosition)) return (kLocal + chunk * SplitTreeRange);
-            kLocal++;
-        }
+        kLocal = FullOccupancyCyclesTree[chunk].find_next_set(kLocal, bitPosition);
+        if (kLocal < SplitTreeRange) return (kLocal + chunk * SplitTreeRange);
         kLocal = 0;
         chunk++;
     }
-    
+
     return key;
 }
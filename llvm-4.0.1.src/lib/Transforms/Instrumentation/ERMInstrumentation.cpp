@@ -0,0 +1,324 @@
+//===- ERMInstrumentation.cpp - Dynamic trace for ERM from native code ----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a pass that instruments the function analyzed by ERM
+// (and the functions it may call) so that the native program records the
+// dynamic instruction stream that lli -force-interpreter hands to
+// DynamicAnalysis. The events are recorded by the runtime in runtime/erm_trace.c
+// in the format of llvm/Support/DynamicAnalysisTrace.h, and the analysis is
+// run with lli -replay-trace on the original (not instrumented) bitcode.
+//
+// Static instruction ids are the positions of the instructions in module
+// order before instrumentation, as numbered by the interpreter once it has
+// lowered the intrinsics. The ids are therefore taken from a copy of the
+// module whose intrinsics are lowered the same way, and a lowered intrinsic
+// call records the instructions of its lowering, while the native program
+// still executes the call. Each event is recorded before the instruction
+// executes, except for EH pads, which are recorded at the first insertion
+// point of their block. PHI nodes are not recorded, as the interpreter does
+// not analyze them; the branch record carries the edge.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/Instrumentation.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/CodeGen/IntrinsicLowering.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/DynamicAnalysisTrace.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/ModuleUtils.h"
+using namespace llvm;
+
+#define DEBUG_TYPE "erm-instrumentation"
+
+static cl::opt<std::string>
+    ERMFunction("erm-function",
+                cl::desc("Name of the function analyzed by ERM (functions "
+                         "whose name contains it are instrumented)"),
+                cl::init("main"));
+
+STATISTIC(NumInstrumentedFunctions, "Functions instrumented for ERM");
+STATISTIC(NumInstrumentedInstructions, "Instructions instrumented for ERM");
+
+// Kind of a recorded event, used by the runtime to follow the calls made
+// from the target function. Must match runtime/erm_trace.c.
+#define ERM_EVENT_TARGET 0x1 // Instruction of the target function
+#define ERM_EVENT_CALL   0x2 // Call to a defined or unknown function
+#define ERM_EVENT_RETURN 0x4 // Return instruction
+
+namespace {
+struct ERMInstrumentation : public ModulePass {
+  static char ID;
+
+  ERMInstrumentation() : ModulePass(ID) {
+    initializeERMInstrumentationPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnModule(Module &M) override;
+
+private:
+  DenseMap<Instruction *, uint32_t> Ids;
+  // Id of the first instruction of each block, the blocks are modified while
+  // they are instrumented.
+  DenseMap<BasicBlock *, uint32_t> BlockIds;
+  // Instructions of the lowering of each lowered intrinsic call.
+  struct LoweredInstruction {
+    uint32_t Id;
+    unsigned OpCode;
+    bool IsAnalyzedCall;
+  };
+  DenseMap<Instruction *, SmallVector<LoweredInstruction, 4> > Lowerings;
+  Constant *RecordFunction;
+
+  void collectFunctions(Module &M, SetVector<Function *> &Functions);
+  uint32_t numberInstructions(Module &M);
+  void instrumentFunction(Function &F);
+  Value *getSuccessorId(IRBuilder<> &Builder, TerminatorInst *TI);
+  uint32_t getBlockId(BasicBlock *BB) { return BlockIds[BB]; }
+};
+}
+
+char ERMInstrumentation::ID = 0;
+INITIALIZE_PASS(ERMInstrumentation, "erm-instrumentation",
+                "Record the dynamic instruction stream analyzed by ERM",
+                false, false)
+
+static bool isTargetFunction(const Function &F) {
+  return F.getName().find(ERMFunction) != StringRef::npos;
+}
+
+// The interpreter enters a new level of the call stack for calls to defined
+// functions and indirect calls.
+static bool isAnalyzedCall(const Instruction &I) {
+  const CallInst *CI = dyn_cast<CallInst>(&I);
+  if (!CI)
+    return false;
+  const Function *Callee = CI->getCalledFunction();
+  return !Callee || !Callee->isDeclaration();
+}
+
+// The target functions and the functions they may call. If any of them makes
+// an indirect call, all the address-taken functions are included.
+void ERMInstrumentation::collectFunctions(Module &M,
+                                          SetVector<Function *> &Functions) {
+  for (Function &F : M)
+    if (!F.isDeclaration() && isTargetFunction(F))
+      Functions.insert(&F);
+
+  bool IndirectCalls = false;
+  for (unsigned i = 0; i < Functions.size(); i++)
+    for (BasicBlock &BB : *Functions[i])
+      for (Instruction &I : BB) {
+        CallInst *CI = dyn_cast<CallInst>(&I);
+        if (!CI)
+          continue;
+        Function *Callee = CI->getCalledFunction();
+        if (!Callee) {
+          if (!IndirectCalls)
+            for (Function &F : M)
+              if (!F.isDeclaration() && F.hasAddressTaken())
+                Functions.insert(&F);
+          IndirectCalls = true;
+        } else if (!Callee->isDeclaration())
+          Functions.insert(Callee);
+      }
+}
+
+// Number the instructions as the interpreter does, in a copy of the module
+// whose intrinsics are lowered, and return the number of instructions.
+uint32_t ERMInstrumentation::numberInstructions(Module &M) {
+  ValueToValueMapTy VMap;
+  std::unique_ptr<Module> LoweredModule = CloneModule(&M, VMap);
+
+  IntrinsicLowering IL(M.getDataLayout());
+  DenseMap<Instruction *, SmallVector<Instruction *, 4> > LoweredCalls;
+  for (Function &F : M) {
+    if (F.isDeclaration())
+      continue;
+    for (BasicBlock &BB : F)
+      for (Instruction &I : BB) {
+        CallInst *CI = dyn_cast<CallInst>(cast<Instruction>(VMap[&I]));
+        if (!CI || !IntrinsicLowering::isLowerableIntrinsicCall(*CI))
+          continue;
+        // The lowering is inserted before the call, which is then erased.
+        BasicBlock *LoweredBB = CI->getParent();
+        Instruction *Prev = CI->getPrevNode();
+        Instruction *Next = CI->getNextNode();
+        IL.LowerIntrinsicCall(CI);
+        SmallVector<Instruction *, 4> &Lowering = LoweredCalls[&I];
+        for (BasicBlock::iterator It = Prev ? ++Prev->getIterator()
+                                            : LoweredBB->begin();
+             &*It != Next; ++It) {
+          // The events of the lowering carry no address or successor.
+          if (isa<TerminatorInst>(*It) || isa<PHINode>(*It) ||
+              isa<LoadInst>(*It) || isa<StoreInst>(*It))
+            report_fatal_error("Unsupported lowering of intrinsic in " +
+                               F.getName());
+          Lowering.push_back(&*It);
+        }
+      }
+  }
+
+  DenseMap<Instruction *, uint32_t> LoweredIds;
+  uint32_t NStaticInstructions = 0;
+  for (Function &F : *LoweredModule)
+    for (BasicBlock &BB : F)
+      for (Instruction &I : BB)
+        LoweredIds[&I] = NStaticInstructions++;
+
+  Ids.clear();
+  BlockIds.clear();
+  Lowerings.clear();
+  for (Function &F : M)
+    for (BasicBlock &BB : F) {
+      BlockIds[&BB] = LoweredIds[&cast<BasicBlock>(VMap[&BB])->front()];
+      for (Instruction &I : BB)
+        if (!LoweredCalls.count(&I))
+          Ids[&I] = LoweredIds[cast<Instruction>(VMap[&I])];
+    }
+  for (auto &Call : LoweredCalls) {
+    SmallVector<LoweredInstruction, 4> &Lowering = Lowerings[Call.first];
+    for (Instruction *I : Call.second)
+      Lowering.push_back({LoweredIds[I], I->getOpcode(), isAnalyzedCall(*I)});
+  }
+  return NStaticInstructions;
+}
+
+// Id of the first instruction of the successor block the terminator
+// transfers control to.
+Value *ERMInstrumentation::getSuccessorId(IRBuilder<> &Builder,
+                                          TerminatorInst *TI) {
+  if (BranchInst *BI = dyn_cast<BranchInst>(TI)) {
+    if (BI->isUnconditional())
+      return Builder.getInt64(getBlockId(BI->getSuccessor(0)));
+    return Builder.CreateSelect(BI->getCondition(),
+                                Builder.getInt64(getBlockId(BI->getSuccessor(0))),
+                                Builder.getInt64(getBlockId(BI->getSuccessor(1))));
+  }
+  if (SwitchInst *SI = dyn_cast<SwitchInst>(TI)) {
+    Value *Id = Builder.getInt64(getBlockId(SI->getDefaultDest()));
+    for (auto Case : SI->cases())
+      Id = Builder.CreateSelect(
+          Builder.CreateICmpEQ(SI->getCondition(), Case.getCaseValue()),
+          Builder.getInt64(getBlockId(Case.getCaseSuccessor())), Id);
+    return Id;
+  }
+  IndirectBrInst *IBI = cast<IndirectBrInst>(TI);
+  Function *F = IBI->getParent()->getParent();
+  Value *Id = Builder.getInt64(0);
+  for (BasicBlock *Dest : IBI->successors())
+    Id = Builder.CreateSelect(
+        Builder.CreateICmpEQ(IBI->getAddress(),
+                             BlockAddress::get(F, Dest)),
+        Builder.getInt64(getBlockId(Dest)), Id);
+  return Id;
+}
+
+void ERMInstrumentation::instrumentFunction(Function &F) {
+  unsigned TargetKind = isTargetFunction(F) ? ERM_EVENT_TARGET : 0;
+
+  // Collect the instructions first, the recording calls are not recorded.
+  SmallVector<Instruction *, 64> Instructions;
+  for (BasicBlock &BB : F)
+    for (Instruction &I : BB)
+      if (!isa<DbgInfoIntrinsic>(I) && !isa<PHINode>(I))
+        Instructions.push_back(&I);
+
+  IRBuilder<> Builder(F.getContext());
+  for (Instruction *I : Instructions) {
+    if (I->isEHPad())
+      Builder.SetInsertPoint(&*I->getParent()->getFirstInsertionPt());
+    else
+      Builder.SetInsertPoint(I);
+
+    auto Lowering = Lowerings.find(I);
+    if (Lowering != Lowerings.end()) {
+      for (const LoweredInstruction &LI : Lowering->second)
+        Builder.CreateCall(
+            RecordFunction,
+            {Builder.getInt32(LI.Id), Builder.getInt32(LI.OpCode),
+             Builder.getInt32(0), Builder.getInt64(0),
+             Builder.getInt32(TargetKind |
+                              (LI.IsAnalyzedCall ? ERM_EVENT_CALL : 0))});
+      NumInstrumentedInstructions += Lowering->second.size();
+      continue;
+    }
+
+    unsigned Kind = TargetKind;
+    unsigned Flags = 0;
+    Value *Payload = Builder.getInt64(0);
+    if (LoadInst *LI = dyn_cast<LoadInst>(I)) {
+      Flags = TRACE_MEMORY_ACCESS;
+      Payload = Builder.CreatePtrToInt(LI->getPointerOperand(),
+                                       Builder.getInt64Ty());
+    } else if (StoreInst *SI = dyn_cast<StoreInst>(I)) {
+      Flags = TRACE_MEMORY_ACCESS;
+      Payload = Builder.CreatePtrToInt(SI->getPointerOperand(),
+                                       Builder.getInt64Ty());
+    } else if (isa<BranchInst>(I) || isa<SwitchInst>(I) ||
+               isa<IndirectBrInst>(I)) {
+      Flags = TRACE_BRANCH_EDGE;
+      Payload = getSuccessorId(Builder, cast<TerminatorInst>(I));
+    } else if (isa<ReturnInst>(I)) {
+      Kind |= ERM_EVENT_RETURN;
+    } else if (isAnalyzedCall(*I)) {
+      Kind |= ERM_EVENT_CALL;
+    }
+
+    Builder.CreateCall(RecordFunction,
+                       {Builder.getInt32(Ids[I]), Builder.getInt32(I->getOpcode()),
+                        Builder.getInt32(Flags), Payload, Builder.getInt32(Kind)});
+    ++NumInstrumentedInstructions;
+  }
+  ++NumInstrumentedFunctions;
+}
+
+bool ERMInstrumentation::runOnModule(Module &M) {
+  SetVector<Function *> Functions;
+  collectFunctions(M, Functions);
+  if (Functions.empty())
+    return false;
+
+  // Number the instructions before the module is modified.
+  uint32_t NStaticInstructions = numberInstructions(M);
+
+  LLVMContext &Context = M.getContext();
+  IRBuilder<> Builder(Context);
+  RecordFunction = checkSanitizerInterfaceFunction(M.getOrInsertFunction(
+      "__erm_trace_record", Builder.getVoidTy(), Builder.getInt32Ty(),
+      Builder.getInt32Ty(), Builder.getInt32Ty(), Builder.getInt64Ty(),
+      Builder.getInt32Ty(), nullptr));
+
+  for (Function *F : Functions)
+    instrumentFunction(*F);
+
+  // The runtime opens the trace before main is executed.
+  Constant *InitFunction = checkSanitizerInterfaceFunction(
+      M.getOrInsertFunction("__erm_trace_init", Builder.getVoidTy(),
+                            Builder.getInt64Ty(), nullptr));
+  Function *Ctor = Function::Create(
+      FunctionType::get(Builder.getVoidTy(), false),
+      GlobalValue::InternalLinkage, "erm.module_ctor", &M);
+  Builder.SetInsertPoint(BasicBlock::Create(Context, "", Ctor));
+  Builder.CreateCall(InitFunction, Builder.getInt64(NStaticInstructions));
+  Builder.CreateRetVoid();
+  appendToGlobalCtors(M, Ctor, 0);
+  return true;
+}
+
+ModulePass *llvm::createERMInstrumentationPass() {
+  return new ERMInstrumentation();
+}
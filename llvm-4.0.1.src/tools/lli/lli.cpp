@@ -53,6 +53,7 @@
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Instrumentation.h"
+#include "llvm/Transforms/Utils/Cloning.h"
 #include <cerrno>
 
 #ifdef __CYGWIN__
@@ -80,6 +81,12 @@ namespace {
                                  cl::desc("Force interpretation: disable JIT"),
                                  cl::init(false));
 
+  cl::opt<bool> FastForward("fast-forward",
+                            cl::desc("Execute the program with MCJIT and "
+                                     "interpret only the function analyzed "
+                                     "by -function"),
+                            cl::init(false));
+
   cl::opt<JITKind> UseJITKind("jit-kind",
                               cl::desc("Choose underlying JIT kind."),
                               cl::init(JITKind::MCJIT),
@@ -343,6 +350,193 @@ static void addCygMingExtraModule(ExecutionEngine &EE, LLVMContext &Context,
   EE.addModule(std::move(M));
 }
 
+//===----------------------------------------------------------------------===//
+// Native fast-forward
+//
+// With -fast-forward the program is compiled with MCJIT and only the functions
+// selected by the interpreter option -function are executed by an interpreter
+// attached to the dynamic analysis. The interpreter works on a copy of the
+// module whose global variables are mapped onto the ones of the native code,
+// and both run in the same process, so heap and global addresses are the same
+// on both sides. The body of each target function in the native module is
+// replaced by a stub that passes the raw bits of its arguments to
+// runFastForwardTarget.
+//
+// Only arguments and return values of integer (up to 64 bits), float, double
+// and pointer type are supported. Function pointers cannot cross the boundary
+// between native and interpreted code.
+
+static ExecutionEngine *FastForwardInterpreter = nullptr;
+static std::vector<Function *> FastForwardTargets;
+
+static bool isFastForwardType(Type *T) {
+  return (T->isIntegerTy() && T->getIntegerBitWidth() <= 64) ||
+         T->isFloatTy() || T->isDoubleTy() || T->isPointerTy();
+}
+
+static GenericValue bitsToGenericValue(Type *T, uint64_t Bits) {
+  GenericValue V;
+  if (T->isPointerTy())
+    V.PointerVal = (PointerTy)(intptr_t)Bits;
+  else if (T->isIntegerTy())
+    V.IntVal = APInt(T->getIntegerBitWidth(), Bits);
+  else if (T->isFloatTy())
+    V.FloatVal = BitsToFloat((uint32_t)Bits);
+  else
+    V.DoubleVal = BitsToDouble(Bits);
+  return V;
+}
+
+static uint64_t genericValueToBits(Type *T, const GenericValue &V) {
+  if (T->isVoidTy())
+    return 0;
+  if (T->isPointerTy())
+    return (uint64_t)(intptr_t)V.PointerVal;
+  if (T->isIntegerTy())
+    return V.IntVal.getZExtValue();
+  if (T->isFloatTy())
+    return FloatToBits(V.FloatVal);
+  return DoubleToBits(V.DoubleVal);
+}
+
+// Called from the native stub of target function TargetIndex. Args holds one
+// 64-bit slot per argument.
+extern "C" uint64_t runFastForwardTarget(uint32_t TargetIndex,
+                                         const uint64_t *Args) {
+  Function *F = FastForwardTargets[TargetIndex];
+  std::vector<GenericValue> ArgValues;
+  unsigned i = 0;
+  for (Argument &A : F->args())
+    ArgValues.push_back(bitsToGenericValue(A.getType(), Args[i++]));
+  GenericValue Result = FastForwardInterpreter->runFunction(F, ArgValues);
+  return genericValueToBits(F->getReturnType(), Result);
+}
+
+// Replace the body of F with a call to runFastForwardTarget.
+static void createFastForwardStub(Function &F, unsigned TargetIndex) {
+  Module &M = *F.getParent();
+  LLVMContext &Context = M.getContext();
+  Type *Int64Ty = Type::getInt64Ty(Context);
+  Constant *Run = M.getOrInsertFunction("runFastForwardTarget", Int64Ty,
+                                        Type::getInt32Ty(Context),
+                                        Int64Ty->getPointerTo(), nullptr);
+
+  GlobalValue::LinkageTypes Linkage = F.getLinkage();
+  F.deleteBody();
+  F.setLinkage(Linkage);
+
+  IRBuilder<> Builder(BasicBlock::Create(Context, "entry", &F));
+  Value *Args = Builder.CreateAlloca(
+      Int64Ty, Builder.getInt32(std::max<size_t>(F.arg_size(), 1)));
+  unsigned i = 0;
+  for (Argument &A : F.args()) {
+    Type *T = A.getType();
+    Value *Bits;
+    if (T->isPointerTy())
+      Bits = Builder.CreatePtrToInt(&A, Int64Ty);
+    else if (T->isIntegerTy())
+      Bits = Builder.CreateZExt(&A, Int64Ty);
+    else if (T->isFloatTy())
+      Bits = Builder.CreateZExt(Builder.CreateBitCast(&A, Builder.getInt32Ty()),
+                                Int64Ty);
+    else
+      Bits = Builder.CreateBitCast(&A, Int64Ty);
+    Builder.CreateStore(Bits, Builder.CreateConstGEP1_32(Args, i++));
+  }
+  Value *Result =
+      Builder.CreateCall(Run, {Builder.getInt32(TargetIndex), Args});
+
+  Type *RetTy = F.getReturnType();
+  if (RetTy->isVoidTy())
+    Builder.CreateRetVoid();
+  else if (RetTy->isPointerTy())
+    Builder.CreateRet(Builder.CreateIntToPtr(Result, RetTy));
+  else if (RetTy->isIntegerTy())
+    Builder.CreateRet(Builder.CreateTrunc(Result, RetTy));
+  else if (RetTy->isFloatTy())
+    Builder.CreateRet(Builder.CreateBitCast(
+        Builder.CreateTrunc(Result, Builder.getInt32Ty()), RetTy));
+  else
+    Builder.CreateRet(Builder.CreateBitCast(Result, RetTy));
+}
+
+// Split Mod into the native module (Mod itself, with the target functions
+// replaced by stubs) and the module executed by the interpreter, which is
+// returned.
+static std::unique_ptr<Module> prepareFastForward(Module &Mod) {
+  StringMap<cl::Option *> &Options = cl::getRegisteredOptions();
+  cl::Option *FunctionOption = Options.lookup("function");
+  if (!FunctionOption) {
+    errs() << "lli: -fast-forward requires the dynamic analysis interpreter\n";
+    exit(1);
+  }
+  std::string TargetFunction =
+      static_cast<cl::opt<std::string> *>(FunctionOption)->getValue();
+
+  // Global variables are matched by name between the two modules.
+  for (GlobalVariable &GV : Mod.globals())
+    if (!GV.hasName())
+      GV.setName("erm.global");
+
+  std::unique_ptr<Module> InterpretedMod = CloneModule(&Mod);
+
+  // Local symbols are not visible outside the object file, so they are
+  // exported to find their native address.
+  for (GlobalVariable &GV : Mod.globals())
+    if (GV.hasLocalLinkage()) {
+      GV.setLinkage(GlobalValue::ExternalLinkage);
+      GV.setVisibility(GlobalValue::HiddenVisibility);
+    }
+
+  for (Function &F : Mod) {
+    if (F.isDeclaration() || F.getName().find(TargetFunction) == StringRef::npos)
+      continue;
+    bool Supported = !F.isVarArg() && (F.getReturnType()->isVoidTy() ||
+                                       isFastForwardType(F.getReturnType()));
+    for (Argument &A : F.args())
+      Supported &= isFastForwardType(A.getType());
+    if (!Supported) {
+      errs() << "lli: -fast-forward does not support the signature of '"
+             << F.getName() << "'\n";
+      exit(1);
+    }
+    FastForwardTargets.push_back(InterpretedMod->getFunction(F.getName()));
+    createFastForwardStub(F, FastForwardTargets.size() - 1);
+  }
+  if (FastForwardTargets.empty()) {
+    errs() << "lli: no function matches -function=" << TargetFunction << "\n";
+    exit(1);
+  }
+  sys::DynamicLibrary::AddSymbol("runFastForwardTarget",
+                                 (void *)&runFastForwardTarget);
+  return InterpretedMod;
+}
+
+// Create the interpreter of the target functions once the native code has
+// been finalized, and make it use the native global variables.
+static std::unique_ptr<ExecutionEngine>
+createFastForwardInterpreter(std::unique_ptr<Module> InterpretedMod,
+                             ExecutionEngine &NativeEE) {
+  std::string ErrorMsg;
+  EngineBuilder Builder(std::move(InterpretedMod));
+  Builder.setEngineKind(EngineKind::Interpreter);
+  Builder.setErrorStr(&ErrorMsg);
+  std::unique_ptr<ExecutionEngine> Interp(Builder.create());
+  if (!Interp) {
+    errs() << "lli: error creating the interpreter: " << ErrorMsg << "\n";
+    exit(1);
+  }
+
+  for (GlobalVariable &GV : FastForwardTargets.front()->getParent()->globals()) {
+    if (GV.isDeclaration())
+      continue;
+    if (uint64_t Addr = NativeEE.getGlobalValueAddress(GV.getName()))
+      Interp->updateGlobalMapping(&GV, (void *)(intptr_t)Addr);
+  }
+  FastForwardInterpreter = Interp.get();
+  return Interp;
+}
+
 CodeGenOpt::Level getOptLevel() {
   switch (OptLevel) {
   default:
@@ -397,6 +591,12 @@ int main(int argc, char **argv, char * const *envp) {
   if (!Mod)
     reportError(Err, argv[0]);
 
+  if (FastForward && (ForceInterpreter || RemoteMCJIT ||
+                      UseJITKind == JITKind::OrcLazy)) {
+    errs() << "error: -fast-forward requires local execution with MCJIT.\n";
+    exit(1);
+  }
+
   if (UseJITKind == JITKind::OrcLazy) {
     std::vector<std::unique_ptr<Module>> Ms;
     Ms.push_back(std::move(Owner));
@@ -426,6 +626,16 @@ int main(int argc, char **argv, char * const *envp) {
     ExitOnErr(Mod->materializeAll());
   }
 
+  // The interpreted copy of the module is taken before the native module is
+  // given to the EngineBuilder.
+  std::unique_ptr<Module> InterpretedMod;
+  if (FastForward) {
+    ExitOnError ExitOnErr(std::string(*argv) +
+                          ": bitcode didn't read correctly: ");
+    ExitOnErr(Mod->materializeAll());
+    InterpretedMod = prepareFastForward(*Mod);
+  }
+
   std::string ErrorMsg;
   EngineBuilder builder(std::move(Owner));
   builder.setMArch(MArch);
@@ -614,6 +824,9 @@ int main(int argc, char **argv, char * const *envp) {
       // Give MCJIT a chance to apply relocations and set page permissions.
       EE->finalizeObject();
     }
+    std::unique_ptr<ExecutionEngine> FastForwardEE;
+    if (FastForward)
+      FastForwardEE = createFastForwardInterpreter(std::move(InterpretedMod), *EE);
     EE->runStaticConstructorsDestructors(false);
 
     // Trigger compilation separately so code regions that need to be
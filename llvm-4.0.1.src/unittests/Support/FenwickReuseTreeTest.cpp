@@ -0,0 +1,175 @@
+//===- unittests/Support/FenwickReuseTreeTest.cpp - reuse tree tests ------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+#include "llvm/Support/FenwickReuseTree.h"
+#include "llvm/Support/top-down-size-splay.hpp"
+
+using namespace llvm;
+
+namespace {
+
+TEST(FenwickReuseTree, Basic) {
+  FenwickReuseTree Tree;
+  EXPECT_TRUE(Tree.empty());
+  EXPECT_TRUE(Tree.insert(1, 10));
+  EXPECT_TRUE(Tree.insert(3, 30));
+  EXPECT_TRUE(Tree.insert(5, 50));
+  EXPECT_FALSE(Tree.insert(5, 51));
+  EXPECT_EQ(3u, Tree.size());
+
+  uint64_t Address = 0;
+  EXPECT_TRUE(Tree.lookup(5, Address));
+  EXPECT_EQ(50u, Address);
+  EXPECT_FALSE(Tree.lookup(2, Address));
+
+  EXPECT_EQ(3u, Tree.countFrom(0));
+  EXPECT_EQ(2u, Tree.countFrom(2));
+  EXPECT_EQ(2u, Tree.countFrom(3));
+  EXPECT_EQ(0u, Tree.countFrom(6));
+
+  EXPECT_TRUE(Tree.erase(3));
+  EXPECT_FALSE(Tree.erase(3));
+  EXPECT_EQ(1u, Tree.countFrom(2));
+
+  Tree.clear();
+  EXPECT_TRUE(Tree.empty());
+  EXPECT_EQ(0u, Tree.countFrom(0));
+}
+
+// An erased key leaves a dead copy in its slot. Inserting it again while it
+// is still the largest key adds a live copy after the dead one.
+TEST(FenwickReuseTree, ErasedDuplicates) {
+  FenwickReuseTree Tree;
+  uint64_t Address = 0;
+  EXPECT_TRUE(Tree.insert(1, 10));
+  EXPECT_TRUE(Tree.insert(5, 50));
+  EXPECT_TRUE(Tree.erase(5));
+  EXPECT_FALSE(Tree.lookup(5, Address));
+  EXPECT_EQ(0u, Tree.countFrom(5));
+
+  EXPECT_TRUE(Tree.insert(5, 51));
+  EXPECT_FALSE(Tree.insert(5, 52));
+  EXPECT_TRUE(Tree.lookup(5, Address));
+  EXPECT_EQ(51u, Address);
+  EXPECT_EQ(1u, Tree.countFrom(5));
+  EXPECT_EQ(1u, Tree.countFrom(2));
+
+  EXPECT_TRUE(Tree.erase(5));
+  EXPECT_TRUE(Tree.insert(5, 53));
+  EXPECT_TRUE(Tree.lookup(5, Address));
+  EXPECT_EQ(53u, Address);
+  EXPECT_EQ(2u, Tree.size());
+
+  // Four slots are used. Filling the others and inserting once more compacts
+  // the table, which drops the dead copies of 5.
+  for (uint64_t Key = 6; Key < 6 + 1020; Key++)
+    EXPECT_TRUE(Tree.insert(Key, Key));
+  EXPECT_TRUE(Tree.insert(2000, 2000));
+  EXPECT_EQ(1023u, Tree.size());
+  EXPECT_TRUE(Tree.lookup(5, Address));
+  EXPECT_EQ(53u, Address);
+  EXPECT_EQ(1022u, Tree.countFrom(5));
+  EXPECT_EQ(1021u, Tree.countFrom(6));
+  EXPECT_TRUE(Tree.erase(5));
+  EXPECT_FALSE(Tree.lookup(5, Address));
+}
+
+// The first compaction happens when the 1024 initial slots are exactly full.
+TEST(FenwickReuseTree, CompactAtCapacity) {
+  FenwickReuseTree Tree;
+  for (uint64_t Key = 0; Key < 1024; Key++) {
+    EXPECT_TRUE(Tree.insert(Key, Key + 100));
+    if (Key % 2)
+      EXPECT_TRUE(Tree.erase(Key));
+  }
+  EXPECT_EQ(512u, Tree.size());
+  EXPECT_EQ(256u, Tree.countFrom(512));
+
+  // The 512 live keys are compacted into 1024 slots.
+  EXPECT_TRUE(Tree.insert(1024, 1124));
+  EXPECT_EQ(513u, Tree.size());
+  EXPECT_EQ(257u, Tree.countFrom(512));
+  EXPECT_EQ(257u, Tree.countFrom(511));
+  EXPECT_EQ(1u, Tree.countFrom(1023));
+  for (uint64_t Key = 0; Key <= 1024; Key++) {
+    uint64_t Address = 0;
+    EXPECT_EQ(Key % 2 == 0, Tree.lookup(Key, Address));
+    if (Key % 2 == 0)
+      EXPECT_EQ(Key + 100, Address);
+  }
+
+  // The slots fill up again at key 1535, and the 1024 live keys are then
+  // compacted into a table of twice that size.
+  for (uint64_t Key = 1025; Key < 3000; Key++)
+    EXPECT_TRUE(Tree.insert(Key, Key + 100));
+  EXPECT_EQ(2488u, Tree.size());
+  EXPECT_EQ(Tree.size(), Tree.countFrom(0));
+  EXPECT_EQ(1000u, Tree.countFrom(2000));
+  EXPECT_EQ(1976u, Tree.countFrom(1024));
+  uint64_t Address = 0;
+  EXPECT_TRUE(Tree.lookup(1535, Address));
+  EXPECT_EQ(1635u, Address);
+  EXPECT_FALSE(Tree.lookup(1023, Address));
+}
+
+// The successor of a missing key is not counted.
+TEST(FenwickReuseTree, ReuseDistance) {
+  FenwickReuseTree Tree;
+  EXPECT_EQ(0u, Tree.reuseDistance(5));
+  Tree.insert(2, 0);
+  Tree.insert(4, 0);
+  Tree.insert(6, 0);
+  EXPECT_EQ(3u, Tree.reuseDistance(2));
+  EXPECT_EQ(2u, Tree.reuseDistance(4));
+  EXPECT_EQ(2u, Tree.reuseDistance(1));
+  EXPECT_EQ(1u, Tree.reuseDistance(3));
+  EXPECT_EQ(0u, Tree.reuseDistance(5));
+  EXPECT_EQ(0u, Tree.reuseDistance(7));
+}
+
+// Both engines of the reuse distances give the same distances on a trace of
+// cache lines. As in the analysis, a line accessed again has its previous
+// access removed, and the queries include keys that are no longer in the
+// trees.
+TEST(FenwickReuseTree, MatchesSplayTree) {
+  typedef SplayTree::Tree<uint64_t> NodeT;
+  NodePool<NodeT> Pool;
+  NodeT *Root = NULL;
+  FenwickReuseTree Tree;
+
+  const unsigned NLines = 300;
+  std::vector<uint64_t> LastAccess(NLines, 0);
+  uint64_t Seed = 12345;
+  for (uint64_t Time = 1; Time <= 20000; Time++) {
+    Seed = Seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    unsigned Line = (Seed >> 33) % NLines;
+    uint64_t Last = LastAccess[Line];
+    if (Last != 0) {
+      NodeT *Host;
+      ASSERT_EQ(SplayTree::reuse_distance(Last, Root, &Host),
+                Tree.reuseDistance(Last));
+      // A key that was removed, or has never been inserted.
+      uint64_t Missing = (Seed >> 20) % Time;
+      ASSERT_EQ(SplayTree::reuse_distance(Missing, Root, &Host),
+                Tree.reuseDistance(Missing));
+      // Some lines leave the trees, as spilled lines do.
+      if ((Seed >> 40) % 8 != 0) {
+        Root = SplayTree::delete_node(Last, Root, &Pool);
+        EXPECT_TRUE(Tree.erase(Last));
+      }
+    }
+    Root = SplayTree::insert_node(Time, Root, Line, &Pool);
+    EXPECT_TRUE(Tree.insert(Time, Line));
+    LastAccess[Line] = Time;
+  }
+  EXPECT_EQ(SplayTree::node_size(Root), Tree.size());
+}
+
+} // end anonymous namespace
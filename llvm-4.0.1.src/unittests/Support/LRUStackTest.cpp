@@ -0,0 +1,103 @@
+//===- unittests/Support/LRUStackTest.cpp - LRU stack tests ---------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+#include "llvm/Support/LRUStack.h"
+
+using namespace llvm;
+
+namespace {
+
+// Checks that Stack holds Expected, from the least recently used element.
+void expectOrder(const LRUStack<int> &Stack, const std::vector<int> &Expected) {
+  ASSERT_EQ(Expected.size(), Stack.size());
+  for (unsigned i = 0; i < Expected.size(); i++) {
+    EXPECT_EQ(Expected[i], Stack.at(i));
+    EXPECT_EQ((int)i, Stack.position(Expected[i]));
+  }
+}
+
+TEST(LRUStack, Basic) {
+  LRUStack<int> Stack;
+  EXPECT_TRUE(Stack.empty());
+  EXPECT_EQ(-1, Stack.position(1));
+
+  Stack.push(1);
+  Stack.push(2);
+  Stack.push(3);
+  expectOrder(Stack, {1, 2, 3});
+
+  // Pushing an element again moves it to the top.
+  Stack.push(1);
+  expectOrder(Stack, {2, 3, 1});
+  EXPECT_EQ(2, Stack.front());
+
+  EXPECT_TRUE(Stack.remove(3));
+  EXPECT_FALSE(Stack.remove(3));
+  expectOrder(Stack, {2, 1});
+
+  Stack.pop_front();
+  expectOrder(Stack, {1});
+
+  Stack.clear();
+  EXPECT_TRUE(Stack.empty());
+  EXPECT_EQ(-1, Stack.position(1));
+}
+
+// Every push takes a new stamp, so a few elements pushed over and over run
+// out of the 64 initial slots many times. Renumbering keeps the table size.
+TEST(LRUStack, RenumberRepeatedPushes) {
+  LRUStack<int> Stack;
+  for (unsigned i = 0; i < 1000; i++)
+    Stack.push(i % 4);
+  expectOrder(Stack, {0, 1, 2, 3});
+  Stack.push(1);
+  expectOrder(Stack, {0, 2, 3, 1});
+}
+
+// Pushing a 65th element renumbers the 64 stacked ones into a larger table.
+TEST(LRUStack, RenumberGrows) {
+  LRUStack<int> Stack;
+  std::vector<int> Expected;
+  for (int i = 0; i < 200; i++) {
+    Stack.push(i);
+    Expected.push_back(i);
+  }
+  expectOrder(Stack, Expected);
+  EXPECT_EQ(0, Stack.front());
+}
+
+// Removed elements leave free slots behind the next stamp. Renumbering drops
+// them and keeps the order of the remaining elements.
+TEST(LRUStack, RenumberAfterRemovals) {
+  LRUStack<int> Stack;
+  for (int i = 0; i < 64; i++)
+    Stack.push(i);
+  std::vector<int> Expected;
+  for (int i = 0; i < 64; i++) {
+    if (i % 2 == 0)
+      EXPECT_TRUE(Stack.remove(i));
+    else
+      Expected.push_back(i);
+  }
+  expectOrder(Stack, Expected);
+
+  // Moving an element to the top when the stamps are exhausted.
+  Stack.push(1);
+  Expected.erase(Expected.begin());
+  Expected.push_back(1);
+  expectOrder(Stack, Expected);
+
+  Stack.push(64);
+  Expected.push_back(64);
+  expectOrder(Stack, Expected);
+  EXPECT_EQ(-1, Stack.position(0));
+}
+
+} // end anonymous namespace
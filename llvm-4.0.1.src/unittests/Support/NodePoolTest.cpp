@@ -0,0 +1,102 @@
+//===- unittests/Support/NodePoolTest.cpp - splay tree node pool tests ----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/top-down-size-splay.hpp"
+
+namespace {
+
+struct CountedNode {
+  static int Constructed;
+  static int Destroyed;
+  CountedNode() : Value(0) { Constructed++; }
+  ~CountedNode() { Destroyed++; }
+  uint64_t Value;
+};
+int CountedNode::Constructed = 0;
+int CountedNode::Destroyed = 0;
+
+TEST(NodePool, ReusesFreedNodes) {
+  NodePool<CountedNode, 4> Pool;
+  CountedNode *A = Pool.allocate();
+  CountedNode *B = Pool.allocate();
+  EXPECT_NE(A, B);
+  Pool.deallocate(A);
+  EXPECT_EQ(A, Pool.allocate());
+  Pool.deallocate(B);
+  Pool.deallocate(A);
+  // The free list is last in, first out.
+  EXPECT_EQ(A, Pool.allocate());
+  EXPECT_EQ(B, Pool.allocate());
+}
+
+TEST(NodePool, ClearDestroysLiveNodes) {
+  CountedNode::Constructed = CountedNode::Destroyed = 0;
+  {
+    NodePool<CountedNode, 4> Pool;
+    std::vector<CountedNode *> Nodes;
+    // Spread the nodes over several blocks.
+    for (unsigned i = 0; i < 10; i++) {
+      Nodes.push_back(Pool.allocate());
+      Nodes.back()->Value = i;
+    }
+    for (unsigned i = 0; i < 10; i++)
+      EXPECT_EQ(i, Nodes[i]->Value);
+    for (unsigned i = 0; i < 10; i += 3)
+      Pool.deallocate(Nodes[i]);
+    EXPECT_EQ(10, CountedNode::Constructed);
+    EXPECT_EQ(4, CountedNode::Destroyed);
+
+    Pool.clear();
+    EXPECT_EQ(10, CountedNode::Destroyed);
+
+    // The pool can be used again after clear(), and the destructor releases
+    // the nodes allocated since.
+    Pool.allocate();
+    Pool.allocate();
+  }
+  EXPECT_EQ(12, CountedNode::Constructed);
+  EXPECT_EQ(12, CountedNode::Destroyed);
+}
+
+// Nodes of a splay tree spread over two blocks. Deleting half of the keys
+// returns their nodes to the pool, and inserting them again reuses the nodes.
+TEST(NodePool, SplayTree) {
+  typedef SplayTree::Tree<uint64_t> NodeT;
+  NodePool<NodeT> Pool;
+  NodeT *Root = NULL;
+  std::set<NodeT *> Allocated;
+
+  for (uint64_t Key = 0; Key < 2048; Key++) {
+    Root = SplayTree::insert_node(Key, Root, Key * 2, &Pool);
+    Allocated.insert(Root);
+  }
+  EXPECT_EQ(2048u, SplayTree::node_size(Root));
+  EXPECT_EQ(2048u, Allocated.size());
+
+  for (uint64_t Key = 0; Key < 2048; Key += 2)
+    Root = SplayTree::delete_node(Key, Root, &Pool);
+  EXPECT_EQ(1024u, SplayTree::node_size(Root));
+  Root = SplayTree::splay((uint64_t)7, Root);
+  EXPECT_EQ(7u, Root->key);
+  EXPECT_EQ(14u, Root->address);
+
+  for (uint64_t Key = 0; Key < 2048; Key += 2) {
+    Root = SplayTree::insert_node(Key, Root, Key * 3, &Pool);
+    EXPECT_EQ(1u, Allocated.count(Root));
+    EXPECT_EQ(Key * 3, Root->address);
+  }
+  EXPECT_EQ(2048u, SplayTree::node_size(Root));
+
+  // The remaining nodes are released with the pool.
+  Pool.clear();
+}
+
+} // end anonymous namespace
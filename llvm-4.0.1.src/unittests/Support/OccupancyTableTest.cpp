@@ -0,0 +1,116 @@
+//===- unittests/Support/OccupancyTableTest.cpp - occupancy table tests ---===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+#include "llvm/Support/OccupancyTable.h"
+
+using namespace llvm;
+
+namespace {
+
+// Inserts Cycles with their own value as issue occupancy.
+void insertCycles(OccupancyTable &Table, const std::vector<uint64_t> &Cycles) {
+  for (size_t i = 0; i < Cycles.size(); i++)
+    Table.insert(Cycles[i]).issueOccupancy = Cycles[i];
+}
+
+// Checks that findNext enumerates exactly Cycles from From on, and that every
+// one of them keeps its value.
+void expectCycles(OccupancyTable &Table, uint64_t From,
+                  const std::vector<uint64_t> &Cycles) {
+  uint64_t Cycle = From;
+  for (size_t i = 0; i < Cycles.size(); i++) {
+    ASSERT_TRUE(Table.findNext(Cycle, Cycle));
+    ASSERT_EQ(Cycles[i], Cycle);
+    ASSERT_TRUE(Table.find(Cycle) != nullptr);
+    EXPECT_EQ((int32_t)Cycle, Table.find(Cycle)->issueOccupancy);
+    Cycle++;
+  }
+  EXPECT_FALSE(Table.findNext(Cycle, Cycle));
+}
+
+TEST(OccupancyTable, Basic) {
+  OccupancyTable Table;
+  EXPECT_TRUE(Table.empty());
+  EXPECT_TRUE(Table.find(5) == nullptr);
+
+  insertCycles(Table, {5, 63, 64, 1023});
+  EXPECT_FALSE(Table.empty());
+  expectCycles(Table, 0, {5, 63, 64, 1023});
+  expectCycles(Table, 6, {63, 64, 1023});
+
+  // Inserting an existing cycle keeps its entry.
+  Table.insert(64).widthOccupancy = 1;
+  EXPECT_EQ(64, Table.find(64)->issueOccupancy);
+
+  Table.erase(63);
+  Table.erase(62);
+  expectCycles(Table, 6, {64, 1023});
+
+  Table.clear();
+  EXPECT_TRUE(Table.empty());
+  EXPECT_TRUE(Table.find(5) == nullptr);
+}
+
+// Cycles past the end of the window go to the overflow map.
+TEST(OccupancyTable, Overflow) {
+  OccupancyTable Table;
+  insertCycles(Table, {1000, 1024, 5000, 1ULL << 40});
+  expectCycles(Table, 0, {1000, 1024, 5000, 1ULL << 40});
+  expectCycles(Table, 1001, {1024, 5000, 1ULL << 40});
+  expectCycles(Table, 1025, {5000, 1ULL << 40});
+
+  Table.erase(1024);
+  EXPECT_TRUE(Table.find(1024) == nullptr);
+  expectCycles(Table, 1001, {5000, 1ULL << 40});
+  Table.clear();
+  EXPECT_TRUE(Table.empty());
+}
+
+// advance() slides the window in steps of a quarter of its size. Entries
+// behind the new window move to the overflow map, and entries of the
+// overflow map that fall into it move into the array, which wraps around.
+TEST(OccupancyTable, Slide) {
+  OccupancyTable Table;
+  std::vector<uint64_t> Cycles;
+  for (uint64_t Cycle = 0; Cycle < 1500; Cycle += 7)
+    Cycles.push_back(Cycle);
+  insertCycles(Table, Cycles);
+
+  // Nothing moves before the fetch cycle reaches half of the window.
+  Table.advance(511);
+  expectCycles(Table, 0, Cycles);
+
+  // The window becomes [344, 1368).
+  Table.advance(600);
+  expectCycles(Table, 0, Cycles);
+  // 1302 is stored at the start of the array, after the wrap around.
+  expectCycles(Table, 1300, {1302, 1309, 1316, 1323, 1330, 1337, 1344, 1351,
+                             1358, 1365, 1372, 1379, 1386, 1393, 1400, 1407,
+                             1414, 1421, 1428, 1435, 1442, 1449, 1456, 1463,
+                             1470, 1477, 1484, 1491, 1498});
+
+  // New cycles behind the window go to the overflow map as well.
+  Table.insert(3).issueOccupancy = 3;
+  Cycles.insert(Cycles.begin() + 1, 3);
+  expectCycles(Table, 0, Cycles);
+
+  // A jump past the whole window moves every entry to the overflow map.
+  Table.advance(5000);
+  expectCycles(Table, 0, Cycles);
+  Table.insert(5000).issueOccupancy = 5000;
+  Cycles.push_back(5000);
+  expectCycles(Table, 0, Cycles);
+
+  for (size_t i = 0; i < Cycles.size(); i++)
+    Table.erase(Cycles[i]);
+  EXPECT_TRUE(Table.empty());
+}
+
+} // end anonymous namespace
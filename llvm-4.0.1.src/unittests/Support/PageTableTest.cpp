@@ -0,0 +1,129 @@
+//===- unittests/Support/PageTableTest.cpp - page table tests -------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+#include "llvm/Support/PageTable.h"
+
+using namespace llvm;
+
+namespace {
+
+// Pages of 16 values, each covering 4 keys, so a page spans 64 keys.
+typedef PageTable<unsigned, 4, 2> TestTable;
+
+TEST(PageTable, Basic) {
+  TestTable Table;
+  EXPECT_EQ(0u, Table.lookup(0));
+  Table[0] = 1;
+  Table[4] = 2;
+  Table[1ULL << 40] = 3;
+  EXPECT_EQ(1u, Table.lookup(0));
+  EXPECT_EQ(2u, Table.lookup(4));
+  EXPECT_EQ(0u, Table.lookup(8));
+  EXPECT_EQ(3u, Table.lookup(1ULL << 40));
+  EXPECT_EQ(0u, Table.lookup((1ULL << 40) + 4));
+
+  Table.clear();
+  EXPECT_EQ(0u, Table.lookup(0));
+  EXPECT_EQ(0u, Table.lookup(4));
+  EXPECT_EQ(0u, Table.lookup(1ULL << 40));
+}
+
+// The last value of a page and the first of the next one, read in an order
+// that alternates between the cached page and the other.
+TEST(PageTable, PageBoundary) {
+  TestTable Table;
+  Table[60] = 1;
+  Table[64] = 2;
+  Table[124] = 3;
+  EXPECT_EQ(1u, Table.lookup(60));
+  EXPECT_EQ(2u, Table.lookup(64));
+  EXPECT_EQ(1u, Table.lookup(60));
+  EXPECT_EQ(3u, Table.lookup(124));
+  EXPECT_EQ(0u, Table.lookup(128));
+  EXPECT_EQ(0u, Table.lookup(56));
+}
+
+// Keys that are not a multiple of the granularity have their own values.
+TEST(PageTable, OverflowKeys) {
+  TestTable Table;
+  Table[5] = 1;
+  EXPECT_EQ(1u, Table.lookup(5));
+  EXPECT_EQ(0u, Table.lookup(4));
+  EXPECT_EQ(0u, Table.lookup(6));
+
+  Table[4] = 2;
+  Table[7] = 3;
+  EXPECT_EQ(2u, Table.lookup(4));
+  EXPECT_EQ(1u, Table.lookup(5));
+  EXPECT_EQ(3u, Table.lookup(7));
+
+  Table[(1ULL << 40) + 1] = 4;
+  EXPECT_EQ(4u, Table.lookup((1ULL << 40) + 1));
+  EXPECT_EQ(0u, Table.lookup(1ULL << 40));
+
+  Table.clear();
+  EXPECT_EQ(0u, Table.lookup(5));
+  EXPECT_EQ(0u, Table.lookup((1ULL << 40) + 1));
+}
+
+TEST(PageTable, ResetIf) {
+  TestTable Table;
+  // Page 0 only holds values to reset, page 1 keeps one value.
+  Table[0] = 1;
+  Table[8] = 1;
+  Table[64] = 1;
+  Table[68] = 2;
+  Table[65] = 1;
+  Table[66] = 2;
+  // Leave page 0 as the cached page, so that freeing it must drop the cache.
+  EXPECT_EQ(1u, Table.lookup(0));
+
+  Table.resetIf([](unsigned Value) { return Value == 1; });
+  EXPECT_EQ(0u, Table.lookup(0));
+  EXPECT_EQ(0u, Table.lookup(8));
+  EXPECT_EQ(0u, Table.lookup(64));
+  EXPECT_EQ(2u, Table.lookup(68));
+  EXPECT_EQ(0u, Table.lookup(65));
+  EXPECT_EQ(2u, Table.lookup(66));
+
+  // Writing to a freed page allocates a new one with every value reset.
+  Table[4] = 3;
+  EXPECT_EQ(3u, Table.lookup(4));
+  EXPECT_EQ(0u, Table.lookup(0));
+  EXPECT_EQ(0u, Table.lookup(8));
+
+  Table.resetIf([](unsigned) { return true; });
+  EXPECT_EQ(0u, Table.lookup(4));
+  EXPECT_EQ(0u, Table.lookup(68));
+  EXPECT_EQ(0u, Table.lookup(66));
+}
+
+TEST(PageTable, Footprint) {
+  TestTable Table;
+  EXPECT_EQ(0u, Table.footprint());
+  // A page holds 16 values, whichever of them are written.
+  Table[0] = 1;
+  Table[4] = 1;
+  EXPECT_EQ(16u, Table.footprint());
+  Table[64] = 2;
+  EXPECT_EQ(32u, Table.footprint());
+  // Keys off the granularity take one value each.
+  Table[1] = 1;
+  Table[2] = 2;
+  EXPECT_EQ(34u, Table.footprint());
+
+  // Page 0 is freed, since its unwritten values satisfy the predicate too.
+  Table.resetIf([](unsigned Value) { return Value <= 1; });
+  EXPECT_EQ(17u, Table.footprint());
+  Table.clear();
+  EXPECT_EQ(0u, Table.footprint());
+}
+
+} // end anonymous namespace
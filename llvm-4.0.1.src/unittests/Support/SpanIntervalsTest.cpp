@@ -0,0 +1,157 @@
+//===- unittests/Support/SpanIntervalsTest.cpp - interval set tests -------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+#include "llvm/Support/SpanIntervals.h"
+#include <utility>
+
+using namespace llvm;
+
+namespace {
+
+typedef std::vector<std::pair<uint64_t, uint64_t>> IntervalList;
+
+SpanIntervals makeSet(const IntervalList &List) {
+  SpanIntervals Set;
+  for (size_t i = 0; i < List.size(); i++)
+    Set.append(List[i].first, List[i].second);
+  return Set;
+}
+
+IntervalList toList(const SpanIntervals &Set) {
+  IntervalList List;
+  for (SpanIntervals::const_iterator It = Set.begin(), E = Set.end(); It != E;
+       ++It)
+    List.push_back(std::make_pair(It->Begin, It->End));
+  return List;
+}
+
+TEST(SpanIntervals, Append) {
+  SpanIntervals Set;
+  EXPECT_TRUE(Set.empty());
+  // Adjacent intervals are merged and empty ones are ignored.
+  Set.append(2, 4);
+  Set.append(4, 6);
+  Set.append(7, 7);
+  Set.append(8, 9);
+  EXPECT_EQ(5u, Set.count());
+  EXPECT_EQ(IntervalList({{2, 6}, {8, 9}}), toList(Set));
+
+  Set.clear();
+  EXPECT_TRUE(Set.empty());
+  EXPECT_TRUE(Set.begin() == Set.end());
+}
+
+TEST(SpanIntervals, Cursor) {
+  SpanIntervals Set = makeSet({{2, 4}, {6, 7}});
+  SpanIntervals::Cursor C(Set);
+  EXPECT_FALSE(C.contains(0));
+  EXPECT_FALSE(C.contains(1));
+  EXPECT_TRUE(C.contains(2));
+  EXPECT_TRUE(C.contains(3));
+  EXPECT_FALSE(C.contains(4));
+  EXPECT_TRUE(C.contains(6));
+  EXPECT_FALSE(C.contains(7));
+  EXPECT_FALSE(C.contains(100));
+
+  // Queries may repeat a cycle and skip whole intervals.
+  SpanIntervals::Cursor D(Set);
+  EXPECT_TRUE(D.contains(3));
+  EXPECT_TRUE(D.contains(3));
+  EXPECT_TRUE(D.contains(6));
+
+  SpanIntervals Empty;
+  SpanIntervals::Cursor E(Empty);
+  EXPECT_FALSE(E.contains(0));
+}
+
+TEST(SpanIntervals, Cover) {
+  SpanIntervals Set;
+  // Overlapping intervals are merged with the last one.
+  Set.cover(2, 5);
+  Set.cover(2, 4);
+  Set.cover(3, 7);
+  Set.cover(7, 8);
+  Set.cover(10, 12);
+  Set.cover(11, 11);
+  EXPECT_EQ(8u, Set.count());
+  EXPECT_EQ(IntervalList({{2, 8}, {10, 12}}), toList(Set));
+}
+
+TEST(SpanIntervals, Contains) {
+  SpanIntervals Set = makeSet({{2, 4}, {6, 7}, {1000, 5000}});
+  EXPECT_FALSE(Set.contains(0));
+  EXPECT_TRUE(Set.contains(2));
+  EXPECT_TRUE(Set.contains(3));
+  EXPECT_FALSE(Set.contains(4));
+  EXPECT_FALSE(Set.contains(5));
+  EXPECT_TRUE(Set.contains(6));
+  EXPECT_FALSE(Set.contains(7));
+  EXPECT_TRUE(Set.contains(1000));
+  EXPECT_TRUE(Set.contains(4999));
+  EXPECT_FALSE(Set.contains(5000));
+  // Queries need not be in order.
+  EXPECT_TRUE(Set.contains(3));
+  EXPECT_FALSE(SpanIntervals().contains(0));
+}
+
+// Intervals of different sets that touch must not split the result.
+TEST(SpanIntervals, CombineAdjacent) {
+  SpanIntervals A = makeSet({{0, 4}, {10, 12}});
+  SpanIntervals B = makeSet({{4, 8}, {12, 14}});
+  std::vector<const SpanIntervals *> Sets = {&A, &B};
+  EXPECT_EQ(IntervalList({{0, 8}, {10, 14}}),
+            toList(SpanIntervals::combine(Sets, 1, 2)));
+  EXPECT_EQ(12u, SpanIntervals::countUnion(Sets));
+  EXPECT_EQ(0u, SpanIntervals::countIntersection(Sets));
+  EXPECT_EQ(IntervalList({{0, 8}, {10, 14}}),
+            toList(SpanIntervals::symmetricDifference(A, B)));
+}
+
+TEST(SpanIntervals, CombineCover) {
+  SpanIntervals A = makeSet({{0, 10}});
+  SpanIntervals B = makeSet({{2, 6}});
+  SpanIntervals C = makeSet({{4, 8}, {9, 12}});
+  std::vector<const SpanIntervals *> Sets = {&A, &B, &C};
+  EXPECT_EQ(IntervalList({{0, 2}, {8, 9}, {10, 12}}),
+            toList(SpanIntervals::combine(Sets, 1, 1)));
+  EXPECT_EQ(IntervalList({{2, 4}, {6, 8}, {9, 10}}),
+            toList(SpanIntervals::combine(Sets, 2, 2)));
+  EXPECT_EQ(IntervalList({{4, 6}}),
+            toList(SpanIntervals::combine(Sets, 3, 3)));
+  EXPECT_EQ(IntervalList({{2, 8}, {9, 10}}),
+            toList(SpanIntervals::combine(Sets, 2, 3)));
+
+  EXPECT_EQ(12u, SpanIntervals::countUnion(Sets));
+  EXPECT_EQ(2u, SpanIntervals::countIntersection(Sets));
+
+  // The union restricted to a mask that only partly overlaps it.
+  SpanIntervals Mask = makeSet({{1, 3}, {11, 20}});
+  EXPECT_EQ(3u, SpanIntervals::countUnion(Sets, &Mask));
+  std::vector<const SpanIntervals *> One = {&B};
+  EXPECT_EQ(1u, SpanIntervals::countUnion(One, &Mask));
+  EXPECT_EQ(4u, SpanIntervals::countUnion(One));
+}
+
+TEST(SpanIntervals, EmptySets) {
+  SpanIntervals A = makeSet({{3, 5}});
+  SpanIntervals Empty;
+  std::vector<const SpanIntervals *> Sets = {&A, &Empty};
+  EXPECT_EQ(2u, SpanIntervals::countUnion(Sets));
+  EXPECT_EQ(0u, SpanIntervals::countIntersection(Sets));
+  EXPECT_EQ(IntervalList({{3, 5}}),
+            toList(SpanIntervals::symmetricDifference(A, Empty)));
+  EXPECT_TRUE(SpanIntervals::symmetricDifference(A, A).empty());
+
+  std::vector<const SpanIntervals *> NoSets;
+  EXPECT_EQ(0u, SpanIntervals::countUnion(NoSets));
+  EXPECT_EQ(0u, SpanIntervals::countIntersection(NoSets));
+}
+
+} // end anonymous namespace
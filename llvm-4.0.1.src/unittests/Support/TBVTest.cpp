@@ -0,0 +1,142 @@
+//===- unittests/Support/TBVTest.cpp - full occupancy chunk tests ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+#include "llvm/Support/DynamicAnalysis.h"
+
+namespace {
+
+// A summary word of a plane covers 64 words of 64 cycles.
+const uint64_t SummaryCycles = 64 * 64;
+
+TEST(TBV, InsertDelete) {
+  TBV Chunk;
+  EXPECT_TRUE(Chunk.empty());
+  EXPECT_FALSE(Chunk.has_plane(3));
+  // Without a plane, the first unset cycle is the key itself.
+  EXPECT_EQ(10u, Chunk.find_next_unset(10, 3));
+  EXPECT_EQ(SplitTreeRange, Chunk.find_next_set(10, 3));
+
+  // Keys are taken modulo the chunk size.
+  Chunk.insert_node(2 * SplitTreeRange + 10, 3);
+  EXPECT_FALSE(Chunk.empty());
+  EXPECT_TRUE(Chunk.has_plane(3));
+  EXPECT_FALSE(Chunk.has_plane(2));
+  EXPECT_TRUE(Chunk.get_node(10, 3));
+  EXPECT_FALSE(Chunk.get_node(10, 2));
+  EXPECT_FALSE(Chunk.get_node(11, 3));
+  EXPECT_EQ(10u, Chunk.find_next_set(0, 3));
+  EXPECT_EQ(11u, Chunk.find_next_unset(10, 3));
+
+  Chunk.delete_node(10, 3);
+  EXPECT_FALSE(Chunk.get_node(10, 3));
+  EXPECT_EQ(10u, Chunk.find_next_unset(10, 3));
+
+  Chunk.release();
+  EXPECT_TRUE(Chunk.empty());
+  EXPECT_FALSE(Chunk.has_plane(3));
+}
+
+// Full words are skipped through the summary, also across summary words.
+TEST(TBV, FindNextUnsetSkipsFullWords) {
+  TBV Chunk;
+  for (uint64_t Cycle = 0; Cycle < SummaryCycles + 64; Cycle++)
+    Chunk.insert_node(Cycle, 0);
+  EXPECT_EQ(SummaryCycles + 64, Chunk.find_next_unset(0, 0));
+  EXPECT_EQ(SummaryCycles + 64, Chunk.find_next_unset(100, 0));
+  EXPECT_EQ(SummaryCycles + 64, Chunk.find_next_unset(SummaryCycles, 0));
+
+  // Deleting a cycle clears the summary bit of its word.
+  Chunk.delete_node(SummaryCycles - 1, 0);
+  EXPECT_EQ(SummaryCycles - 1, Chunk.find_next_unset(0, 0));
+  EXPECT_EQ(SummaryCycles + 64, Chunk.find_next_unset(SummaryCycles, 0));
+  Chunk.insert_node(SummaryCycles - 1, 0);
+  EXPECT_EQ(SummaryCycles + 64, Chunk.find_next_unset(0, 0));
+
+  // A hole in the middle of a word after several full summary words.
+  for (uint64_t Cycle = SummaryCycles + 64; Cycle < 3 * SummaryCycles; Cycle++)
+    if (Cycle != 2 * SummaryCycles + 100)
+      Chunk.insert_node(Cycle, 0);
+  EXPECT_EQ(2 * SummaryCycles + 100, Chunk.find_next_unset(5, 0));
+  EXPECT_EQ(3 * SummaryCycles, Chunk.find_next_unset(2 * SummaryCycles + 101,
+                                                     0));
+}
+
+// A plane that is full up to the end of the chunk has no unset cycle left.
+TEST(TBV, FindNextUnsetAtChunkEnd) {
+  TBV Chunk;
+  for (uint64_t Cycle = SplitTreeRange - 2 * SummaryCycles;
+       Cycle < SplitTreeRange; Cycle++)
+    Chunk.insert_node(Cycle, 1);
+  EXPECT_EQ(SplitTreeRange - 2 * SummaryCycles - 1,
+            Chunk.find_next_unset(SplitTreeRange - 2 * SummaryCycles - 1, 1));
+  EXPECT_EQ(SplitTreeRange,
+            Chunk.find_next_unset(SplitTreeRange - 2 * SummaryCycles, 1));
+  EXPECT_EQ(SplitTreeRange, Chunk.find_next_unset(SplitTreeRange - 1, 1));
+  EXPECT_EQ(SplitTreeRange - 1, Chunk.find_next_set(SplitTreeRange - 1, 1));
+}
+
+// Ranges are set a word at a time, with partial words at both ends.
+TEST(TBV, InsertRange) {
+  TBV Chunk;
+  Chunk.insert_range(10, 10, 0);
+  EXPECT_TRUE(Chunk.empty());
+
+  // Within one word, and across the boundary of two words.
+  Chunk.insert_range(3, 5, 0);
+  Chunk.insert_range(62, 66, 0);
+  EXPECT_FALSE(Chunk.get_node(2, 0));
+  EXPECT_TRUE(Chunk.get_node(3, 0));
+  EXPECT_TRUE(Chunk.get_node(4, 0));
+  EXPECT_FALSE(Chunk.get_node(5, 0));
+  EXPECT_FALSE(Chunk.get_node(61, 0));
+  EXPECT_EQ(66u, Chunk.find_next_unset(62, 0));
+
+  // Full words in the middle of a range set their summary bits, across
+  // summary words.
+  Chunk.insert_range(66, 3 * SummaryCycles + 5, 0);
+  EXPECT_EQ(3 * SummaryCycles + 5, Chunk.find_next_unset(62, 0));
+  EXPECT_EQ(3 * SummaryCycles + 5, Chunk.find_next_unset(SummaryCycles, 0));
+  EXPECT_TRUE(Chunk.get_node(3 * SummaryCycles + 4, 0));
+  EXPECT_FALSE(Chunk.get_node(3 * SummaryCycles + 5, 0));
+
+  // Filling the hole before 62 joins both ranges.
+  Chunk.insert_range(5, 62, 0);
+  EXPECT_EQ(3 * SummaryCycles + 5, Chunk.find_next_unset(3, 0));
+  EXPECT_EQ(0u, Chunk.find_next_unset(0, 0));
+}
+
+// The cycles are absolute, and a range may end at the end of its chunk.
+TEST(TBV, InsertRangeToChunkEnd) {
+  TBV Chunk;
+  uint64_t ChunkBegin = 3 * SplitTreeRange;
+  Chunk.insert_range(ChunkBegin + SplitTreeRange - SummaryCycles - 1,
+                     ChunkBegin + SplitTreeRange, 4);
+  EXPECT_FALSE(Chunk.get_node(SplitTreeRange - SummaryCycles - 2, 4));
+  EXPECT_TRUE(Chunk.get_node(SplitTreeRange - SummaryCycles - 1, 4));
+  EXPECT_EQ(SplitTreeRange,
+            Chunk.find_next_unset(SplitTreeRange - SummaryCycles - 1, 4));
+
+  // A single cycle at the start of the chunk.
+  Chunk.insert_range(ChunkBegin, ChunkBegin + 1, 4);
+  EXPECT_EQ(1u, Chunk.find_next_unset(0, 4));
+}
+
+// BitScan moves on to the next chunks when a chunk has no set cycle left.
+TEST(TBV, BitScanAcrossChunks) {
+  vector<TBV> Chunks(3);
+  Chunks[0].insert_node(5, 2);
+  Chunks[2].insert_node(7, 2);
+  EXPECT_EQ(5u, BitScan(Chunks, 0, 2));
+  EXPECT_EQ(2 * SplitTreeRange + 7, BitScan(Chunks, 6, 2));
+  // Nothing set from the key on returns the key.
+  EXPECT_EQ(2 * SplitTreeRange + 8, BitScan(Chunks, 2 * SplitTreeRange + 8, 2));
+}
+
+} // end anonymous namespace
@@ -0,0 +1,98 @@
+//===- unittests/Support/TimedBufferTest.cpp - timed buffer tests ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+#include "llvm/Support/TimedBuffer.h"
+#include <cstdint>
+
+using namespace llvm;
+
+namespace {
+
+std::vector<uint64_t> toVector(const TimedBuffer<uint64_t> &Buffer) {
+  return std::vector<uint64_t>(Buffer.begin(), Buffer.end());
+}
+
+TEST(TimedBuffer, Basic) {
+  TimedBuffer<uint64_t> Buffer;
+  EXPECT_TRUE(Buffer.empty());
+  Buffer.insert(5);
+  Buffer.insert(3);
+  Buffer.insert(8);
+  Buffer.insert(5);
+  EXPECT_EQ(std::vector<uint64_t>({3, 5, 5, 8}), toVector(Buffer));
+  EXPECT_EQ(3u, Buffer.min());
+  EXPECT_EQ(5u, Buffer.kth(2));
+  EXPECT_EQ(0u, Buffer.countNotAfter(2));
+  EXPECT_EQ(3u, Buffer.countNotAfter(5));
+  EXPECT_EQ(4u, Buffer.countNotAfter(100));
+
+  Buffer.expire(5);
+  EXPECT_EQ(std::vector<uint64_t>({8}), toVector(Buffer));
+  Buffer.expire(8);
+  EXPECT_TRUE(Buffer.empty());
+
+  Buffer.insert(1);
+  Buffer.clear();
+  EXPECT_TRUE(Buffer.empty());
+}
+
+// Below 64 expired cycles the front of the vector is only skipped, and a
+// cycle smaller than the remaining ones goes right after the expired ones.
+TEST(TimedBuffer, ExpireWithoutCompaction) {
+  TimedBuffer<uint64_t> Buffer;
+  for (uint64_t Cycle = 0; Cycle < 10; Cycle++)
+    Buffer.insert(Cycle);
+  Buffer.expire(4);
+  EXPECT_EQ(5u, Buffer.size());
+  EXPECT_EQ(5u, Buffer.min());
+  Buffer.insert(3);
+  EXPECT_EQ(std::vector<uint64_t>({3, 5, 6, 7, 8, 9}), toVector(Buffer));
+  EXPECT_EQ(3u, Buffer.min());
+  EXPECT_EQ(5u, Buffer.kth(1));
+  EXPECT_EQ(1u, Buffer.countNotAfter(4));
+  // Expiring an earlier cycle than before removes nothing.
+  Buffer.expire(2);
+  EXPECT_EQ(6u, Buffer.size());
+}
+
+// Once at least 64 cycles and half of the vector have expired, the expired
+// cycles are erased.
+TEST(TimedBuffer, ExpireCompaction) {
+  TimedBuffer<uint64_t> Buffer;
+  for (uint64_t Cycle = 0; Cycle < 200; Cycle++)
+    Buffer.insert(Cycle);
+
+  // 63 expired cycles stay in the vector.
+  Buffer.expire(62);
+  EXPECT_EQ(137u, Buffer.size());
+  EXPECT_EQ(63u, Buffer.min());
+
+  // 100 of 200 expired cycles are erased.
+  Buffer.expire(99);
+  EXPECT_EQ(100u, Buffer.size());
+  EXPECT_EQ(100u, Buffer.min());
+  EXPECT_EQ(199u, Buffer.kth(99));
+  EXPECT_EQ(50u, Buffer.countNotAfter(149));
+
+  Buffer.insert(50);
+  Buffer.insert(150);
+  EXPECT_EQ(102u, Buffer.size());
+  EXPECT_EQ(50u, Buffer.min());
+  EXPECT_EQ(150u, Buffer.kth(51));
+  EXPECT_EQ(150u, Buffer.kth(52));
+  EXPECT_EQ(151u, Buffer.kth(53));
+
+  Buffer.expire(1000);
+  EXPECT_TRUE(Buffer.empty());
+  Buffer.insert(7);
+  EXPECT_EQ(7u, Buffer.min());
+}
+
+} // end anonymous namespace
@@ -22,6 +22,8 @@ function = 'mmm'
 input = '20'
 double_precision = 1
 config = 'SB'
+# Execute the code outside the analyzed function natively (lli -fast-forward)
+fast_forward = 0
 
 #------------------------------------------------------------------------------
 # Directories and paths to lli and clang
@@ -640,7 +642,8 @@ if __name__ == '__main__':
     p.wait() 
     
     # Run the bitcode file located in BIN_DIR and store the output in OUTPUT_DIR
-    cmd = '%s/lli -force-interpreter -function %s -warm-cache -uarch SB %s/%s.bc %s 2> %s/erm.out' % (LLI_PATH, function, BIN_DIR, benchmark, input, OUTPUT_DIR)
+    execution_mode = '-fast-forward' if fast_forward else '-force-interpreter'
+    cmd = '%s/lli %s -function %s -warm-cache -uarch SB %s/%s.bc %s 2> %s/erm.out' % (LLI_PATH, execution_mode, function, BIN_DIR, benchmark, input, OUTPUT_DIR)
     print (cmd)
     p = subprocess.Popen(cmd, shell=True, universal_newlines=True)
     p.wait() 
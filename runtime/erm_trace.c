@@ -0,0 +1,142 @@
+/*===-- erm_trace.c - Runtime of the ERM instrumentation pass --------------===*
+ *
+ * Records the dynamic instruction stream of the function analyzed by ERM from
+ * a program instrumented with opt -erm-instrumentation. The trace has the
+ * format of llvm/Support/DynamicAnalysisTrace.h and is analyzed with
+ *
+ *   lli -replay-trace=<trace> -function <name> [ERM options] <original.bc>
+ *
+ * Environment variables:
+ *   ERM_TRACE_FILE   Name of the trace (default erm.trace).
+ *   ERM_TRACE_CALLS  Number of calls to the target function that are recorded
+ *                    (default 2, the cache warm-up call and the analyzed call
+ *                    of -warm-cache). 0 records all of them.
+ *
+ * The runtime is not thread-safe: the analyzed code must be single-threaded,
+ * as in the interpreter.
+ *
+ *===----------------------------------------------------------------------===*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Must match llvm/Support/DynamicAnalysisTrace.h */
+#define DYNAMIC_TRACE_MAGIC "ERMTRACE"
+#define DYNAMIC_TRACE_VERSION 1
+
+struct DynamicTraceHeader {
+  char Magic[8];
+  uint32_t Version;
+  uint32_t RecordSize;
+  uint64_t NRecords;
+  uint64_t NStaticInstructions;
+};
+
+struct DynamicTraceRecord {
+  uint32_t InstructionId;
+  uint16_t OpCode;
+  uint16_t Flags;
+  uint64_t Payload;
+};
+
+/* Must match lib/Transforms/Instrumentation/ERMInstrumentation.cpp */
+#define ERM_EVENT_TARGET 0x1
+#define ERM_EVENT_CALL   0x2
+#define ERM_EVENT_RETURN 0x4
+
+#define TRACE_BUFFER_RECORDS 65536
+
+static FILE *TraceFile = NULL;
+static struct DynamicTraceRecord Buffer[TRACE_BUFFER_RECORDS];
+static unsigned NBuffered = 0;
+static uint64_t NRecords = 0;
+static uint64_t NStaticInstructions = 0;
+
+/* Calls made from the target function that have not returned yet, as
+ * FunctionCallStack in the interpreter. */
+static unsigned CallDepth = 0;
+static unsigned TargetReturns = 0;
+static unsigned MaxTargetCalls = 2;
+
+static void flushTrace(void) {
+  if (NBuffered == 0)
+    return;
+  if (fwrite(Buffer, sizeof(Buffer[0]), NBuffered, TraceFile) != NBuffered) {
+    fprintf(stderr, "erm_trace: error writing the trace\n");
+    exit(1);
+  }
+  NRecords += NBuffered;
+  NBuffered = 0;
+}
+
+static void closeTrace(void) {
+  struct DynamicTraceHeader Header;
+
+  if (TraceFile == NULL)
+    return;
+  flushTrace();
+
+  memcpy(Header.Magic, DYNAMIC_TRACE_MAGIC, sizeof(Header.Magic));
+  Header.Version = DYNAMIC_TRACE_VERSION;
+  Header.RecordSize = sizeof(struct DynamicTraceRecord);
+  Header.NRecords = NRecords;
+  Header.NStaticInstructions = NStaticInstructions;
+  if (fseek(TraceFile, 0, SEEK_SET) != 0 ||
+      fwrite(&Header, sizeof(Header), 1, TraceFile) != 1) {
+    fprintf(stderr, "erm_trace: error writing the trace header\n");
+    exit(1);
+  }
+  fclose(TraceFile);
+  TraceFile = NULL;
+}
+
+void __erm_trace_init(uint64_t NumStaticInstructions) {
+  struct DynamicTraceHeader Header;
+  const char *Filename = getenv("ERM_TRACE_FILE");
+  const char *Calls = getenv("ERM_TRACE_CALLS");
+
+  if (TraceFile != NULL)
+    return;
+  if (Filename == NULL)
+    Filename = "erm.trace";
+  if (Calls != NULL)
+    MaxTargetCalls = (unsigned)strtoul(Calls, NULL, 10);
+  NStaticInstructions = NumStaticInstructions;
+
+  TraceFile = fopen(Filename, "wb");
+  if (TraceFile == NULL) {
+    fprintf(stderr, "erm_trace: cannot open %s\n", Filename);
+    exit(1);
+  }
+  /* Placeholder header, rewritten by closeTrace once NRecords is known. */
+  memset(&Header, 0, sizeof(Header));
+  fwrite(&Header, sizeof(Header), 1, TraceFile);
+  atexit(closeTrace);
+}
+
+void __erm_trace_record(uint32_t InstructionId, uint32_t OpCode, uint32_t Flags,
+                        uint64_t Payload, uint32_t Kind) {
+  int IsTarget = (Kind & ERM_EVENT_TARGET) != 0;
+
+  if (TraceFile == NULL || (!IsTarget && CallDepth == 0))
+    return;
+
+  Buffer[NBuffered].InstructionId = InstructionId;
+  Buffer[NBuffered].OpCode = (uint16_t)OpCode;
+  Buffer[NBuffered].Flags = (uint16_t)Flags;
+  Buffer[NBuffered].Payload = Payload;
+  if (++NBuffered == TRACE_BUFFER_RECORDS)
+    flushTrace();
+
+  if (Kind & ERM_EVENT_CALL)
+    CallDepth++;
+  if (Kind & ERM_EVENT_RETURN) {
+    if (IsTarget && CallDepth == 0) {
+      if (++TargetReturns == MaxTargetCalls)
+        closeTrace();
+    } else
+      CallDepth--;
+  }
+}